@@ -1,38 +1,88 @@
+#if defined(__unix__) || defined(__APPLE__)
+#    define INPUT_MMAP
+// for `madvise` with strict ISO C
+#    define _DEFAULT_SOURCE
+#endif
+
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef INPUT_MMAP
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif /* INPUT_MMAP */
 
 #include "stc/fatp/string_view.h"
 #include "stc/util/argparser.h"
 #include "stc/util/utf.h"
 
 #include "re/parser.h"
+#include "vm/batch.h"
 #include "vm/compiler.h"
+#include "vm/dfa.h"
+#include "vm/jit.h"
+#include "vm/regex_set.h"
 #include "vm/srvm.h"
 // NOTE: deprecated/not useful, see all_matches ThreadManager
 // #include "vm/thread_managers/all_matches.h"
 #include "vm/thread_managers/benchmark.h"
+#include "vm/thread_managers/bitstate.h"
 #include "vm/thread_managers/lockstep.h"
 #include "vm/thread_managers/memoisation.h"
 #include "vm/thread_managers/spencer.h"
 
 #define ARR_LEN(arr) (sizeof(arr) / sizeof(arr[0]))
 
-typedef enum { SCH_SPENCER, SCH_LOCKSTEP } SchedulerType;
+typedef enum {
+    SCH_AUTO,
+    SCH_SPENCER,
+    SCH_LOCKSTEP,
+    SCH_BITSTATE,
+    SCH_DFA
+} SchedulerType;
 
 typedef struct {
-    const char     *regex;
-    const char     *text;
-    size_t          cmd;
-    int             benchmark;
-    int             all_matches;
-    FILE           *outfile;
-    FILE           *logfile;
-    SchedulerType   scheduler_type;
-    BruCompilerOpts compiler_opts;
-    BruParserOpts   parser_opts;
+    const char      *regex;
+    const char      *text;
+    size_t           cmd;
+    int              benchmark;
+    int              all_matches;
+    int              jit;
+    int              emit_binary;
+    int              binary;
+    int              input_file;
+    int              lines;
+    int              reverse_search;
+    int              is_match;
+    int              all;
+    int              cow_captures;
+    int              null_data;
+    FILE            *outfile;
+    FILE            *logfile;
+    SchedulerType    scheduler_type;
+    BruMemoTableType memo_table;
+    BruSRVMDispatch  dispatch;
+    size_t           iterations;
+    size_t           repeat;
+    size_t           widen;
+    size_t           nworkers;
+    size_t           chunk_size;
+    BruCompilerOpts  compiler_opts;
+    BruParserOpts    parser_opts;
 } BruOptions;
 
+/** The engine executing the program for `match`, of which one is not NULL. */
+typedef struct {
+    BruJIT  *jit;  /**< the JIT if selected and supported                     */
+    BruDFA  *dfa;  /**< the DFA if selected and supported                     */
+    BruSRVM *srvm; /**< the SRVM otherwise                                    */
+} BruMatcher;
+
 static char *sdup(const char *s)
 {
     char  *str;
@@ -108,24 +158,83 @@ static StcArgConvertResult convert_memo_scheme(const char *arg, void *out)
     return STC_ARG_CR_SUCCESS;
 }
 
+static StcArgConvertResult convert_memo_table(const char *arg, void *out)
+{
+    BruMemoTableType *type = out;
+
+    if (strcmp(arg, "bitset") == 0)
+        *type = BRU_MT_BITSET;
+    else if (strcmp(arg, "rle") == 0)
+        *type = BRU_MT_RLE;
+    else if (strcmp(arg, "hash") == 0)
+        *type = BRU_MT_HASH;
+    else
+        return STC_ARG_CR_FAILURE;
+
+    return STC_ARG_CR_SUCCESS;
+}
+
 static StcArgConvertResult convert_scheduler_type(const char *arg, void *out)
 {
     SchedulerType *type = out;
 
-    if (strcmp(arg, "spencer") == 0)
+    if (strcmp(arg, "auto") == 0)
+        *type = SCH_AUTO;
+    else if (strcmp(arg, "spencer") == 0)
         *type = SCH_SPENCER;
     else if (strcmp(arg, "lockstep") == 0 || strcmp(arg, "thompson") == 0)
         *type = SCH_LOCKSTEP;
+    else if (strcmp(arg, "bitstate") == 0)
+        *type = SCH_BITSTATE;
+    else if (strcmp(arg, "dfa") == 0)
+        *type = SCH_DFA;
     else
         return STC_ARG_CR_FAILURE;
 
     return STC_ARG_CR_SUCCESS;
 }
 
-static void add_parsing_args(StcArgParser *ap, BruOptions *options)
+static StcArgConvertResult convert_dispatch(const char *arg, void *out)
+{
+    BruSRVMDispatch *dispatch = out;
+
+    if (strcmp(arg, "switch") == 0)
+        *dispatch = BRU_SRVM_SWITCH;
+    else if (strcmp(arg, "threaded") == 0)
+        *dispatch = BRU_SRVM_THREADED;
+    else if (strcmp(arg, "specialised") == 0)
+        *dispatch = BRU_SRVM_SPECIALISED;
+    else
+        return STC_ARG_CR_FAILURE;
+
+    return STC_ARG_CR_SUCCESS;
+}
+
+static StcArgConvertResult convert_count(const char *arg, void *out)
+{
+    size_t *count = out;
+    char   *end;
+
+    *count = strtoul(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || *count == 0)
+        return STC_ARG_CR_FAILURE;
+
+    return STC_ARG_CR_SUCCESS;
+}
+
+static StcArgConvertResult convert_nworkers(const char *arg, void *out)
+{
+    size_t *nworkers = out;
+    char   *end;
+
+    *nworkers = strtoul(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0') return STC_ARG_CR_FAILURE;
+
+    return STC_ARG_CR_SUCCESS;
+}
+
+static void add_parser_opts_args(StcArgParser *ap, BruOptions *options)
 {
-    stc_argparser_add_str_argument(ap, "<regex>", "the regex to work with",
-                                   &options->regex);
     stc_argparser_add_bool_option(
         ap, NULL, "--only-counters",
         "whether to use just counters and treat *, +, and ? as counters",
@@ -152,6 +261,13 @@ static void add_parsing_args(StcArgParser *ap, BruOptions *options)
         &options->parser_opts.allow_repeated_nullability, TRUE);
 }
 
+static void add_parsing_args(StcArgParser *ap, BruOptions *options)
+{
+    stc_argparser_add_str_argument(ap, "<regex>", "the regex to work with",
+                                   &options->regex);
+    add_parser_opts_args(ap, options);
+}
+
 static void add_compilation_args(StcArgParser *ap, BruOptions *options)
 {
     stc_argparser_add_custom_option(
@@ -175,18 +291,75 @@ static void add_compilation_args(StcArgParser *ap, BruOptions *options)
         ap, NULL, "--mark-states",
         "whether to compile state marking instructions",
         &options->compiler_opts.mark_states, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--byte-level",
+        "whether to compile to instructions matching UTF-8 byte ranges",
+        &options->compiler_opts.byte_level, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--no-captures",
+        "whether to compile out the captures of the regex",
+        &options->compiler_opts.no_captures, FALSE);
+}
+
+static void add_emission_args(StcArgParser *ap, BruOptions *options)
+{
+    stc_argparser_add_bool_option(
+        ap, NULL, "--emit-binary",
+        "whether to write the program in the binary format instead of text",
+        &options->emit_binary, FALSE);
 }
 
 static void add_matching_args(StcArgParser *ap, BruOptions *options)
 {
+    stc_argparser_add_bool_option(
+        ap, NULL, "--binary",
+        "whether <regex> is a file of a program from compile --emit-binary",
+        &options->binary, FALSE);
     stc_argparser_add_custom_option(
-        ap, "-s", "--scheduler", "spencer | lockstep | thompson",
+        ap, "-s", "--scheduler",
+        "auto | spencer | lockstep | thompson | bitstate | dfa",
         "which scheduler to use for execution", &options->scheduler_type,
-        "spencer", convert_scheduler_type);
+        "auto", convert_scheduler_type);
+    stc_argparser_add_custom_option(
+        ap, NULL, "--memo-table", "bitset | rle | hash",
+        "which encoding to use for the memoisation table",
+        &options->memo_table, "bitset", convert_memo_table);
+    stc_argparser_add_custom_option(
+        ap, NULL, "--dispatch", "switch | threaded | specialised",
+        "how the SRVM dispatches instructions", &options->dispatch,
+        "specialised", convert_dispatch);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--jit",
+        "whether to compile the program to x86-64 machine code for matching",
+        &options->jit, FALSE);
     stc_argparser_add_bool_option(
         ap, "-b", "--benchmark",
         "whether to benchmark SRVM execution, writing to the logfile",
         &options->benchmark, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--input-file",
+        "whether <input> is a file to memory-map as the input string",
+        &options->input_file, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--lines",
+        "whether to match each line of the input string independently",
+        &options->lines, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--reverse-search",
+        "whether to find each match with DFAs before executing the SRVM on it",
+        &options->reverse_search, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--is-match",
+        "whether to only report if the regex matches, stopping at any match",
+        &options->is_match, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--all",
+        "whether to report the offsets of every match, with capture 0 as -w",
+        &options->all, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--cow-captures",
+        "whether cloned threads share their captures until they set a capture",
+        &options->cow_captures, FALSE);
     // NOTE: deprecated/not useful, see all_matches ThreadManager
     // stc_argparser_add_bool_option(ap, NULL, "--all-matches",
     //                               "whether to report all matches",
@@ -196,10 +369,103 @@ static void add_matching_args(StcArgParser *ap, BruOptions *options)
         &options->text);
 }
 
+static void add_bench_args(StcArgParser *ap, BruOptions *options)
+{
+    stc_argparser_add_custom_option(
+        ap, "-s", "--scheduler", "spencer | lockstep | thompson | bitstate",
+        "which scheduler to use for execution", &options->scheduler_type,
+        "spencer", convert_scheduler_type);
+    stc_argparser_add_custom_option(
+        ap, NULL, "--memo-table", "bitset | rle | hash",
+        "which encoding to use for the memoisation table",
+        &options->memo_table, "bitset", convert_memo_table);
+    stc_argparser_add_custom_option(
+        ap, "-n", "--iterations", "count",
+        "how many times to find all matches with each dispatch",
+        &options->iterations, "10", convert_count);
+    stc_argparser_add_custom_option(
+        ap, "-r", "--repeat", "count",
+        "how many times to repeat the input string to form the text",
+        &options->repeat, "1", convert_count);
+    stc_argparser_add_custom_option(
+        ap, NULL, "--widen", "count",
+        "time alternations of up to this many copies of the regex instead",
+        &options->widen, "1", convert_count);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--cow-captures",
+        "whether cloned threads share their captures until they set a capture",
+        &options->cow_captures, FALSE);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--input-file",
+        "whether <input> is a file to memory-map as the input string",
+        &options->input_file, FALSE);
+    stc_argparser_add_str_argument(
+        ap, "<input>", "the input string to match against the regex",
+        &options->text);
+}
+
+static void add_match_set_args(StcArgParser *ap, BruOptions *options)
+{
+    stc_argparser_add_str_argument(
+        ap, "<file>", "the file of regexes, one per line (empty lines ignored)",
+        &options->regex);
+    add_parser_opts_args(ap, options);
+    add_compilation_args(ap, options);
+    stc_argparser_add_str_argument(
+        ap, "<input>", "the input string to match against the regexes",
+        &options->text);
+}
+
+static void add_grep_args(StcArgParser *ap, BruOptions *options)
+{
+    stc_argparser_add_custom_option(
+        ap, "-s", "--scheduler", "spencer | lockstep | thompson | bitstate",
+        "which scheduler to use for execution", &options->scheduler_type,
+        "spencer", convert_scheduler_type);
+    stc_argparser_add_custom_option(
+        ap, NULL, "--memo-table", "bitset | rle | hash",
+        "which encoding to use for the memoisation table",
+        &options->memo_table, "bitset", convert_memo_table);
+    stc_argparser_add_custom_option(
+        ap, NULL, "--dispatch", "switch | threaded | specialised",
+        "how the SRVM dispatches instructions", &options->dispatch,
+        "specialised", convert_dispatch);
+    stc_argparser_add_custom_option(
+        ap, "-j", "--jobs", "count",
+        "how many worker threads to match with (0 for one per processor)",
+        &options->nworkers, "0", convert_nworkers);
+    stc_argparser_add_bool_option(
+        ap, "-z", "--null-data",
+        "whether the records of the file end in NUL bytes instead of newlines",
+        &options->null_data, FALSE);
+    stc_argparser_add_str_argument(
+        ap, "<file>", "the file of records to match against the regex",
+        &options->text);
+}
+
+static void add_scan_args(StcArgParser *ap, BruOptions *options)
+{
+    stc_argparser_add_custom_option(
+        ap, NULL, "--dispatch", "switch | threaded | specialised",
+        "how the SRVM dispatches instructions", &options->dispatch,
+        "specialised", convert_dispatch);
+    stc_argparser_add_custom_option(
+        ap, NULL, "--chunk-size", "count",
+        "how many bytes of the file to read and match at a time",
+        &options->chunk_size, "65536", convert_count);
+    stc_argparser_add_bool_option(
+        ap, NULL, "--cow-captures",
+        "whether cloned threads share their captures until they set a capture",
+        &options->cow_captures, FALSE);
+    stc_argparser_add_str_argument(
+        ap, "<file>", "the file to match against the regex (- for stdin)",
+        &options->text);
+}
+
 static StcArgParser *setup_argparser(BruOptions *options)
 {
     StcSubArgParsers *saps;
-    StcArgParser     *parse, *compile, *match;
+    StcArgParser     *parse, *compile, *match, *bench, *match_set, *grep, *scan;
     StcArgParser     *ap = stc_argparser_new(NULL);
 
     stc_argparser_add_custom_option(
@@ -225,6 +491,7 @@ static StcArgParser *setup_argparser(BruOptions *options)
         saps, "compile", "compile the regex into a regex program", NULL);
     add_parsing_args(compile, options);
     add_compilation_args(compile, options);
+    add_emission_args(compile, options);
 
     // match
     match = stc_subargparsers_add_argparser(
@@ -233,6 +500,40 @@ static StcArgParser *setup_argparser(BruOptions *options)
     add_compilation_args(match, options);
     add_matching_args(match, options);
 
+    // bench
+    bench = stc_subargparsers_add_argparser(
+        saps, "bench",
+        "time finding all matches with each dispatch of the SRVM",
+        NULL);
+    add_parsing_args(bench, options);
+    add_compilation_args(bench, options);
+    add_bench_args(bench, options);
+
+    // match-set
+    match_set = stc_subargparsers_add_argparser(
+        saps, "match-set",
+        "find which regexes of a file match an input string in one pass",
+        NULL);
+    add_match_set_args(match_set, options);
+
+    // grep
+    grep = stc_subargparsers_add_argparser(
+        saps, "grep",
+        "print the records of a file matching the regex, using many threads",
+        NULL);
+    add_parsing_args(grep, options);
+    add_compilation_args(grep, options);
+    add_grep_args(grep, options);
+
+    // scan
+    scan = stc_subargparsers_add_argparser(
+        saps, "scan",
+        "find the leftmost match in a file read in chunks with bounded memory",
+        NULL);
+    add_parsing_args(scan, options);
+    add_compilation_args(scan, options);
+    add_scan_args(scan, options);
+
     return ap;
 }
 
@@ -273,7 +574,12 @@ static int compile(BruOptions *options)
         options->compiler_opts);
     prog = bru_compiler_compile(c);
     if (prog) {
-        bru_program_print(prog, options->outfile);
+        if (!options->emit_binary) {
+            bru_program_print(prog, options->outfile);
+        } else if (!bru_program_save(prog, options->outfile)) {
+            fputs("ERROR: writing the program failed\n", stderr);
+            exit_code = EXIT_FAILURE;
+        }
         bru_program_free((BruProgram *) prog);
     } else {
         fputs("ERROR: compilation failed\n", stderr);
@@ -285,16 +591,536 @@ static int compile(BruOptions *options)
     return exit_code;
 }
 
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *file;
+    char *bytes = NULL;
+    long  n;
+
+    if ((file = fopen(path, "rb")) == NULL) return NULL;
+    if (fseek(file, 0, SEEK_END) == 0 && (n = ftell(file)) >= 0) {
+        rewind(file);
+        bytes = malloc(n + 1);
+        if (fread(bytes, 1, n, file) == (size_t) n) {
+            bytes[n] = '\0';
+            *len     = n;
+        } else {
+            free(bytes);
+            bytes = NULL;
+        }
+    }
+    fclose(file);
+
+    return bytes;
+}
+
+static const BruProgram *load_program(const char *path)
+{
+    bru_byte_t       *bytes;
+    size_t            len;
+    const BruProgram *prog = NULL;
+
+    if ((bytes = read_file(path, &len)) == NULL) return NULL;
+    prog = bru_program_load(bytes, len, NULL);
+    free(bytes);
+
+    return prog;
+}
+
+/**
+ * Warn if the input ends part way through a UTF-8 codepoint, such as a file
+ * cut off mid-codepoint, as the codepoint cannot be matched.
+ *
+ * @param[in] options the command-line options
+ * @param[in] text    the input string
+ * @param[in] len     the length of the input string
+ *
+ * @return the input string
+ */
+static const char *
+check_input_end(BruOptions *options, const char *text, size_t len)
+{
+    size_t i = len;
+
+    // step back over the continuation bytes to the start of the last codepoint
+    while (i > 0 && len - i < 4 && ((unsigned char) text[i - 1] & 0xC0) == 0x80)
+        i--;
+    if (i > 0 && (unsigned char) text[i - 1] >= 0xC0 &&
+        i - 1 + stc_utf8_nbytes(text + i - 1) > len)
+        fputs("WARNING: the input ends part way through a UTF-8 codepoint\n",
+              options->logfile);
+
+    return text;
+}
+
+static const char *load_input(BruOptions *options, size_t *len)
+{
+    const char *text = options->text;
+#ifdef INPUT_MMAP
+    struct stat st;
+    void       *addr;
+    int         fd;
+#endif /* INPUT_MMAP */
+
+    if (!options->input_file) {
+        *len = strlen(text);
+        return check_input_end(options, text, *len);
+    }
+
+#ifdef INPUT_MMAP
+    if ((fd = open(options->text, O_RDONLY)) < 0) return NULL;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // an empty file cannot be mapped
+    *len = st.st_size;
+    if (*len == 0) {
+        close(fd);
+        return "";
+    }
+
+    addr = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return NULL;
+    madvise(addr, *len, MADV_SEQUENTIAL);
+
+    return check_input_end(options, addr, *len);
+#else
+    if ((text = read_file(options->text, len)) == NULL) return NULL;
+
+    return check_input_end(options, text, *len);
+#endif /* INPUT_MMAP */
+}
+
+static void unload_input(BruOptions *options, const char *text, size_t len)
+{
+    if (!options->input_file) return;
+
+#ifdef INPUT_MMAP
+    if (len > 0) munmap((void *) text, len);
+#else
+    (void) len;
+    free((char *) text);
+#endif /* INPUT_MMAP */
+}
+
+static void print_match(BruOptions   *options,
+                        const char   *text,
+                        size_t        line,
+                        const size_t *captures,
+                        bru_len_t     ncaptures)
+{
+    StcStringView capture;
+    bru_len_t     i;
+    size_t        ncodepoints;
+    int           offsets = options->input_file || options->lines;
+
+    if (options->lines)
+        fprintf(options->outfile, "Found match on line %zu\n", line);
+    else
+        fputs("Found match\n", options->outfile);
+    if (options->is_match) return;
+    fprintf(options->outfile, "captures:\n");
+    // the input is only printed when it is given on the command line
+    if (!offsets) fprintf(options->outfile, "  input: '%s'\n", options->text);
+    for (i = 0; i < ncaptures; i++) {
+        capture = captures[2 * i] == SIZE_MAX || captures[2 * i + 1] == SIZE_MAX
+                      ? (StcStringView){ 0, NULL }
+                      : stc_sv_from_range(text + captures[2 * i],
+                                          text + captures[2 * i + 1]);
+        fprintf(options->outfile, "%7hu: ", i);
+        if (!capture.str) {
+            fprintf(options->outfile, "not captured\n");
+        } else if (offsets) {
+            fprintf(options->outfile, "[%zu, %zu) '" STC_SV_FMT "'\n",
+                    (size_t) (capture.str - text),
+                    (size_t) (capture.str - text) + capture.len,
+                    STC_SV_ARG(capture));
+        } else {
+            ncodepoints = stc_utf8_str_ncodepoints(options->text) -
+                          stc_utf8_str_ncodepoints(capture.str);
+            fprintf(options->outfile, "%*s'" STC_SV_FMT "'\n",
+                    (int) ncodepoints, "", STC_SV_ARG(capture));
+        }
+    }
+}
+
+static void print_match_offsets(BruOptions   *options,
+                                size_t        line,
+                                const size_t *offsets,
+                                bru_len_t     ncaptures)
+{
+    bru_len_t i;
+
+    if (options->lines)
+        fprintf(options->outfile, "Found match on line %zu\n", line);
+    else
+        fputs("Found match\n", options->outfile);
+    if (offsets[0] != SIZE_MAX)
+        fprintf(options->outfile, "  span: [%zu, %zu)\n", offsets[0],
+                offsets[1]);
+    else
+        fprintf(options->outfile, "  end: %zu\n", offsets[1]);
+    fprintf(options->outfile, "captures:\n");
+    for (i = 0, offsets += 2; i < ncaptures; i++) {
+        fprintf(options->outfile, "%7hu: ", i);
+        if (offsets[2 * i] != SIZE_MAX && offsets[2 * i + 1] != SIZE_MAX)
+            fprintf(options->outfile, "[%zu, %zu)\n", offsets[2 * i],
+                    offsets[2 * i + 1]);
+        else
+            fprintf(options->outfile, "not captured\n");
+    }
+}
+
+static BruThreadManager *new_thread_manager(BruOptions       *options,
+                                            const BruProgram *prog)
+{
+    BruThreadManager *thread_manager = NULL;
+    // programs loaded with `--binary` were memoised when compiled, so the
+    // program rather than the options tells whether to memoise
+    int               memoise        = prog->nmemo_insts > 0;
+
+    if (options->scheduler_type == SCH_BITSTATE &&
+        !(thread_manager =
+              bru_bitstate_thread_manager_new(prog, options->logfile)))
+        fputs("WARNING: program not supported by the bit-state scheduler, "
+              "using spencer\n",
+              options->logfile);
+
+    if (thread_manager)
+        // the visited set of the bit-state scheduler already memoises
+        memoise = FALSE;
+    else if ((options->scheduler_type == SCH_LOCKSTEP ||
+              options->scheduler_type == SCH_DFA) &&
+             options->cow_captures)
+        thread_manager = bru_thompson_cow_thread_manager_new(
+            0, prog->thread_mem_len, prog->ncaptures, options->logfile);
+    else if (options->scheduler_type == SCH_LOCKSTEP ||
+             options->scheduler_type == SCH_DFA)
+        thread_manager = bru_thompson_thread_manager_new(
+            0, prog->thread_mem_len, prog->ncaptures, options->logfile);
+    else if (options->cow_captures)
+        thread_manager = bru_spencer_cow_thread_manager_new(
+            0, prog->thread_mem_len, prog->ncaptures, options->logfile);
+    else
+        thread_manager = bru_spencer_thread_manager_new(
+            0, prog->thread_mem_len, prog->ncaptures, options->logfile);
+
+    if (memoise)
+        thread_manager = bru_memoised_thread_manager_new(
+            thread_manager, options->memo_table, options->benchmark,
+            options->logfile);
+    if (options->benchmark)
+        thread_manager =
+            bru_benchmark_thread_manager_new(thread_manager, options->logfile);
+    // NOTE: deprecated/not useful, see all_matches ThreadManager
+    // if (options->all_matches)
+    //     thread_manager = all_matches_thread_manager_new(
+    //         thread_manager, options->logfile, options->text);
+
+    return thread_manager;
+}
+
+/**
+ * Choose the scheduler for `match` when none was given, which is the bit-state
+ * scheduler if its visited set for the longest string matched is small enough,
+ * and the Spencer scheduler otherwise.
+ *
+ * @param[in] options  the options for matching
+ * @param[in] prog     the program to match with
+ * @param[in] text     the input
+ * @param[in] text_len the number of bytes of the input
+ *
+ * @return the scheduler to match with
+ */
+static SchedulerType auto_scheduler(const BruOptions *options,
+                                    const BruProgram *prog,
+                                    const char       *text,
+                                    size_t            text_len)
+{
+    const char *line, *line_end, *text_end = text + text_len;
+    size_t      len = text_len;
+
+    // the bit-state scheduler has no copy-on-write captures
+    if (!stc_vec_is_empty(prog->counters) || options->cow_captures)
+        return SCH_SPENCER;
+
+    // with `--lines` each line is matched on its own
+    if (options->lines)
+        for (line = text, len = 0; line < text_end; line = line_end + 1) {
+            if (!(line_end = memchr(line, '\n', text_end - line)))
+                line_end = text_end;
+            if ((size_t) (line_end - line) > len) len = line_end - line;
+        }
+
+    return (len + 1) * stc_vec_len(prog->insts) <= BRU_BITSTATE_MAX_BITS
+               ? SCH_BITSTATE
+               : SCH_SPENCER;
+}
+
+static BruMatcher matcher_new(BruOptions       *options,
+                              const BruProgram *prog,
+                              const BruProgram *reverse_prog)
+{
+    BruMatcher m = { NULL, NULL, NULL };
+
+    if (options->jit &&
+        !(m.jit = bru_jit_new(prog, options->memo_table, options->logfile)))
+        fputs("WARNING: program not supported by the JIT, using the SRVM\n",
+              options->logfile);
+
+    // the DFA cannot report captures
+    if (!m.jit && options->scheduler_type == SCH_DFA &&
+        (prog->ncaptures > 0 ||
+         !(m.dfa = bru_dfa_new(prog, BRU_DFA_CACHE_SIZE_DEFAULT,
+                               options->logfile))))
+        fputs("WARNING: program not supported by the DFA, using lockstep\n",
+              options->logfile);
+
+    if (!m.jit && !m.dfa)
+        m.srvm = bru_srvm_new(new_thread_manager(options, prog), prog,
+                              options->dispatch);
+
+    if (m.srvm && reverse_prog &&
+        !bru_srvm_set_search(m.srvm, BRU_SRVM_SEARCH_REVERSE, reverse_prog,
+                             options->logfile))
+        fputs("WARNING: program not supported by the DFA, searching forward\n",
+              options->logfile);
+
+    return m;
+}
+
+static void matcher_free(BruMatcher *m)
+{
+    if (m->jit) bru_jit_free(m->jit);
+    if (m->dfa) bru_dfa_free(m->dfa);
+    if (m->srvm) bru_srvm_free(m->srvm);
+}
+
+static int
+matcher_find(BruMatcher *m, const char *text, size_t text_len, int first)
+{
+    if (m->jit)
+        return first ? bru_jit_match_n(m->jit, text, text_len)
+                     : bru_jit_find_n(m->jit, text, text_len);
+    if (m->dfa)
+        return first ? bru_dfa_match_n(m->dfa, text, text_len)
+                     : bru_dfa_find_n(m->dfa, text, text_len);
+
+    return first ? bru_srvm_match_n(m->srvm, text, text_len)
+                 : bru_srvm_find_n(m->srvm, text, text_len);
+}
+
+static int matcher_is_match(BruMatcher *m, const char *text, size_t text_len)
+{
+    if (m->jit) return bru_jit_match_n(m->jit, text, text_len);
+    if (m->dfa) return bru_dfa_match_n(m->dfa, text, text_len);
+
+    return bru_srvm_is_match_n(m->srvm, text, text_len);
+}
+
+static bru_len_t matcher_captures_into(BruMatcher *m, size_t *offsets, size_t n)
+{
+    if (m->jit) return bru_jit_captures_into(m->jit, offsets, n);
+    if (m->srvm) return bru_srvm_captures_into(m->srvm, offsets, n);
+
+    return 0;
+}
+
 static int match(BruOptions *options)
+{
+    BruCompiler      *c            = NULL;
+    const BruProgram *reverse_prog = NULL;
+    const BruProgram *prog;
+    BruMatcher        m;
+    const char       *text, *line, *line_end, *text_end;
+    size_t           *offsets;
+    size_t            text_len, nline, noffsets, nmatches = 0;
+    bru_len_t         ncaptures;
+    int               found, exit_code = EXIT_SUCCESS;
+
+    if (options->binary) {
+        if ((prog = load_program(options->regex)) == NULL) {
+            fputs("ERROR: loading the program failed\n", stderr);
+            exit_code = EXIT_FAILURE;
+            goto done;
+        }
+    } else {
+        // only whether the regex matches is reported, so no captures are needed
+        if (options->is_match) options->compiler_opts.no_captures = TRUE;
+        // the forward search does not know where a match starts
+        if (options->all) options->parser_opts.whole_match_capture = TRUE;
+        c = bru_compiler_new(
+            bru_parser_new(sdup(options->regex), options->parser_opts),
+            options->compiler_opts);
+        prog = bru_compiler_compile(c);
+        if (prog == NULL) {
+            fputs("ERROR: compilation failed\n", stderr);
+            exit_code = EXIT_FAILURE;
+            goto done;
+        }
+        if (options->reverse_search)
+            reverse_prog = bru_compiler_compile_reverse(c);
+    }
+    if (options->reverse_search && options->binary)
+        fputs("WARNING: reverse search needs the regex, searching forward\n",
+              options->logfile);
+
+    if ((text = load_input(options, &text_len)) == NULL) {
+        fputs("ERROR: reading the input file failed\n", stderr);
+        exit_code = EXIT_FAILURE;
+        goto done_prog;
+    }
+
+    if (options->scheduler_type == SCH_AUTO)
+        options->scheduler_type = auto_scheduler(options, prog, text, text_len);
+    if (options->all && (options->jit || options->scheduler_type == SCH_DFA)) {
+        fputs("WARNING: --all needs the SRVM, using lockstep\n",
+              options->logfile);
+        options->jit            = FALSE;
+        options->scheduler_type = SCH_LOCKSTEP;
+    }
+
+    // without `--lines` the whole input is matched as a single line, and each
+    // line is matched in place as the input is delimited by its length
+    m        = matcher_new(options, prog, reverse_prog);
+    text_end = text + text_len;
+    // the offsets of every match are written into the same buffer
+    noffsets = 2 * prog->ncaptures + 2;
+    offsets  = malloc(noffsets * sizeof(*offsets));
+    for (line = text, nline = 1; !options->lines || line < text_end; nline++) {
+        line_end = options->lines ? memchr(line, '\n', text_end - line) : NULL;
+        if (line_end == NULL) line_end = text_end;
+
+        if (options->is_match) {
+            if (matcher_is_match(&m, line, line_end - line)) {
+                print_match(options, line, nline, NULL, 0);
+                nmatches++;
+            }
+        } else if (options->all) {
+            while (bru_srvm_find_iter(m.srvm, line, line_end - line, offsets,
+                                      noffsets)) {
+                print_match_offsets(options, nline, offsets, prog->ncaptures);
+                nmatches++;
+            }
+        } else {
+            for (found = matcher_find(&m, line, line_end - line, TRUE); found;
+                 found = matcher_find(&m, line, line_end - line, FALSE)) {
+                ncaptures = matcher_captures_into(&m, offsets, noffsets);
+                print_match(options, line, nline, offsets, ncaptures);
+                nmatches++;
+            }
+        }
+
+        if (line_end == text_end) break;
+        line = line_end + 1;
+    }
+    if (nmatches == 0) fputs("No match\n", options->outfile);
+    free(offsets);
+    matcher_free(&m);
+    unload_input(options, text, text_len);
+
+done_prog:
+    if (reverse_prog) bru_program_free((BruProgram *) reverse_prog);
+    bru_program_free((BruProgram *) prog);
+
+done:
+    if (c) bru_compiler_free(c);
+
+    return exit_code;
+}
+
+/**
+ * Time finding all matches of alternations of the regex with each SRVM step,
+ * doubling the number of alternatives up to the `--widen` count. The live
+ * threads grow with the number of alternatives, so a constant time per byte
+ * per alternative shows that each step is linear in the live threads.
+ *
+ * @param[in] options  the command-line options
+ * @param[in] text     the text to match against
+ * @param[in] text_len the length of the text
+ *
+ * @return the exit code
+ */
+static int bench_widen(BruOptions *options, const char *text, size_t text_len)
 {
     BruCompiler      *c;
     const BruProgram *prog;
-    BruThreadManager *thread_manager = NULL;
     BruSRVM          *srvm;
-    StcStringView     capture, *captures;
-    bru_len_t         i, ncaptures;
-    size_t            ncodepoints;
-    int               matched, exit_code = EXIT_SUCCESS;
+    char             *regex;
+    size_t            width, i, j, len, regex_len, nmatches;
+    clock_t           start;
+    double            ms;
+    int               found;
+
+    // each alternative is a non-capturing group, so the captures of the
+    // threads do not grow with the number of alternatives
+    len   = strlen(options->regex);
+    regex = malloc(options->widen * (len + 5) * sizeof(char));
+    for (width = 1; width <= options->widen; width *= 2) {
+        for (regex_len = i = 0; i < width; i++) {
+            if (i > 0) regex[regex_len++] = '|';
+            memcpy(regex + regex_len, "(?:", 3 * sizeof(char));
+            memcpy(regex + regex_len + 3, options->regex, len * sizeof(char));
+            regex_len          += len + 3;
+            regex[regex_len++]  = ')';
+        }
+        regex[regex_len] = '\0';
+
+        c = bru_compiler_new(bru_parser_new(sdup(regex), options->parser_opts),
+                             options->compiler_opts);
+        if ((prog = bru_compiler_compile(c)) == NULL) {
+            fputs("ERROR: compilation failed\n", stderr);
+            bru_compiler_free(c);
+            free(regex);
+            return EXIT_FAILURE;
+        }
+
+        srvm     = bru_srvm_new(new_thread_manager(options, prog), prog,
+                                BRU_SRVM_SPECIALISED);
+        nmatches = 0;
+        start    = clock();
+        for (j = 0; j < options->iterations; j++)
+            for (found = bru_srvm_match_n(srvm, text, text_len); found;
+                 found = bru_srvm_find_n(srvm, text, text_len))
+                nmatches++;
+        ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC / options->iterations;
+        fprintf(options->outfile,
+                "%6zu alternatives: %zu matches in %.3f ms "
+                "(%.3f ns per byte per alternative)\n",
+                width, nmatches / options->iterations, ms,
+                1e6 * ms / (text_len ? text_len : 1) / width);
+
+        bru_srvm_free(srvm);
+        bru_program_free((BruProgram *) prog);
+        bru_compiler_free(c);
+    }
+    free(regex);
+
+    return EXIT_SUCCESS;
+}
+
+static int bench(BruOptions *options)
+{
+    static const BruSRVMDispatch dispatches[]     = { BRU_SRVM_SWITCH,
+                                                      BRU_SRVM_THREADED,
+                                                      BRU_SRVM_SPECIALISED };
+    static const char *const     dispatch_names[] = { "switch", "threaded",
+                                                      "specialised" };
+
+    BruCompiler      *c;
+    const BruProgram *prog, *reverse_prog;
+    BruThreadManager *thread_manager;
+    BruSRVM          *srvm;
+    BruJIT           *jit;
+    const char       *input, *text;
+    char             *repeated = NULL;
+    size_t            i, j, len, text_len, nmatches;
+    clock_t           start;
+    double            ms;
+    int               found, exit_code = EXIT_SUCCESS;
 
     c = bru_compiler_new(
         bru_parser_new(sdup(options->regex), options->parser_opts),
@@ -306,48 +1132,299 @@ static int match(BruOptions *options)
         goto done;
     }
 
-    if (options->scheduler_type == SCH_SPENCER)
-        thread_manager = bru_spencer_thread_manager_new(
-            0, prog->thread_mem_len, prog->ncaptures, options->logfile);
-    else if (options->scheduler_type == SCH_LOCKSTEP)
-        thread_manager = bru_thompson_thread_manager_new(
-            0, prog->thread_mem_len, prog->ncaptures, options->logfile);
+    if ((input = load_input(options, &len)) == NULL) {
+        fputs("ERROR: reading the input file failed\n", stderr);
+        exit_code = EXIT_FAILURE;
+        goto done_prog;
+    }
 
-    if (options->compiler_opts.memo_scheme != BRU_MS_NONE)
-        thread_manager = bru_memoised_thread_manager_new(thread_manager);
-    if (options->benchmark)
-        thread_manager =
-            bru_benchmark_thread_manager_new(thread_manager, options->logfile);
-    // NOTE: deprecated/not useful, see all_matches ThreadManager
-    // if (options->all_matches)
-    //     thread_manager = all_matches_thread_manager_new(
-    //         thread_manager, options->logfile, options->text);
+    // repeat the input for a longer text, which is only copied if repeated
+    text_len = len * options->repeat;
+    text     = input;
+    if (options->repeat > 1) {
+        text = repeated = malloc(text_len * sizeof(char));
+        for (i = 0; i < options->repeat; i++)
+            memcpy(repeated + i * len, input, len * sizeof(char));
+    }
+
+    if (options->widen > 1) {
+        exit_code = bench_widen(options, text, text_len);
+        goto done_text;
+    }
+
+    for (i = 0; i < ARR_LEN(dispatches); i++) {
+        thread_manager = new_thread_manager(options, prog);
+        srvm           = bru_srvm_new(thread_manager, prog, dispatches[i]);
+        nmatches       = 0;
+        start          = clock();
+        for (j = 0; j < options->iterations; j++)
+            for (found = bru_srvm_match_n(srvm, text, text_len); found;
+                 found = bru_srvm_find_n(srvm, text, text_len))
+                nmatches++;
+        ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC / options->iterations;
+        fprintf(options->outfile, "%-11s: %zu matches in %.3f ms\n",
+                dispatch_names[i], nmatches / options->iterations, ms);
+        bru_srvm_free(srvm);
+    }
+
+    // the reverse search only runs the SRVM on the matches the DFAs find
+    reverse_prog = bru_compiler_compile_reverse(c);
+    srvm         = bru_srvm_new(new_thread_manager(options, prog), prog,
+                                BRU_SRVM_SPECIALISED);
+    if (bru_srvm_set_search(srvm, BRU_SRVM_SEARCH_REVERSE, reverse_prog,
+                            options->logfile)) {
+        nmatches = 0;
+        start    = clock();
+        for (j = 0; j < options->iterations; j++)
+            for (found = bru_srvm_match_n(srvm, text, text_len); found;
+                 found = bru_srvm_find_n(srvm, text, text_len))
+                nmatches++;
+        ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC / options->iterations;
+        fprintf(options->outfile, "%-11s: %zu matches in %.3f ms\n",
+                "reverse", nmatches / options->iterations, ms);
+    }
+    bru_srvm_free(srvm);
+    bru_program_free((BruProgram *) reverse_prog);
+
+    // the machine code backtracks like the Spencer thread manager
+    if (options->scheduler_type == SCH_SPENCER &&
+        (jit = bru_jit_new(prog, options->memo_table, options->logfile))) {
+        nmatches = 0;
+        start    = clock();
+        for (j = 0; j < options->iterations; j++)
+            for (found = bru_jit_match_n(jit, text, text_len); found;
+                 found = bru_jit_find_n(jit, text, text_len))
+                nmatches++;
+        ms = 1000.0 * (clock() - start) / CLOCKS_PER_SEC / options->iterations;
+        fprintf(options->outfile, "%-11s: %zu matches in %.3f ms\n", "jit",
+                nmatches / options->iterations, ms);
+        bru_jit_free(jit);
+    }
+
+done_text:
+    free(repeated);
+    unload_input(options, input, len);
 
-    srvm = bru_srvm_new(thread_manager, prog);
-    if (!(matched = bru_srvm_find(srvm, options->text)))
+done_prog:
+    bru_program_free((BruProgram *) prog);
+
+done:
+    bru_compiler_free(c);
+
+    return exit_code;
+}
+
+static int match_set(BruOptions *options)
+{
+    BruRegexSet  *set;
+    char         *contents, *line, *end;
+    const char  **regexes;
+    size_t        i, len, nregexes, nmatched, invalid, *ids;
+    int           exit_code = EXIT_SUCCESS;
+
+    if ((contents = read_file(options->regex, &len)) == NULL) {
+        fputs("ERROR: reading the file of regexes failed\n", stderr);
+        return EXIT_FAILURE;
+    }
+
+    // split the contents into lines in place, skipping empty lines, where
+    // every line but the last takes at least two bytes with its newline
+    regexes = malloc((len / 2 + 1) * sizeof(*regexes));
+    for (line = contents, nregexes = 0; *line; line = end) {
+        end = line + strcspn(line, "\n");
+        if (*end) *end++ = '\0';
+        if ((i = strlen(line)) && line[i - 1] == '\r') line[i - 1] = '\0';
+        if (*line) regexes[nregexes++] = line;
+    }
+
+    set = bru_regex_set_new(regexes, nregexes, options->parser_opts,
+                            options->compiler_opts, &invalid);
+    if (set == NULL) {
+        fprintf(stderr, "ERROR: compilation of regex %zu failed: '%s'\n",
+                invalid, regexes[invalid]);
+        exit_code = EXIT_FAILURE;
+        goto done;
+    }
+
+    ids      = malloc(nregexes * sizeof(*ids));
+    nmatched = bru_regex_set_matches(set, options->text, ids);
+    if (!nmatched) {
         fputs("No match\n", options->outfile);
-    else
-        do {
-            fputs("Found match\n", options->outfile);
-            fprintf(options->outfile, "captures:\n");
-            captures = bru_srvm_captures(srvm, &ncaptures);
-            fprintf(options->outfile, "  input: '%s'\n", options->text);
-            for (i = 0; i < ncaptures; i++) {
-                capture = captures[i];
-                fprintf(options->outfile, "%7hu: ", i);
-                if (capture.str) {
-                    ncodepoints = stc_utf8_str_ncodepoints(options->text) -
-                                  stc_utf8_str_ncodepoints(capture.str);
-                    fprintf(options->outfile, "%*s'" STC_SV_FMT "'\n",
-                            (int) ncodepoints, "", STC_SV_ARG(capture));
-                } else {
-                    fprintf(options->outfile, "not captured\n");
-                }
-            }
-            free(captures);
-        } while ((matched = bru_srvm_find(srvm, options->text)));
+    } else {
+        fprintf(options->outfile, "Found match for %zu of %zu regexes\n",
+                nmatched, nregexes);
+        fprintf(options->outfile, "regexes:\n");
+        for (i = 0; i < nmatched; i++)
+            fprintf(options->outfile, "%7zu: '%s'\n", ids[i],
+                    regexes[ids[i]]);
+    }
+    free(ids);
+    bru_regex_set_free(set);
+
+done:
+    free(regexes);
+    free(contents);
+
+    return exit_code;
+}
+
+static BruThreadManager *batch_thread_manager_new(void             *options,
+                                                  const BruProgram *prog)
+{
+    return new_thread_manager(options, prog);
+}
+
+static int grep(BruOptions *options)
+{
+    BruCompiler      *c;
+    const BruProgram *prog;
+    BruBatch         *batch;
+    char             *contents, *record, *end, delim;
+    const char      **records;
+    size_t           *record_lens, i, len, nrecords, nmatched;
+    bru_byte_t       *matched;
+    struct timespec   start, stop;
+    double            ms;
+    int               exit_code = EXIT_SUCCESS;
+
+    // only whether each record matches is reported, so no captures are needed
+    options->compiler_opts.no_captures = TRUE;
+    c = bru_compiler_new(
+        bru_parser_new(sdup(options->regex), options->parser_opts),
+        options->compiler_opts);
+    prog = bru_compiler_compile(c);
+    if (prog == NULL) {
+        fputs("ERROR: compilation failed\n", stderr);
+        exit_code = EXIT_FAILURE;
+        goto done;
+    }
+
+    if ((contents = read_file(options->text, &len)) == NULL) {
+        fputs("ERROR: reading the file of records failed\n", stderr);
+        exit_code = EXIT_FAILURE;
+        goto done_prog;
+    }
+
+    // split the contents into records, where a final delimiter does not start
+    // an empty record
+    delim = options->null_data ? '\0' : '\n';
+    for (i = 0, nrecords = 0; i < len; nrecords++) {
+        end = memchr(contents + i, delim, len - i);
+        i   = end ? (size_t) (end - contents) + 1 : len;
+    }
+    records     = malloc((nrecords ? nrecords : 1) * sizeof(*records));
+    record_lens = malloc((nrecords ? nrecords : 1) * sizeof(*record_lens));
+    matched     = malloc((nrecords ? nrecords : 1) * sizeof(*matched));
+    for (record = contents, i = 0; i < nrecords; i++, record = end + 1) {
+        if ((end = memchr(record, delim, contents + len - record)) == NULL)
+            end = contents + len;
+        records[i]     = record;
+        record_lens[i] = end - record;
+    }
+
+    batch = bru_batch_new(prog, options->nworkers, options->dispatch,
+                          batch_thread_manager_new, options);
+    timespec_get(&start, TIME_UTC);
+    nmatched = bru_batch_match(batch, records, record_lens, nrecords, matched);
+    timespec_get(&stop, TIME_UTC);
+    ms = 1000.0 * (stop.tv_sec - start.tv_sec) +
+         (stop.tv_nsec - start.tv_nsec) / 1000000.0;
+
+    for (i = 0; i < nrecords; i++) {
+        if (!matched[i]) continue;
+        fwrite(records[i], sizeof(char), record_lens[i], options->outfile);
+        fputc(delim, options->outfile);
+    }
+    fprintf(options->logfile,
+            "%zu of %zu records matched in %.3f ms (%.2f MB/s) with %zu "
+            "workers\n",
+            nmatched, nrecords, ms, ms > 0 ? len / ms / 1000.0 : 0.0,
+            bru_batch_nworkers(batch));
+
+    bru_batch_free(batch);
+    free(matched);
+    free(record_lens);
+    free(records);
+    free(contents);
+
+done_prog:
     bru_program_free((BruProgram *) prog);
+
+done:
+    bru_compiler_free(c);
+
+    return exit_code;
+}
+
+static int scan(BruOptions *options)
+{
+    BruCompiler      *c;
+    const BruProgram *prog;
+    BruThreadManager *thread_manager;
+    BruSRVM          *srvm;
+    FILE             *file;
+    char             *chunk;
+    size_t           *captures, n;
+    bru_len_t         i, ncaptures;
+    int               exit_code = EXIT_SUCCESS;
+
+    c = bru_compiler_new(
+        bru_parser_new(sdup(options->regex), options->parser_opts),
+        options->compiler_opts);
+    prog = bru_compiler_compile(c);
+    if (prog == NULL) {
+        fputs("ERROR: compilation failed\n", stderr);
+        exit_code = EXIT_FAILURE;
+        goto done;
+    }
+
+    file = strcmp(options->text, "-") == 0 ? stdin : fopen(options->text, "rb");
+    if (file == NULL) {
+        fputs("ERROR: opening the file failed\n", stderr);
+        exit_code = EXIT_FAILURE;
+        goto done_prog;
+    }
+
+    // only the lockstep thread manager can suspend its threads between chunks
+    thread_manager =
+        options->cow_captures
+            ? bru_thompson_cow_thread_manager_new(
+                  0, prog->thread_mem_len, prog->ncaptures, options->logfile)
+            : bru_thompson_thread_manager_new(
+                  0, prog->thread_mem_len, prog->ncaptures, options->logfile);
+    srvm  = bru_srvm_new(thread_manager, prog, options->dispatch);
+    chunk = malloc(options->chunk_size);
+    bru_srvm_stream_begin(srvm);
+    while ((n = fread(chunk, 1, options->chunk_size, file)) > 0 &&
+           bru_srvm_stream_feed(srvm, chunk, n))
+        ;
+    if (ferror(file)) {
+        fputs("ERROR: reading the file failed\n", stderr);
+        exit_code = EXIT_FAILURE;
+    } else if (!bru_srvm_stream_end(srvm)) {
+        fputs("No match\n", options->outfile);
+    } else {
+        fputs("Found match\n", options->outfile);
+        fprintf(options->outfile, "  end: %zu\n",
+                bru_srvm_stream_match_end(srvm));
+        fprintf(options->outfile, "captures:\n");
+        captures = bru_srvm_stream_captures(srvm, &ncaptures);
+        for (i = 0; i < ncaptures; i++) {
+            fprintf(options->outfile, "%7hu: ", i);
+            if (captures[2 * i] != SIZE_MAX && captures[2 * i + 1] != SIZE_MAX)
+                fprintf(options->outfile, "[%zu, %zu)\n", captures[2 * i],
+                        captures[2 * i + 1]);
+            else
+                fprintf(options->outfile, "not captured\n");
+        }
+        free(captures);
+    }
+    free(chunk);
     bru_srvm_free(srvm);
+    if (file != stdin) fclose(file);
+
+done_prog:
+    bru_program_free((BruProgram *) prog);
 
 done:
     bru_compiler_free(c);
@@ -360,7 +1437,9 @@ int main(int argc, const char **argv)
     int           exit_code;
     StcArgParser *argparser;
     BruOptions    options                        = { 0 };
-    static int    (*subcommands[])(BruOptions *) = { parse, compile, match };
+    static int    (*subcommands[])(BruOptions *) = {
+        parse, compile, match, bench, match_set, grep, scan
+    };
 
     argparser = setup_argparser(&options);
     stc_argparser_parse(argparser, argc, argv);
@@ -375,6 +375,9 @@ static void rfa_construct(BruRfa                *self,
             APPEND_POSITION(
                 bru_smir_action_predicate(bru_intervals_clone(re->intervals)));
             break;
+        case BRU_BYTES:
+            APPEND_POSITION(bru_smir_action_byte(re->lbyte, re->ubyte));
+            break;
 
         case BRU_ALT:
             rfa_construct(self, re->left, first, opts);
@@ -574,6 +577,7 @@ static size_t count(const BruRegexNode *re)
 
         case BRU_LITERAL: /* fallthrough */
         case BRU_CC:      /* fallthrough */
+        case BRU_BYTES:   /* fallthrough */
         case BRU_BACKREFERENCE: npos = 1; break;
 
         case BRU_ALT: /* fallthrough */
@@ -89,6 +89,13 @@ emit(BruStateMachine *sm, const BruRegexNode *re, const BruCompilerOpts *opts)
                 bru_smir_action_predicate(bru_intervals_clone(re->intervals)));
             break;
 
+        case BRU_BYTES:
+            state_ids.initial = state_ids.final = bru_smir_add_state(sm);
+            bru_smir_state_append_action(
+                sm, state_ids.final,
+                bru_smir_action_byte(re->lbyte, re->ubyte));
+            break;
+
         case BRU_ALT:
             state_ids.initial = bru_smir_add_state(sm);
 
@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "../stc/fatp/vec.h"
 
@@ -31,6 +32,10 @@ struct bru_action {
     union {
         const char         *ch;   /**< type = ACT_CHAR                        */
         const BruIntervals *pred; /**< type = ACT_PRED                        */
+        struct {
+            unsigned char lbyte; /**< type = ACT_BYTE                         */
+            unsigned char ubyte; /**< type = ACT_BYTE                         */
+        };
         size_t k; /**< type = ACT_MEMO | ACT_SAVE | ACT_EPSCHK | ACT_EPSSET   */
     };
 };
@@ -472,6 +477,18 @@ const BruAction *bru_smir_action_predicate(const BruIntervals *pred)
     return act;
 }
 
+const BruAction *bru_smir_action_byte(unsigned char lbyte,
+                                      unsigned char ubyte)
+{
+    BruAction *act = malloc(sizeof(*act));
+
+    act->type  = BRU_ACT_BYTE;
+    act->lbyte = lbyte;
+    act->ubyte = ubyte;
+
+    return act;
+}
+
 const BruAction *bru_smir_action_num(BruActionType type, size_t k)
 {
     BruAction *act = malloc(sizeof(*act));
@@ -482,6 +499,15 @@ const BruAction *bru_smir_action_num(BruActionType type, size_t k)
     return act;
 }
 
+const BruAction *bru_smir_action_match(void)
+{
+    BruAction *act = malloc(sizeof(*act));
+
+    act->type = BRU_ACT_MATCH;
+
+    return act;
+}
+
 const BruAction *bru_smir_action_clone(const BruAction *self)
 {
     const BruAction *clone;
@@ -496,6 +522,9 @@ const BruAction *bru_smir_action_clone(const BruAction *self)
         case BRU_ACT_PRED:
             clone = bru_smir_action_predicate(bru_intervals_clone(self->pred));
             break;
+        case BRU_ACT_BYTE:
+            clone = bru_smir_action_byte(self->lbyte, self->ubyte);
+            break;
 
         case BRU_ACT_MEMO:   /* fallthrough */
         case BRU_ACT_SAVE:   /* fallthrough */
@@ -503,6 +532,8 @@ const BruAction *bru_smir_action_clone(const BruAction *self)
         case BRU_ACT_EPSSET:
             clone = bru_smir_action_num(self->type, self->k);
             break;
+
+        case BRU_ACT_MATCH: clone = bru_smir_action_match(); break;
     }
 
     return clone;
@@ -540,10 +571,14 @@ void bru_smir_action_print(const BruAction *self, FILE *stream)
             fprintf(stream, "pred %s", s);
             free(s);
             break;
+        case BRU_ACT_BYTE:
+            fprintf(stream, "byte \\x%02x-\\x%02x", self->lbyte, self->ubyte);
+            break;
         case BRU_ACT_MEMO: fprintf(stream, "memo %zu", self->k); break;
         case BRU_ACT_SAVE: fprintf(stream, "save %zu", self->k); break;
         case BRU_ACT_EPSCHK: fprintf(stream, "epschk %zu", self->k); break;
         case BRU_ACT_EPSSET: fprintf(stream, "epsset %zu", self->k); break;
+        case BRU_ACT_MATCH: fprintf(stream, "match"); break;
     }
 }
 
@@ -823,7 +858,7 @@ static size_t count_bytes_actions(const BruActionList *acts)
 
             case BRU_ACT_CHAR:
                 size++;
-                size += sizeof(const char *);
+                size += stc_utf8_nbytes(n->act->ch);
                 break;
 
             case BRU_ACT_PRED:
@@ -831,6 +866,11 @@ static size_t count_bytes_actions(const BruActionList *acts)
                 size += sizeof(bru_len_t);
                 break;
 
+            case BRU_ACT_BYTE:
+                size++;
+                size += 2 * sizeof(bru_byte_t);
+                break;
+
             case BRU_ACT_MEMO:
                 size++;
                 size += sizeof(bru_len_t);
@@ -850,6 +890,8 @@ static size_t count_bytes_actions(const BruActionList *acts)
                 size++;
                 size += sizeof(bru_len_t);
                 break;
+
+            case BRU_ACT_MATCH: size++; break;
         }
     }
 
@@ -875,8 +917,10 @@ static bru_byte_t *compile_actions(bru_byte_t          *pc,
         }                                                             \
     } while (0)
 
-    BruActionList *n;
-    size_t         idx, len;
+    BruActionList     *n;
+    BruIntervalsTable *table;
+    char              *str;
+    size_t             idx, len;
 
     if (!acts) return pc;
 
@@ -887,16 +931,28 @@ static bru_byte_t *compile_actions(bru_byte_t          *pc,
 
             case BRU_ACT_CHAR:
                 BRU_BCWRITE(pc, BRU_CHAR);
-                BRU_MEMWRITE(pc, const char *, n->act->ch);
+                BRU_CODEPOINTWRITE(pc, n->act->ch);
                 break;
 
             case BRU_ACT_PRED:
+                // the lookup table is followed by the string of the
+                // predicate for printing, padded to keep tables aligned
                 BRU_BCWRITE(pc, BRU_PRED);
                 BRU_MEMWRITE(pc, bru_len_t, stc_vec_len_unsafe(prog->aux));
-                BRU_MEMCPY(prog->aux, n->act->pred,
-                           sizeof(*n->act->pred) +
-                               n->act->pred->len *
-                                   sizeof(*n->act->pred->intervals));
+                table = bru_intervals_table_new(n->act->pred);
+                BRU_MEMCPY(prog->aux, table, bru_intervals_table_size(table));
+                bru_intervals_table_free(table);
+                str = bru_intervals_to_str(n->act->pred);
+                BRU_MEMCPY(prog->aux, str, strlen(str) + 1);
+                free(str);
+                while (stc_vec_len_unsafe(prog->aux) % sizeof(uint64_t))
+                    stc_vec_push_back(prog->aux, '\0');
+                break;
+
+            case BRU_ACT_BYTE:
+                BRU_BCWRITE(pc, BRU_BYTE);
+                BRU_BCWRITE(pc, n->act->lbyte);
+                BRU_BCWRITE(pc, n->act->ubyte);
                 break;
 
             case BRU_ACT_MEMO:
@@ -926,6 +982,8 @@ static bru_byte_t *compile_actions(bru_byte_t          *pc,
                         sizeof(const char *), n->act->k);
                 BRU_MEMWRITE(pc, bru_len_t, idx);
                 break;
+
+            case BRU_ACT_MATCH: BRU_BCWRITE(pc, BRU_MATCH); break;
         }
     }
 
@@ -24,11 +24,14 @@ typedef enum {
 
     BRU_ACT_CHAR,
     BRU_ACT_PRED,
+    BRU_ACT_BYTE,
 
     BRU_ACT_MEMO,
     BRU_ACT_SAVE,
     BRU_ACT_EPSCHK,
     BRU_ACT_EPSSET,
+
+    BRU_ACT_MATCH,
 } BruActionType;
 
 typedef BruActionType BruPredicateType;
@@ -54,10 +57,12 @@ typedef BruActionType ActionType;
 #    define ACT_END    BRU_ACT_END
 #    define ACT_CHAR   BRU_ACT_CHAR
 #    define ACT_PRED   BRU_ACT_PRED
+#    define ACT_BYTE   BRU_ACT_BYTE
 #    define ACT_MEMO   BRU_ACT_MEMO
 #    define ACT_SAVE   BRU_ACT_SAVE
 #    define ACT_EPSCHK BRU_ACT_EPSCHK
 #    define ACT_EPSSET BRU_ACT_EPSSET
+#    define ACT_MATCH  BRU_ACT_MATCH
 
 typedef BruPredicateType      PredicateType;
 typedef BruAction             Action;
@@ -105,7 +110,9 @@ typedef bru_compile_f compile_f;
 #    define smir_action_zwa       bru_smir_action_zwa
 #    define smir_action_char      bru_smir_action_char
 #    define smir_action_predicate bru_smir_action_predicate
+#    define smir_action_byte      bru_smir_action_byte
 #    define smir_action_num       bru_smir_action_num
+#    define smir_action_match     bru_smir_action_match
 #    define smir_action_clone     bru_smir_action_clone
 #    define smir_action_free      bru_smir_action_free
 #    define smir_action_type      bru_smir_action_type
@@ -484,6 +491,17 @@ const BruAction *bru_smir_action_char(const char *ch);
  */
 const BruAction *bru_smir_action_predicate(const BruIntervals *pred);
 
+/**
+ * Create an action for matching a single byte against a byte range.
+ *
+ * @param[in] lbyte the lower bound of the byte range
+ * @param[in] ubyte the upper bound of the byte range
+ *
+ * @return the action
+ */
+const BruAction *bru_smir_action_byte(unsigned char lbyte,
+                                      unsigned char ubyte);
+
 /**
  * Create an action which require relative pointers into memory.
  *
@@ -499,6 +517,17 @@ const BruAction *bru_smir_action_predicate(const BruIntervals *pred);
  */
 const BruAction *bru_smir_action_num(BruActionType type, size_t k);
 
+/**
+ * Create an action which ends the thread in a match.
+ *
+ * The action compiles to its own `match` instruction, so a state machine with
+ * several accepting states can tell which one a match ended in. Any actions or
+ * transitions following the action are never executed.
+ *
+ * @return the action
+ */
+const BruAction *bru_smir_action_match(void);
+
 /**
  * Clone an action.
  *
@@ -49,10 +49,12 @@ static int action_list_signature(const BruActionList *actions)
             switch (bru_smir_action_type(a)) {
                 case BRU_ACT_CHAR:   /* fallthrough */
                 case BRU_ACT_PRED:   /* fallthrough */
+                case BRU_ACT_BYTE:   /* fallthrough */
                 case BRU_ACT_MEMO:   /* fallthrough */
                 case BRU_ACT_EPSCHK: /* fallthrough */
                 case BRU_ACT_EPSSET: /* fallthrough */
-                case BRU_ACT_SAVE: break;
+                case BRU_ACT_SAVE:   /* fallthrough */
+                case BRU_ACT_MATCH: break;
 
                 case BRU_ACT_BEGIN: /* fallthrough */
                 case BRU_ACT_END:
@@ -98,7 +100,9 @@ static int is_epsilon_state(const BruActionList *actions)
     while ((act = bru_smir_action_list_iterator_next(ali))) {
         switch (bru_smir_action_type(act)) {
             case BRU_ACT_CHAR: /* fallthrough */
-            case BRU_ACT_PRED: is_epsilon = FALSE; goto done;
+            case BRU_ACT_PRED: /* fallthrough */
+            case BRU_ACT_BYTE: /* fallthrough */
+            case BRU_ACT_MATCH: is_epsilon = FALSE; goto done;
 
             case BRU_ACT_BEGIN:  /* fallthrough */
             case BRU_ACT_END:    /* fallthrough */
@@ -132,8 +136,10 @@ static void remove_unnecessary_actions(const BruActionList *actions)
             case BRU_ACT_END:   /* fallthrough */
             case BRU_ACT_CHAR:  /* fallthrough */
             case BRU_ACT_PRED:  /* fallthrough */
+            case BRU_ACT_BYTE:  /* fallthrough */
             case BRU_ACT_MEMO:  /* fallthrough */
-            case BRU_ACT_SAVE: break;
+            case BRU_ACT_SAVE:  /* fallthrough */
+            case BRU_ACT_MATCH: break;
         }
     }
     free(ali);
@@ -165,8 +171,10 @@ static int action_list_eps_satisfiable(const BruActionList *actions)
             case BRU_ACT_END:   /* fallthrough */
             case BRU_ACT_CHAR:  /* fallthrough */
             case BRU_ACT_PRED:  /* fallthrough */
+            case BRU_ACT_BYTE:  /* fallthrough */
             case BRU_ACT_MEMO:  /* fallthrough */
-            case BRU_ACT_SAVE: break;
+            case BRU_ACT_SAVE:  /* fallthrough */
+            case BRU_ACT_MATCH: break;
 
             case BRU_ACT_EPSCHK:
                 num = bru_smir_action_get_num(act);
@@ -75,6 +75,181 @@ static bru_byte_t *memoise_cn(BruStateMachine *sm)
     return memo_sids;
 }
 
+typedef struct {
+    size_t       *index;    /**< DFS visit index of each state (0 => unseen)  */
+    size_t       *lowlink;  /**< lowest index reachable from each state       */
+    size_t       *scc;      /**< strongly connected component of each state   */
+    bru_byte_t   *on_stack; /**< whether each state is on the Tarjan stack    */
+    bru_state_id *stack;    /**< Tarjan stack of states                       */
+    size_t        sp;       /**< number of states on the Tarjan stack         */
+    size_t        next_idx; /**< next DFS visit index                         */
+    size_t        nsccs;    /**< number of strongly connected components      */
+} BruIarGraph;
+
+static void iar_tarjan(BruStateMachine *sm, bru_state_id sid, BruIarGraph *g)
+{
+    bru_trans_id *out_transitions;
+    size_t        i, n;
+    bru_state_id  dst;
+
+    g->index[sid - 1] = g->lowlink[sid - 1] = ++g->next_idx;
+    g->stack[g->sp++]    = sid;
+    g->on_stack[sid - 1] = TRUE;
+
+    out_transitions = bru_smir_get_out_transitions(sm, sid, &n);
+    for (i = 0; i < n; i++) {
+        dst = bru_smir_get_dst(sm, out_transitions[i]);
+
+        if (BRU_IS_FINAL_STATE(dst)) continue;
+
+        if (!g->index[dst - 1]) {
+            iar_tarjan(sm, dst, g);
+            if (g->lowlink[dst - 1] < g->lowlink[sid - 1])
+                g->lowlink[sid - 1] = g->lowlink[dst - 1];
+        } else if (g->on_stack[dst - 1] &&
+                   g->index[dst - 1] < g->lowlink[sid - 1]) {
+            g->lowlink[sid - 1] = g->index[dst - 1];
+        }
+    }
+    if (out_transitions) free(out_transitions);
+
+    if (g->lowlink[sid - 1] != g->index[sid - 1]) return;
+
+    // `sid` is the root of a component, so pop the component off the stack
+    do {
+        dst                  = g->stack[--g->sp];
+        g->on_stack[dst - 1] = FALSE;
+        g->scc[dst - 1]      = g->nsccs;
+    } while (dst != sid);
+    g->nsccs++;
+}
+
+/**
+ * Select the states to memoise to remove infinite ambiguity.
+ *
+ * A state machine has an infinite degree of ambiguity when a component has two
+ * distinct cycles through a state (exponential backtracking), or when a cycle
+ * can be reached from another cycle (polynomial backtracking). Transition
+ * labels are ignored, so the selection over-approximates ambiguity, but simple
+ * loops that are not preceded by another loop are never memoised.
+ *
+ * Backedge targets are memoised in components with more than one cycle, and
+ * the entry states are memoised for cyclic components reachable from a cycle.
+ * For unanchored search the selection must be made after the search transform,
+ * whose implicit `.*?` loop is the cycle that precedes the loops of the regex.
+ *
+ * @param[in] sm the state machine
+ *
+ * @return a boolean array indicating if a state is in the set to be memoised
+ */
+static bru_byte_t *memoise_iar(BruStateMachine *sm)
+{
+    size_t        i, n, c, k, nstates = bru_smir_get_num_states(sm);
+    bru_byte_t   *memo_sids = memoise_cn(sm);
+    bru_byte_t   *cyclic, *multi_cyclic, *after_cycle;
+    size_t       *nedges, *nsccstates;
+    bru_trans_id *out_transitions;
+    bru_state_id  sid, dst, *order;
+    BruIarGraph   g;
+
+    if (nstates == 0) return memo_sids;
+
+    g.index    = calloc(nstates, sizeof(size_t));
+    g.lowlink  = calloc(nstates, sizeof(size_t));
+    g.scc      = calloc(nstates, sizeof(size_t));
+    g.on_stack = calloc(nstates, sizeof(bru_byte_t));
+    g.stack    = malloc(nstates * sizeof(bru_state_id));
+    order      = malloc(nstates * sizeof(bru_state_id));
+    g.sp       = 0;
+    g.next_idx = 0;
+    g.nsccs    = 0;
+
+    out_transitions = bru_smir_get_initial(sm, &n);
+    for (i = 0; i < n; i++) {
+        dst = bru_smir_get_dst(sm, out_transitions[i]);
+        if (!BRU_IS_FINAL_STATE(dst) && !g.index[dst - 1])
+            iar_tarjan(sm, dst, &g);
+    }
+    if (out_transitions) free(out_transitions);
+
+    cyclic       = calloc(g.nsccs, sizeof(bru_byte_t));
+    multi_cyclic = calloc(g.nsccs, sizeof(bru_byte_t));
+    after_cycle  = calloc(g.nsccs, sizeof(bru_byte_t));
+    nedges       = calloc(g.nsccs, sizeof(size_t));
+    nsccstates   = calloc(g.nsccs, sizeof(size_t));
+
+    // a component has more than one cycle iff it has more internal
+    // transitions than states
+    for (sid = 1; sid <= nstates; sid++) {
+        if (!g.index[sid - 1]) continue;
+        c = g.scc[sid - 1];
+        nsccstates[c]++;
+        out_transitions = bru_smir_get_out_transitions(sm, sid, &n);
+        for (i = 0; i < n; i++) {
+            dst = bru_smir_get_dst(sm, out_transitions[i]);
+            if (!BRU_IS_FINAL_STATE(dst) && g.scc[dst - 1] == c) nedges[c]++;
+        }
+        if (out_transitions) free(out_transitions);
+    }
+    for (c = 0; c < g.nsccs; c++) {
+        cyclic[c]       = nedges[c] > 0;
+        multi_cyclic[c] = nedges[c] > nsccstates[c];
+    }
+
+    // group the states by component with a counting sort
+    for (c = 1; c < g.nsccs; c++) nsccstates[c] += nsccstates[c - 1];
+    for (sid = nstates; sid > 0; sid--)
+        if (g.index[sid - 1]) order[--nsccstates[g.scc[sid - 1]]] = sid;
+
+    // Tarjan's algorithm finds components in reverse topological order, so
+    // propagate whether a cycle precedes a component from the last found
+    for (k = g.next_idx; k-- > 0;) {
+        sid             = order[k];
+        c               = g.scc[sid - 1];
+        out_transitions = bru_smir_get_out_transitions(sm, sid, &n);
+        for (i = 0; i < n; i++) {
+            dst = bru_smir_get_dst(sm, out_transitions[i]);
+            if (BRU_IS_FINAL_STATE(dst) || g.scc[dst - 1] == c) continue;
+            if (cyclic[c] || after_cycle[c])
+                after_cycle[g.scc[dst - 1]] = TRUE;
+        }
+        if (out_transitions) free(out_transitions);
+    }
+
+    for (sid = 1; sid <= nstates; sid++)
+        memo_sids[sid - 1] = memo_sids[sid - 1] && g.index[sid - 1] &&
+                             multi_cyclic[g.scc[sid - 1]];
+
+    // memoise the entries of cyclic components that are preceded by a cycle
+    for (sid = 0; sid <= nstates; sid++) {
+        if (sid && !g.index[sid - 1]) continue;
+        out_transitions = bru_smir_get_out_transitions(sm, sid, &n);
+        for (i = 0; i < n; i++) {
+            dst = bru_smir_get_dst(sm, out_transitions[i]);
+            if (BRU_IS_FINAL_STATE(dst)) continue;
+            c = g.scc[dst - 1];
+            if (cyclic[c] && after_cycle[c] &&
+                (!sid || g.scc[sid - 1] != c))
+                memo_sids[dst - 1] = TRUE;
+        }
+        if (out_transitions) free(out_transitions);
+    }
+
+    free(g.index);
+    free(g.lowlink);
+    free(g.scc);
+    free(g.on_stack);
+    free(g.stack);
+    free(order);
+    free(cyclic);
+    free(multi_cyclic);
+    free(after_cycle);
+    free(nedges);
+    free(nsccstates);
+
+    return memo_sids;
+}
+
 /**
  * Memoise the states of a state machine in the given set of state identifiers.
  *
@@ -123,7 +298,7 @@ bru_transform_memoise(BruStateMachine *sm, BruMemoScheme memo, FILE *logfile)
         case BRU_MS_NONE: return sm;
         case BRU_MS_IN: memo_sids = memoise_in(sm); break;
         case BRU_MS_CN: memo_sids = memoise_cn(sm); break;
-        case BRU_MS_IAR: return sm;
+        case BRU_MS_IAR: memo_sids = memoise_iar(sm); break;
     }
 
     memoise_states(sm, memo_sids, logfile);
@@ -20,7 +20,8 @@
  *
  * MS_IN: Memoise states with more than 1 incoming transition.
  * MS_CN: Memoise all states that are targets of backedges.
- * MS_IAR: Not currently supported.
+ * MS_IAR: Memoise backedge targets of components with more than 1 cycle, and
+ *         entries of cycles that are reachable from another cycle.
  *
  * @param[in] sm      the state machine
  * @param[in] memo    the memoisation scheme
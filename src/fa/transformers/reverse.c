@@ -0,0 +1,106 @@
+#include <stdlib.h>
+
+#include "../../types.h"
+#include "reverse.h"
+
+/* --- Helper function prototypes ------------------------------------------- */
+
+static BruActionList *reverse_actions(const BruActionList *acts);
+
+/* --- API function definitions --------------------------------------------- */
+
+BruStateMachine *bru_transform_reverse(BruStateMachine *sm)
+{
+    BruStateMachine *rsm;
+    bru_trans_id    *out, tid;
+    bru_state_id     sid, dst;
+    size_t           i, n, nstates;
+
+    if (!sm) return NULL;
+
+    nstates = bru_smir_get_num_states(sm);
+    rsm     = bru_smir_new(bru_smir_get_regex(sm), nstates);
+    for (sid = 1; sid <= nstates; sid++)
+        bru_smir_state_set_actions(
+            rsm, sid, reverse_actions(bru_smir_state_get_actions(sm, sid)));
+
+    for (sid = 0; sid <= nstates; sid++) {
+        out = bru_smir_get_out_transitions(sm, sid, &n);
+        for (i = 0; i < n; i++) {
+            dst = bru_smir_get_dst(sm, out[i]);
+            if (BRU_IS_FINAL_STATE(dst)) {
+                tid = bru_smir_set_initial(rsm, sid);
+            } else {
+                tid = bru_smir_add_transition(rsm, dst);
+                bru_smir_set_dst(rsm, tid, sid);
+            }
+            bru_smir_trans_set_actions(
+                rsm, tid,
+                reverse_actions(bru_smir_trans_get_actions(sm, out[i])));
+        }
+        if (out) free(out);
+    }
+
+    // a state without incoming transitions is left without outgoing ones, so
+    // it loops back to itself instead of falling through to the next state
+    for (sid = 1; sid <= nstates; sid++) {
+        out = bru_smir_get_out_transitions(rsm, sid, &n);
+        if (out) free(out);
+        if (n == 0) {
+            tid = bru_smir_add_transition(rsm, sid);
+            bru_smir_set_dst(rsm, tid, sid);
+        }
+    }
+
+    return rsm;
+}
+
+/* --- Helper function definitions ------------------------------------------ */
+
+/**
+ * Reverse a list of actions, swapping the `begin` and `end` assertions and
+ * leaving out the actions which do not decide whether a string matches.
+ *
+ * @param[in] acts the list of actions to reverse
+ *
+ * @return the reversed list of actions
+ */
+static BruActionList *reverse_actions(const BruActionList *acts)
+{
+    BruActionList         *rev = bru_smir_action_list_new();
+    BruActionListIterator *ali;
+    const BruAction       *act;
+
+    if (!acts) return rev;
+
+    ali = bru_smir_action_list_iter(acts);
+    while ((act = bru_smir_action_list_iterator_next(ali))) {
+        switch (bru_smir_action_type(act)) {
+            case BRU_ACT_BEGIN:
+                bru_smir_action_list_push_front(
+                    rev, bru_smir_action_zwa(BRU_ACT_END));
+                break;
+
+            case BRU_ACT_END:
+                bru_smir_action_list_push_front(
+                    rev, bru_smir_action_zwa(BRU_ACT_BEGIN));
+                break;
+
+            case BRU_ACT_CHAR: /* fallthrough */
+            case BRU_ACT_PRED: /* fallthrough */
+            case BRU_ACT_BYTE:
+                bru_smir_action_list_push_front(rev,
+                                                bru_smir_action_clone(act));
+                break;
+
+            case BRU_ACT_MEMO:   /* fallthrough */
+            case BRU_ACT_SAVE:   /* fallthrough */
+            case BRU_ACT_EPSCHK: /* fallthrough */
+            case BRU_ACT_EPSSET: /* fallthrough */
+            case BRU_ACT_MATCH: break;
+        }
+    }
+    free(ali);
+
+    return rev;
+}
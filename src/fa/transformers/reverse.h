@@ -0,0 +1,38 @@
+#ifndef BRU_FA_TRANSFORM_REVERSE_H
+#define BRU_FA_TRANSFORM_REVERSE_H
+
+#include "../smir.h"
+
+#if !defined(BRU_FA_TRANSFORM_REVERSE_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_FA_TRANSFORM_REVERSE_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_FA_DISABLE_SHORT_NAMES) &&                  \
+         (defined(BRU_FA_ENABLE_SHORT_NAMES) ||               \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+#    define transform_reverse bru_transform_reverse
+#endif /* BRU_FA_TRANSFORM_REVERSE_ENABLE_SHORT_NAMES */
+
+/**
+ * Create the reverse of a state machine, which matches the reversal of every
+ * string the state machine matches, for finding the start of a match backwards
+ * from its end.
+ *
+ * Every transition is reversed, so that transitions into the final state become
+ * initial transitions and vice versa, and the actions on states and transitions
+ * are reversed with the `begin` and `end` assertions swapped. For byte-level
+ * state machines the bytes of each codepoint are therefore matched last to
+ * first.
+ *
+ * Only the language of the state machine is kept: capture, memoisation, and
+ * epsilon check actions are left out, and the priorities of the transitions are
+ * meaningless. As empty loops are no longer cut off, the reverse state machine
+ * is only meant to be executed by the DFA, which matches the longest string.
+ *
+ * NOTE: The reverse state machine shares the regex of the state machine.
+ *
+ * @param[in] sm the state machine
+ *
+ * @return the reverse state machine
+ */
+BruStateMachine *bru_transform_reverse(BruStateMachine *sm);
+
+#endif /* BRU_FA_TRANSFORM_REVERSE_H */
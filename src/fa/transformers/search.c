@@ -0,0 +1,39 @@
+#include <stdlib.h>
+
+#include "../../types.h"
+#include "search.h"
+
+/* --- API function definitions --------------------------------------------- */
+
+BruStateMachine *bru_transform_search(BruStateMachine *sm, int byte_level)
+{
+    bru_trans_id *initial, tid;
+    bru_state_id  sid;
+    size_t        i, n;
+
+    if (!sm) return sm;
+
+    initial = bru_smir_get_initial(sm, &n);
+    sid     = bru_smir_add_state(sm);
+    bru_smir_state_append_action(
+        sm, sid,
+        byte_level ? bru_smir_action_byte(0x00, 0xff)
+                   : bru_smir_action_predicate(bru_intervals_new(TRUE, 0)));
+
+    // try to start a match at the current position before consuming anything
+    for (i = 0; i < n; i++) {
+        tid = bru_smir_add_transition(sm, sid);
+        bru_smir_set_dst(sm, tid, bru_smir_get_dst(sm, initial[i]));
+        if (bru_smir_trans_get_num_actions(sm, initial[i]))
+            bru_smir_trans_set_actions(
+                sm, tid, bru_smir_trans_clone_actions(sm, initial[i]));
+    }
+    if (initial) free(initial);
+
+    // lowest priority: skip a character and try again
+    tid = bru_smir_add_transition(sm, sid);
+    bru_smir_set_dst(sm, tid, sid);
+    bru_smir_set_initial(sm, sid);
+
+    return sm;
+}
@@ -0,0 +1,36 @@
+#ifndef BRU_FA_TRANSFORM_SEARCH_H
+#define BRU_FA_TRANSFORM_SEARCH_H
+
+#include "../smir.h"
+
+#if !defined(BRU_FA_TRANSFORM_SEARCH_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_FA_TRANSFORM_SEARCH_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_FA_DISABLE_SHORT_NAMES) &&                 \
+         (defined(BRU_FA_ENABLE_SHORT_NAMES) ||              \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+#    define transform_search bru_transform_search
+#endif /* BRU_FA_TRANSFORM_SEARCH_ENABLE_SHORT_NAMES */
+
+/**
+ * Prepend an implicit lazy `.*?` loop to the state machine so that a single
+ * pass over the input finds the leftmost match, i.e., unanchored search.
+ *
+ * A new state matching any character is added which is entered from the
+ * initial state with the lowest priority. Its outgoing transitions are copies
+ * of the initial transitions (with their actions) followed by a transition
+ * back to itself, so every position in the input is tried as a starting
+ * position before advancing.
+ *
+ * For byte-level state machines the new state matches any byte instead, as
+ * their matches can only start at the first byte of a codepoint anyway.
+ *
+ * NOTE: This transform does not create a new state machine.
+ *
+ * @param[in] sm         the state machine
+ * @param[in] byte_level whether the state machine consumes bytes
+ *
+ * @return the original state machine
+ */
+BruStateMachine *bru_transform_search(BruStateMachine *sm, int byte_level);
+
+#endif /* BRU_FA_TRANSFORM_SEARCH_H */
@@ -391,7 +391,7 @@ static BruParseResult parse_atom(const BruParser *self,
         default:
             *re = bru_regex_literal(ps->ch);
             SET_RID(*re, ps);
-            res = PARSE_RES(BRU_PARSE_SUCCESS, ps->ch++);
+            res = PARSE_RES(BRU_PARSE_SUCCESS, stc_utf8_str_advance(&ps->ch));
             break;
     }
 
@@ -448,6 +448,7 @@ parse_quantifier(const BruParser *self,
 
         case BRU_LITERAL:
         case BRU_CC:
+        case BRU_BYTES:
         case BRU_ALT:
         case BRU_CONCAT:
         case BRU_CAPTURE:
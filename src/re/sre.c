@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -8,8 +9,24 @@
 #define BUF              512
 #define INTERVAL_MAX_BUF 26
 
+#define UTF8_MAX_NBYTES   4
+#define UNICODE_MAX       0x10ffff
+#define UNICODE_MAX_ASCII 0x7f
+
 static void
 regex_print_tree_indent(FILE *stream, const BruRegexNode *re, int indent);
+static int regex_literal_prefix(const BruRegexNode *re,
+                                char              **prefix,
+                                size_t             *len,
+                                size_t             *alloc);
+static BruRegexNode *regex_literal_to_bytes(BruRegexNode *re);
+static BruRegexNode *regex_cc_to_bytes(BruRegexNode *re);
+static BruRegexNode *regex_utf8_range(uint32_t lbound, uint32_t ubound);
+static BruRegexNode *regex_alt(BruRegexNode *left, BruRegexNode *right);
+static BruCodepointRange *intervals_to_ranges(const BruIntervals *intervals,
+                                              size_t             *len);
+static int                codepoint_range_cmp(const void *a, const void *b);
+static int           utf8_encode(uint32_t codepoint, unsigned char *bytes);
 
 /* --- BruInterval ---------------------------------------------------------- */
 
@@ -100,6 +117,66 @@ char *bru_intervals_to_str(const BruIntervals *self)
     return s;
 }
 
+/* --- BruIntervalsTable ---------------------------------------------------- */
+
+BruIntervalsTable *bru_intervals_table_new(const BruIntervals *intervals)
+{
+    BruIntervalsTable *table;
+    BruCodepointRange *ranges;
+    uint32_t           codepoint;
+    size_t             i, n, len;
+
+    ranges = intervals_to_ranges(intervals, &n);
+    // the ranges are sorted, so the ones above Latin-1 are at the end
+    for (i = len = 0; i < n; i++)
+        if (ranges[i].ubound >= BRU_INTERVALS_TABLE_NLATIN1) len++;
+
+    table = malloc(sizeof(*table) + len * sizeof(*table->ranges));
+    memset(table->latin1, 0, sizeof(table->latin1));
+    table->len = len;
+    for (i = 0; i < n && ranges[i].lbound < BRU_INTERVALS_TABLE_NLATIN1; i++) {
+        for (codepoint = ranges[i].lbound;
+             codepoint <= ranges[i].ubound &&
+             codepoint < BRU_INTERVALS_TABLE_NLATIN1;
+             codepoint++)
+            table->latin1[codepoint >> 6] |= (uint64_t) 1 << (codepoint & 63);
+    }
+    memcpy(table->ranges, ranges + n - len, len * sizeof(*table->ranges));
+    if (len > 0 && table->ranges[0].lbound < BRU_INTERVALS_TABLE_NLATIN1)
+        table->ranges[0].lbound = BRU_INTERVALS_TABLE_NLATIN1;
+    free(ranges);
+
+    return table;
+}
+
+void bru_intervals_table_free(BruIntervalsTable *self) { free(self); }
+
+size_t bru_intervals_table_size(const BruIntervalsTable *self)
+{
+    return sizeof(*self) + self->len * sizeof(*self->ranges);
+}
+
+int bru_intervals_table_lookup(const BruIntervalsTable *self,
+                               uint32_t                 codepoint)
+{
+    size_t lo = 0, hi = self->len, mid;
+
+    if (codepoint < BRU_INTERVALS_TABLE_NLATIN1)
+        return bru_intervals_table_latin1(self, codepoint);
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (codepoint < self->ranges[mid].lbound)
+            hi = mid;
+        else if (codepoint > self->ranges[mid].ubound)
+            lo = mid + 1;
+        else
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
 /* --- BruRegex ------------------------------------------------------------- */
 
 BruRegexNode *bru_regex_new(BruRegexType type)
@@ -137,6 +214,18 @@ BruRegexNode *bru_regex_cc(BruIntervals *intervals)
     return re;
 }
 
+BruRegexNode *bru_regex_bytes(unsigned char lbyte, unsigned char ubyte)
+{
+    BruRegexNode *re = malloc(sizeof(*re));
+
+    re->type     = BRU_BYTES;
+    re->lbyte    = lbyte;
+    re->ubyte    = ubyte;
+    re->nullable = FALSE;
+
+    return re;
+}
+
 BruRegexNode *
 bru_regex_branch(BruRegexType type, BruRegexNode *left, BruRegexNode *right)
 {
@@ -228,6 +317,7 @@ void bru_regex_node_free(BruRegexNode *self)
         case BRU_DOLLAR:  /* fallthrough */
         // case BRU_MEMOISE: /* fallthrough */
         case BRU_LITERAL: /* fallthrough */
+        case BRU_BYTES:   /* fallthrough */
         case BRU_BACKREFERENCE: break;
 
         case BRU_CC: bru_intervals_free(self->intervals); break;
@@ -261,6 +351,7 @@ BruRegexNode *bru_regex_clone(const BruRegexNode *self)
         case BRU_DOLLAR:  /* fallthrough */
         // case BRU_MEMOISE: /* fallthrough */
         case BRU_LITERAL: /* fallthrough */
+        case BRU_BYTES:   /* fallthrough */
         case BRU_BACKREFERENCE: break;
 
         case BRU_CC:
@@ -291,6 +382,339 @@ void bru_regex_print_tree(const BruRegexNode *self, FILE *stream)
     fputc('\n', stream);
 }
 
+char *bru_regex_literal_prefix(const BruRegexNode *self, size_t *len)
+{
+    size_t alloc  = BUF;
+    char  *prefix = malloc(alloc * sizeof(char));
+
+    *len = 0;
+    if (self) regex_literal_prefix(self, &prefix, len, &alloc);
+    if (*len == 0) {
+        free(prefix);
+        prefix = NULL;
+    }
+
+    return prefix;
+}
+
+BruRegexNode *bru_regex_to_bytes(BruRegexNode *self)
+{
+    if (!self) return self;
+
+    switch (self->type) {
+        case BRU_LITERAL: return regex_literal_to_bytes(self);
+        case BRU_CC: return regex_cc_to_bytes(self);
+
+        case BRU_ALT: /* fallthrough */
+        case BRU_CONCAT:
+            self->left  = bru_regex_to_bytes(self->left);
+            self->right = bru_regex_to_bytes(self->right);
+            break;
+
+        case BRU_CAPTURE: /* fallthrough */
+        case BRU_STAR:    /* fallthrough */
+        case BRU_PLUS:    /* fallthrough */
+        case BRU_QUES:    /* fallthrough */
+        case BRU_COUNTER: /* fallthrough */
+        case BRU_LOOKAHEAD: self->left = bru_regex_to_bytes(self->left); break;
+
+        default: break;
+    }
+
+    return self;
+}
+
+BruRegexNode *bru_regex_strip_captures(BruRegexNode *self)
+{
+    BruRegexNode *child;
+
+    if (!self) return self;
+
+    switch (self->type) {
+        case BRU_CAPTURE:
+            child = self->left;
+            free(self);
+            return bru_regex_strip_captures(child);
+
+        case BRU_ALT: /* fallthrough */
+        case BRU_CONCAT:
+            self->left  = bru_regex_strip_captures(self->left);
+            self->right = bru_regex_strip_captures(self->right);
+            break;
+
+        case BRU_STAR:    /* fallthrough */
+        case BRU_PLUS:    /* fallthrough */
+        case BRU_QUES:    /* fallthrough */
+        case BRU_COUNTER: /* fallthrough */
+        case BRU_LOOKAHEAD:
+            self->left = bru_regex_strip_captures(self->left);
+            break;
+
+        default: break;
+    }
+
+    return self;
+}
+
+/**
+ * Append the literal prefix of the regex tree to the prefix.
+ *
+ * @param[in]     re     the regex node
+ * @param[in,out] prefix the literal prefix
+ * @param[in,out] len    the number of bytes in the literal prefix
+ * @param[in,out] alloc  the number of bytes allocated for the literal prefix
+ *
+ * @return truthy value if every match of the regex node is the literal
+ *         appended to the prefix; else 0
+ */
+static int regex_literal_prefix(const BruRegexNode *re,
+                                char              **prefix,
+                                size_t             *len,
+                                size_t             *alloc)
+{
+    int nbytes;
+
+    switch (re->type) {
+        case BRU_EPSILON: return TRUE;
+
+        case BRU_LITERAL:
+            nbytes = stc_utf8_nbytes(re->ch);
+            BRU_ENSURE_SPACE(*prefix, *len + nbytes, *alloc, sizeof(char));
+            memcpy(*prefix + *len, re->ch, nbytes);
+            *len += nbytes;
+            return TRUE;
+
+        case BRU_CONCAT:
+            return regex_literal_prefix(re->left, prefix, len, alloc) &&
+                   regex_literal_prefix(re->right, prefix, len, alloc);
+
+        case BRU_CAPTURE:
+            return regex_literal_prefix(re->left, prefix, len, alloc);
+
+        // the child must match at least once, but may be followed by more
+        case BRU_PLUS:
+            regex_literal_prefix(re->left, prefix, len, alloc);
+            break;
+        case BRU_COUNTER:
+            if (re->min > 0) regex_literal_prefix(re->left, prefix, len, alloc);
+            break;
+
+        default: break;
+    }
+
+    return FALSE;
+}
+
+/**
+ * Lower a literal regex node to the concatenation of the bytes of its UTF-8
+ * encoding.
+ *
+ * @param[in] re the literal regex node (freed by this function)
+ *
+ * @return the regex tree matching the bytes of the literal
+ */
+static BruRegexNode *regex_literal_to_bytes(BruRegexNode *re)
+{
+    BruRegexNode *bytes;
+    int           i = stc_utf8_nbytes(re->ch) - 1;
+
+    bytes = bru_regex_bytes(re->ch[i], re->ch[i]);
+    for (i--; i >= 0; i--)
+        bytes = bru_regex_branch(
+            BRU_CONCAT, bru_regex_bytes(re->ch[i], re->ch[i]), bytes);
+    bytes->rid = re->rid;
+    bru_regex_node_free(re);
+
+    return bytes;
+}
+
+/**
+ * Lower a character class regex node to an alternation of byte range
+ * sequences matching exactly the UTF-8 encodings of the codepoints in the
+ * class.
+ *
+ * @param[in] re the character class regex node (freed by this function)
+ *
+ * @return the regex tree matching the bytes of the character class
+ */
+static BruRegexNode *regex_cc_to_bytes(BruRegexNode *re)
+{
+    BruCodepointRange *ranges;
+    BruRegexNode      *bytes = NULL;
+    size_t             i, n;
+
+    ranges = intervals_to_ranges(re->intervals, &n);
+    for (i = 0; i < n; i++)
+        bytes = regex_alt(bytes,
+                          regex_utf8_range(ranges[i].lbound, ranges[i].ubound));
+    free(ranges);
+
+    // an empty class matches nothing, which an empty byte range represents
+    if (!bytes) bytes = bru_regex_bytes(1, 0);
+    bytes->rid = re->rid;
+    bru_regex_node_free(re);
+
+    return bytes;
+}
+
+/**
+ * Construct the regex tree matching the UTF-8 encodings of a range of
+ * codepoints.
+ *
+ * The range is split until every piece has encodings of the same length that
+ * only differ in the bytes where the piece spans all continuation bytes, so
+ * each piece is a sequence of byte ranges.
+ *
+ * @param[in] lbound the lower codepoint of the range
+ * @param[in] ubound the upper codepoint of the range
+ *
+ * @return the regex tree matching the range of codepoints
+ */
+static BruRegexNode *regex_utf8_range(uint32_t lbound, uint32_t ubound)
+{
+    static const uint32_t max_codepoints[] = { 0x7f, 0x7ff, 0xffff };
+
+    unsigned char lbytes[UTF8_MAX_NBYTES], ubytes[UTF8_MAX_NBYTES];
+    BruRegexNode *bytes;
+    uint32_t      mask;
+    int           i, n;
+
+    // split where the number of bytes in the encoding changes
+    for (i = 0; i < UTF8_MAX_NBYTES - 1; i++)
+        if (lbound <= max_codepoints[i] && max_codepoints[i] < ubound)
+            return regex_alt(regex_utf8_range(lbound, max_codepoints[i]),
+                             regex_utf8_range(max_codepoints[i] + 1, ubound));
+
+    if (ubound <= UNICODE_MAX_ASCII) return bru_regex_bytes(lbound, ubound);
+
+    // split where the range does not cover all of the trailing bytes
+    for (i = 1; i < UTF8_MAX_NBYTES; i++) {
+        mask = ((uint32_t) 1 << (6 * i)) - 1;
+        if ((lbound & ~mask) == (ubound & ~mask)) continue;
+
+        if ((lbound & mask) != 0)
+            return regex_alt(regex_utf8_range(lbound, lbound | mask),
+                             regex_utf8_range((lbound | mask) + 1, ubound));
+        if ((ubound & mask) != mask)
+            return regex_alt(regex_utf8_range(lbound, (ubound & ~mask) - 1),
+                             regex_utf8_range(ubound & ~mask, ubound));
+    }
+
+    n = utf8_encode(lbound, lbytes);
+    utf8_encode(ubound, ubytes);
+    bytes = bru_regex_bytes(lbytes[n - 1], ubytes[n - 1]);
+    for (i = n - 2; i >= 0; i--)
+        bytes = bru_regex_branch(BRU_CONCAT,
+                                 bru_regex_bytes(lbytes[i], ubytes[i]), bytes);
+
+    return bytes;
+}
+
+/**
+ * Convert a collection of intervals to the sorted and disjoint ranges of the
+ * codepoints it matches, applying its negation.
+ *
+ * @param[in]  intervals the collection of intervals
+ * @param[out] len       the number of ranges
+ *
+ * @return the ranges of the codepoints matched by the collection of intervals
+ */
+static BruCodepointRange *intervals_to_ranges(const BruIntervals *intervals,
+                                              size_t             *len)
+{
+    const BruInterval *interval;
+    BruCodepointRange *ranges;
+    uint32_t           lbound, ubound;
+    size_t             i, n;
+
+    // the complement of n disjoint ranges has at most n + 1 ranges
+    ranges = malloc((intervals->len + 1) * sizeof(*ranges));
+    for (i = 0; i < intervals->len; i++) {
+        interval         = intervals->intervals + i;
+        ranges[i].lbound = stc_utf8_to_codepoint(interval->lbound);
+        ranges[i].ubound = stc_utf8_to_codepoint(interval->ubound);
+    }
+    qsort(ranges, intervals->len, sizeof(*ranges), codepoint_range_cmp);
+    for (i = n = 0; i < intervals->len; i++) {
+        if (n > 0 && ranges[i].lbound <= ranges[n - 1].ubound + 1) {
+            if (ranges[i].ubound > ranges[n - 1].ubound)
+                ranges[n - 1].ubound = ranges[i].ubound;
+        } else if (ranges[i].lbound <= ranges[i].ubound) {
+            ranges[n++] = ranges[i];
+        }
+    }
+
+    if (intervals->neg) {
+        // each gap is written before the range it ends at is overwritten
+        for (i = 0, lbound = 0, *len = 0; i < n; i++) {
+            ubound = ranges[i].ubound;
+            if (ranges[i].lbound > lbound)
+                ranges[(*len)++] =
+                    (BruCodepointRange){ lbound, ranges[i].lbound - 1 };
+            lbound = ubound + 1;
+        }
+        if (lbound <= UNICODE_MAX)
+            ranges[(*len)++] = (BruCodepointRange){ lbound, UNICODE_MAX };
+    } else {
+        *len = n;
+    }
+
+    return ranges;
+}
+
+/**
+ * Construct the alternation of two regex trees, where a missing left tree is
+ * treated as matching nothing.
+ *
+ * @param[in] left  the left regex tree (or NULL)
+ * @param[in] right the right regex tree
+ *
+ * @return the alternation of the regex trees
+ */
+static BruRegexNode *regex_alt(BruRegexNode *left, BruRegexNode *right)
+{
+    return left ? bru_regex_branch(BRU_ALT, left, right) : right;
+}
+
+static int codepoint_range_cmp(const void *a, const void *b)
+{
+    uint32_t x = ((const BruCodepointRange *) a)->lbound,
+             y = ((const BruCodepointRange *) b)->lbound;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * Encode a codepoint in UTF-8.
+ *
+ * @param[in]  codepoint the codepoint to encode
+ * @param[out] bytes     the bytes of the encoding
+ *
+ * @return the number of bytes in the encoding
+ */
+static int utf8_encode(uint32_t codepoint, unsigned char *bytes)
+{
+    if (codepoint <= 0x7f) {
+        bytes[0] = codepoint;
+        return 1;
+    } else if (codepoint <= 0x7ff) {
+        bytes[0] = 0xc0 | (codepoint >> 6);
+        bytes[1] = 0x80 | (codepoint & 0x3f);
+        return 2;
+    } else if (codepoint <= 0xffff) {
+        bytes[0] = 0xe0 | (codepoint >> 12);
+        bytes[1] = 0x80 | ((codepoint >> 6) & 0x3f);
+        bytes[2] = 0x80 | (codepoint & 0x3f);
+        return 3;
+    }
+
+    bytes[0] = 0xf0 | (codepoint >> 18);
+    bytes[1] = 0x80 | ((codepoint >> 12) & 0x3f);
+    bytes[2] = 0x80 | ((codepoint >> 6) & 0x3f);
+    bytes[3] = 0x80 | (codepoint & 0x3f);
+    return 4;
+}
+
 static void
 regex_print_tree_indent(FILE *stream, const BruRegexNode *re, int indent)
 {
@@ -318,6 +742,10 @@ regex_print_tree_indent(FILE *stream, const BruRegexNode *re, int indent)
             free(p);
             break;
 
+        case BRU_BYTES:
+            fprintf(stream, "Bytes(\\x%02x, \\x%02x)", re->lbyte, re->ubyte);
+            break;
+
         case BRU_ALT: fputs("Alternation", stream); goto concat_body;
         case BRU_CONCAT:
             fputs("Concatenation", stream);
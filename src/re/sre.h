@@ -2,6 +2,7 @@
 #define BRU_RE_SRE_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include "../stc/util/utf.h"
@@ -21,6 +22,19 @@ typedef struct {
     BruInterval intervals[]; /**< array of underlying intervals               */
 } BruIntervals;
 
+#define BRU_INTERVALS_TABLE_NLATIN1 256
+
+typedef struct {
+    uint32_t lbound; /**< lower codepoint of the range                        */
+    uint32_t ubound; /**< upper codepoint of the range                        */
+} BruCodepointRange;
+
+typedef struct {
+    uint64_t latin1[BRU_INTERVALS_TABLE_NLATIN1 / 64]; /**< bitmap below 256  */
+    size_t   len;               /**< number of ranges above Latin-1           */
+    BruCodepointRange ranges[]; /**< sorted and disjoint ranges above Latin-1 */
+} BruIntervalsTable;
+
 typedef enum {
     BRU_EPSILON,
     BRU_CARET,
@@ -28,6 +42,7 @@ typedef enum {
     // BRU_MEMOISE,
     BRU_LITERAL,
     BRU_CC,
+    BRU_BYTES,
     BRU_ALT,
     BRU_CONCAT,
     BRU_CAPTURE,
@@ -56,6 +71,11 @@ struct bru_regex_node {
         const char   *ch;        /**< UTF-8 encoded "character" for literals  */
         BruIntervals *intervals; /**< intervals for character classes         */
         BruRegexNode *left;      /**< left or only child for operators        */
+
+        struct {
+            unsigned char lbyte; /**< lower bound for byte ranges             */
+            unsigned char ubyte; /**< upper bound for byte ranges             */
+        };
     };
 
     union {
@@ -75,8 +95,12 @@ struct bru_regex_node {
      !defined(BRU_RE_DISABLE_SHORT_NAMES) &&    \
          (defined(BRU_RE_ENABLE_SHORT_NAMES) || \
           defined(BRU_ENABLE_SHORT_NAMES)))
-typedef BruInterval  Interval;
-typedef BruIntervals Intervals;
+typedef BruInterval       Interval;
+typedef BruIntervals      Intervals;
+typedef BruCodepointRange CodepointRange;
+typedef BruIntervalsTable IntervalsTable;
+
+#    define INTERVALS_TABLE_NLATIN1 BRU_INTERVALS_TABLE_NLATIN1
 
 typedef BruRegexType RegexType;
 #    define EPSILON       BRU_EPSILON
@@ -85,6 +109,7 @@ typedef BruRegexType RegexType;
 // #    define MEMOISE       BRU_MEMOISE
 #    define LITERAL       BRU_LITERAL
 #    define CC            BRU_CC
+#    define BYTES         BRU_BYTES
 #    define ALT           BRU_ALT
 #    define CONCAT        BRU_CONCAT
 #    define CAPTURE       BRU_CAPTURE
@@ -115,18 +140,29 @@ typedef BruRegexNode RegexNode;
 #    define intervals_predicate bru_intervals_predicate
 #    define intervals_to_str    bru_intervals_to_str
 
-#    define regex_new           bru_regex_new
-#    define regex_literal       bru_regex_literal
-#    define regex_cc            bru_regex_cc
-#    define regex_branch        bru_regex_branch
-#    define regex_capture       bru_regex_capture
-#    define regex_backreference bru_regex_backreference
-#    define regex_repetition    bru_regex_repetition
-#    define regex_counter       bru_regex_counter
-#    define regex_lookahead     bru_regex_lookahead
-#    define regex_node_free     bru_regex_node_free
-#    define regex_clone         bru_regex_clone
-#    define regex_print_tree    bru_regex_print_tree
+#    define intervals_table_new       bru_intervals_table_new
+#    define intervals_table_free      bru_intervals_table_free
+#    define intervals_table_size      bru_intervals_table_size
+#    define intervals_table_latin1    bru_intervals_table_latin1
+#    define intervals_table_lookup    bru_intervals_table_lookup
+#    define intervals_table_predicate bru_intervals_table_predicate
+
+#    define regex_new            bru_regex_new
+#    define regex_literal        bru_regex_literal
+#    define regex_cc             bru_regex_cc
+#    define regex_bytes          bru_regex_bytes
+#    define regex_branch         bru_regex_branch
+#    define regex_capture        bru_regex_capture
+#    define regex_backreference  bru_regex_backreference
+#    define regex_repetition     bru_regex_repetition
+#    define regex_counter        bru_regex_counter
+#    define regex_lookahead      bru_regex_lookahead
+#    define regex_node_free      bru_regex_node_free
+#    define regex_clone          bru_regex_clone
+#    define regex_print_tree     bru_regex_print_tree
+#    define regex_literal_prefix bru_regex_literal_prefix
+#    define regex_to_bytes       bru_regex_to_bytes
+#    define regex_strip_captures bru_regex_strip_captures
 #endif /* BRU_RE_SRE_ENABLE_SHORT_NAMES */
 
 #define BRU_IS_UNARY_OP(type)                                          \
@@ -211,6 +247,75 @@ int bru_intervals_predicate(const BruIntervals *self, const char *ch);
  */
 char *bru_intervals_to_str(const BruIntervals *self);
 
+/* --- BruIntervalsTable function prototypes -------------------------------- */
+
+/**
+ * Check whether an ASCII or Latin-1 codepoint is in the bitmap of a lookup
+ * table for a collection of intervals.
+ *
+ * @param[in] table     the lookup table
+ * @param[in] codepoint the codepoint below 256 to check
+ */
+#define bru_intervals_table_latin1(table, codepoint)           \
+    ((int) (((table)->latin1[(unsigned char) (codepoint) >> 6] \
+             >> ((unsigned char) (codepoint) & 63)) &          \
+            1))
+
+/**
+ * Evaluate the predicate represented by a lookup table for a collection of
+ * intervals.
+ *
+ * ASCII characters are a single bit test without decoding the UTF-8 encoding.
+ *
+ * @param[in] table the lookup table
+ * @param[in] ch    the UTF-8 encoded "character" to evaluate against
+ */
+#define bru_intervals_table_predicate(table, ch)       \
+    ((unsigned char) *(ch) < 0x80                      \
+         ? bru_intervals_table_latin1(table, *(ch))    \
+         : bru_intervals_table_lookup(table, stc_utf8_to_codepoint(ch)))
+
+/**
+ * Construct the lookup table for a collection of intervals.
+ *
+ * The table is a bitmap for the codepoints below 256 and the sorted, merged
+ * ranges of the codepoints above them, with the negation of the intervals
+ * already applied, so that evaluating the predicate is a bit test or a binary
+ * search.
+ *
+ * @param[in] intervals the collection of intervals
+ *
+ * @return the lookup table for the collection of intervals
+ */
+BruIntervalsTable *bru_intervals_table_new(const BruIntervals *intervals);
+
+/**
+ * Free the memory allocated for the lookup table.
+ *
+ * @param[in] self the lookup table to free
+ */
+void bru_intervals_table_free(BruIntervalsTable *self);
+
+/**
+ * Get the number of bytes of a lookup table, including its ranges.
+ *
+ * @param[in] self the lookup table
+ *
+ * @return the number of bytes of the lookup table
+ */
+size_t bru_intervals_table_size(const BruIntervalsTable *self);
+
+/**
+ * Check whether a codepoint is matched by a lookup table.
+ *
+ * @param[in] self      the lookup table
+ * @param[in] codepoint the codepoint to check
+ *
+ * @return truthy value if the codepoint is matched by the lookup table; else 0
+ */
+int bru_intervals_table_lookup(const BruIntervalsTable *self,
+                               uint32_t                 codepoint);
+
 /* --- BruRegex function prototypes ----------------------------------------- */
 
 /**
@@ -240,6 +345,16 @@ BruRegexNode *bru_regex_literal(const char *ch);
  */
 BruRegexNode *bru_regex_cc(BruIntervals *intervals);
 
+/**
+ * Construct a regex byte range node matching a single byte in given bounds.
+ *
+ * @param[in] lbyte the lower bound of the byte range
+ * @param[in] ubyte the upper bound of the byte range
+ *
+ * @return the regex byte range node
+ */
+BruRegexNode *bru_regex_bytes(unsigned char lbyte, unsigned char ubyte);
+
 /**
  * Construct a regex branch node with given type (ALT or CONCAT) and given
  * children.
@@ -337,4 +452,45 @@ BruRegexNode *bru_regex_clone(const BruRegexNode *self);
  */
 void bru_regex_print_tree(const BruRegexNode *self, FILE *stream);
 
+/**
+ * Get the literal prefix that every match of the regex tree must start with.
+ *
+ * The returned string is created with a call to `malloc` and is not
+ * NUL-terminated.
+ *
+ * @param[in]  self the root node of the regex tree
+ * @param[out] len  the number of bytes in the literal prefix
+ *
+ * @return the literal prefix if there is a non-empty one; else NULL
+ */
+char *bru_regex_literal_prefix(const BruRegexNode *self, size_t *len);
+
+/**
+ * Lower the literals and character classes of a regex tree to byte ranges over
+ * their UTF-8 encodings, so the regex can be matched one byte at a time.
+ *
+ * Literals become concatenations of single bytes, and character classes
+ * become alternations of concatenations of byte ranges (as in RE2 and Rust's
+ * regex), one for each run of codepoints sharing the same encoding prefix.
+ *
+ * NOTE: The given regex tree is consumed by this function.
+ *
+ * @param[in] self the root node of the regex tree
+ *
+ * @return the root node of the lowered regex tree
+ */
+BruRegexNode *bru_regex_to_bytes(BruRegexNode *self);
+
+/**
+ * Replace every capture group of a regex tree by the regex it captures, for
+ * when only whether the regex matches is needed.
+ *
+ * NOTE: The given regex tree is consumed by this function.
+ *
+ * @param[in] self the root node of the regex tree
+ *
+ * @return the root node of the regex tree without capture groups
+ */
+BruRegexNode *bru_regex_strip_captures(BruRegexNode *self);
+
 #endif /* BRU_RE_SRE_H */
@@ -7,6 +7,7 @@
 #    define ENSURE_SPACE BRU_ENSURE_SPACE
 #    define PUSH         BRU_PUSH
 #    define STR_PUSH     BRU_STR_PUSH
+#    define ALIGN_UP     BRU_ALIGN_UP
 
 #    define DLL_INIT       BRU_DLL_INIT
 #    define DLL_FREE       BRU_DLL_FREE
@@ -17,6 +18,8 @@
 
 #define BRU_UNUSED(var) ((void) &var)
 
+#define BRU_ALIGN_UP(n, align) (((n) + (align) - 1) / (align) * (align))
+
 #define BRU_ENSURE_SPACE(arr, len, alloc, size)       \
     do {                                              \
         if ((len) >= (alloc)) {                       \
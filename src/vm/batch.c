@@ -0,0 +1,162 @@
+#if defined(__unix__) || defined(__APPLE__)
+#    define BATCH_PTHREADS
+// for `sysconf` with strict ISO C
+#    define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#ifdef BATCH_PTHREADS
+#    include <pthread.h>
+#    include <unistd.h>
+#endif /* BATCH_PTHREADS */
+
+#include "../utils.h"
+#include "batch.h"
+
+/** The number of consecutive input strings a worker claims at a time. */
+#define BATCH_CHUNK_LEN 64
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct {
+    const char *const *texts;     /**< the input strings to match against     */
+    const size_t      *text_lens; /**< the number of bytes of each string     */
+    size_t             ntexts;    /**< the number of input strings            */
+    bru_byte_t        *matched;   /**< whether each input string matched      */
+    atomic_size_t      next;      /**< the first input string not yet claimed */
+} BruBatchJob;
+
+typedef struct {
+    BruSRVM     *srvm;     /**< the SRVM owned by the worker                  */
+    BruBatchJob *job;      /**< the job the worker is working on              */
+    size_t       nmatched; /**< the number of strings the worker matched      */
+#ifdef BATCH_PTHREADS
+    pthread_t thread;  /**< the thread running the worker                     */
+    int       running; /**< whether the thread was started                    */
+#endif /* BATCH_PTHREADS */
+} BruBatchWorker;
+
+struct bru_batch {
+    BruBatchWorker *workers;  /**< the workers of the batch matcher           */
+    size_t          nworkers; /**< the number of workers                      */
+};
+
+/* --- Helper function prototypes ------------------------------------------- */
+
+static void *batch_worker_run(void *arg);
+
+/* --- API function definitions --------------------------------------------- */
+
+BruBatch *bru_batch_new(const BruProgram         *prog,
+                        size_t                    nworkers,
+                        BruSRVMDispatch           dispatch,
+                        bru_thread_manager_new_f *thread_manager_new,
+                        void                     *data)
+{
+    BruBatch *batch = malloc(sizeof(*batch));
+    size_t    i;
+#ifdef BATCH_PTHREADS
+    long nprocs;
+
+    if (nworkers == 0)
+        nworkers = (nprocs = sysconf(_SC_NPROCESSORS_ONLN)) > 0 ? nprocs : 1;
+#else
+    nworkers = 1;
+#endif /* BATCH_PTHREADS */
+
+    batch->nworkers = nworkers;
+    batch->workers  = malloc(nworkers * sizeof(*batch->workers));
+    for (i = 0; i < nworkers; i++)
+        batch->workers[i].srvm = bru_srvm_new(thread_manager_new(data, prog),
+                                              prog, dispatch);
+
+    return batch;
+}
+
+void bru_batch_free(BruBatch *self)
+{
+    size_t i;
+
+    if (!self) return;
+
+    for (i = 0; i < self->nworkers; i++) bru_srvm_free(self->workers[i].srvm);
+    free(self->workers);
+    free(self);
+}
+
+size_t bru_batch_nworkers(const BruBatch *self) { return self->nworkers; }
+
+size_t bru_batch_match(BruBatch          *self,
+                       const char *const *texts,
+                       const size_t      *text_lens,
+                       size_t             ntexts,
+                       bru_byte_t        *matched)
+{
+    BruBatchJob job;
+    size_t      i, nmatched = 0;
+
+    job.texts     = texts;
+    job.text_lens = text_lens;
+    job.ntexts    = ntexts;
+    job.matched   = matched;
+    atomic_init(&job.next, 0);
+
+    for (i = 0; i < self->nworkers; i++) {
+        self->workers[i].job      = &job;
+        self->workers[i].nmatched = 0;
+    }
+
+#ifdef BATCH_PTHREADS
+    // the calling thread is the first worker, and if a thread cannot be
+    // started the remaining chunks are claimed by the running workers instead
+    for (i = 1; i < self->nworkers; i++)
+        self->workers[i].running =
+            pthread_create(&self->workers[i].thread, NULL, batch_worker_run,
+                           self->workers + i) == 0;
+#endif /* BATCH_PTHREADS */
+
+    batch_worker_run(self->workers);
+    nmatched += self->workers[0].nmatched;
+
+#ifdef BATCH_PTHREADS
+    for (i = 1; i < self->nworkers; i++) {
+        if (!self->workers[i].running) continue;
+        pthread_join(self->workers[i].thread, NULL);
+        nmatched += self->workers[i].nmatched;
+    }
+#endif /* BATCH_PTHREADS */
+
+    return nmatched;
+}
+
+/* --- Helper function definitions ------------------------------------------ */
+
+/**
+ * Match the program of a worker against chunks of input strings of its job
+ * until every input string of the job has been claimed.
+ *
+ * @param[in] arg the worker
+ *
+ * @return NULL
+ */
+static void *batch_worker_run(void *arg)
+{
+    BruBatchWorker *worker = arg;
+    BruBatchJob    *job    = worker->job;
+    size_t          i, start, end;
+
+    while ((start = atomic_fetch_add(&job->next, BATCH_CHUNK_LEN)) <
+           job->ntexts) {
+        end = start + BATCH_CHUNK_LEN < job->ntexts ? start + BATCH_CHUNK_LEN
+                                                    : job->ntexts;
+        for (i = start; i < end; i++) {
+            job->matched[i] = bru_srvm_is_match_n(worker->srvm, job->texts[i],
+                                                  job->text_lens[i]) != 0;
+            if (job->matched[i]) worker->nmatched++;
+        }
+    }
+
+    return NULL;
+}
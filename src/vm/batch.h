@@ -0,0 +1,111 @@
+#ifndef BRU_VM_BATCH_H
+#define BRU_VM_BATCH_H
+
+#include <stddef.h>
+
+#include "program.h"
+#include "srvm.h"
+#include "thread_managers/thread_manager.h"
+
+/* --- Type definitions ----------------------------------------------------- */
+
+/**
+ * Construct the thread manager of a worker for executing the program.
+ *
+ * @param[in] data the data given to the batch matcher
+ * @param[in] prog the program the thread manager will execute
+ *
+ * @return the constructed thread manager
+ */
+typedef BruThreadManager *bru_thread_manager_new_f(void             *data,
+                                                   const BruProgram *prog);
+
+typedef struct bru_batch BruBatch;
+
+#if !defined(BRU_VM_BATCH_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_BATCH_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&      \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) ||   \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+typedef bru_thread_manager_new_f thread_manager_new_f;
+typedef BruBatch                 Batch;
+
+#    define batch_new      bru_batch_new
+#    define batch_free     bru_batch_free
+#    define batch_nworkers bru_batch_nworkers
+#    define batch_match    bru_batch_match
+#endif /* BRU_VM_BATCH_ENABLE_SHORT_NAMES */
+
+/* --- Batch function prototypes -------------------------------------------- */
+
+/**
+ * Construct a batch matcher which matches a program against many input strings
+ * in parallel over a pool of POSIX threads.
+ *
+ * Every worker owns its own SRVM and thread manager, constructed up front in
+ * the calling thread, while the program is shared read-only by all workers.
+ * The program must therefore not be modified or freed while the batch matcher
+ * is in use. On platforms without POSIX threads a single worker is used.
+ *
+ * @param[in] prog               the program to match with
+ * @param[in] nworkers           the number of workers (0 for one per online
+ *                               processor)
+ * @param[in] dispatch           how the SRVM of each worker dispatches
+ *                               instructions
+ * @param[in] thread_manager_new the constructor of the thread manager of each
+ *                               worker
+ * @param[in] data               the data to pass to `thread_manager_new`
+ *
+ * @return the constructed batch matcher
+ */
+BruBatch *bru_batch_new(const BruProgram         *prog,
+                        size_t                    nworkers,
+                        BruSRVMDispatch           dispatch,
+                        bru_thread_manager_new_f *thread_manager_new,
+                        void                     *data);
+
+/**
+ * Free the memory allocated for the batch matcher, including the SRVMs and
+ * thread managers of its workers (but not the program).
+ *
+ * @param[in] self the batch matcher to free
+ */
+void bru_batch_free(BruBatch *self);
+
+/**
+ * Get the number of workers of the batch matcher.
+ *
+ * @param[in] self the batch matcher
+ *
+ * @return the number of workers
+ */
+size_t bru_batch_nworkers(const BruBatch *self);
+
+/**
+ * Match the program of the batch matcher against every input string.
+ *
+ * The input strings are handed out to the workers in chunks of consecutive
+ * strings as the workers become free, and each result is written at the index
+ * of its input string, so the results are in the order of the input strings
+ * regardless of which worker matched them. The calling thread also works on
+ * the batch, and returns once every input string has been matched.
+ *
+ * The input strings do not need to be NUL-terminated and may contain NUL bytes,
+ * however they must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in]  self      the batch matcher
+ * @param[in]  texts     the input strings to match against
+ * @param[in]  text_lens the number of bytes in each input string
+ * @param[in]  ntexts    the number of input strings
+ * @param[out] matched   whether the program matched each input string, of
+ *                       length `ntexts`
+ *
+ * @return the number of input strings the program matched
+ */
+size_t bru_batch_match(BruBatch          *self,
+                       const char *const *texts,
+                       const size_t      *text_lens,
+                       size_t             ntexts,
+                       bru_byte_t        *matched);
+
+#endif /* BRU_VM_BATCH_H */
@@ -1,15 +1,19 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "../fa/constructions/glushkov.h"
 #include "../fa/constructions/thompson.h"
 #include "../fa/transformers/flatten.h"
 #include "../fa/transformers/memoisation.h"
+#include "../fa/transformers/reverse.h"
+#include "../fa/transformers/search.h"
 #include "../re/sre.h"
 #include "../utils.h"
 #include "compiler.h"
 
 #define COMPILER_OPTS_DEFAULT \
-    ((BruCompilerOpts){ BRU_THOMPSON, FALSE, BRU_CS_PCRE, BRU_MS_NONE, FALSE })
+    ((BruCompilerOpts){ BRU_THOMPSON, FALSE, BRU_CS_PCRE, BRU_MS_NONE, FALSE, \
+                        FALSE, FALSE })
 
 #define SET_OFFSET(p, pc) (*(p) = pc - (byte *) ((p) + 1))
 
@@ -43,14 +47,21 @@ void bru_compiler_free(BruCompiler *self)
 
 const BruProgram *bru_compiler_compile(const BruCompiler *self)
 {
-    BruRegex          re;
-    BruParseResult    res;
-    const BruProgram *prog;
-    BruStateMachine  *sm = NULL, *tmp = NULL;
+    BruRegex         re;
+    BruParseResult   res;
+    BruProgram      *prog;
+    BruStateMachine *sm = NULL, *tmp = NULL;
+    char            *prefix;
+    size_t           prefix_len;
 
     res = bru_parser_parse(self->parser, &re);
     if (res.code != BRU_PARSE_SUCCESS) return NULL;
 
+    prefix = bru_regex_literal_prefix(re.root, &prefix_len);
+    // without `save` instructions the threads need no memory for captures
+    if (self->opts.no_captures) re.root = bru_regex_strip_captures(re.root);
+    if (self->opts.byte_level) re.root = bru_regex_to_bytes(re.root);
+
     switch (self->opts.construction) {
         case BRU_THOMPSON: sm = bru_thompson_construct(re, &self->opts); break;
         case BRU_GLUSHKOV: sm = bru_glushkov_construct(re, &self->opts); break;
@@ -62,7 +73,17 @@ const BruProgram *bru_compiler_compile(const BruCompiler *self)
     }
     bru_regex_node_free(re.root);
 
-    if (self->opts.memo_scheme != BRU_MS_NONE)
+    if (self->opts.memo_scheme != BRU_MS_NONE &&
+        self->opts.memo_scheme != BRU_MS_IAR)
+        sm = bru_transform_memoise(sm, self->opts.memo_scheme,
+                                   self->parser->opts.logfile);
+
+    // compile in the implicit `.*?` loop for single-pass unanchored search
+    sm = bru_transform_search(sm, self->opts.byte_level);
+
+    // the implicit loop precedes every loop of the regex, so IAR must select
+    // states with it in place (the other schemes would memoise the loop itself)
+    if (self->opts.memo_scheme == BRU_MS_IAR)
         sm = bru_transform_memoise(sm, self->opts.memo_scheme,
                                    self->parser->opts.logfile);
 
@@ -73,6 +94,55 @@ const BruProgram *bru_compiler_compile(const BruCompiler *self)
     prog = bru_smir_compile_with_meta(
         sm, self->opts.mark_states ? compile_state_markers : NULL, NULL);
     bru_smir_free(sm);
+    prog->prefix              = prefix;
+    prog->prefix_len          = prefix_len;
+    prog->whole_match_capture = self->parser->opts.whole_match_capture;
+
+    return prog;
+}
+
+const BruProgram *bru_compiler_compile_reverse(const BruCompiler *self)
+{
+    BruRegex         re;
+    BruParseResult   res;
+    BruProgram      *prog;
+    BruStateMachine *sm = NULL, *tmp = NULL;
+    char            *regex;
+    size_t           len;
+
+    res = bru_parser_parse(self->parser, &re);
+    if (res.code != BRU_PARSE_SUCCESS) return NULL;
+
+    if (self->opts.byte_level) re.root = bru_regex_to_bytes(re.root);
+
+    switch (self->opts.construction) {
+        case BRU_THOMPSON: tmp = bru_thompson_construct(re, &self->opts); break;
+        case BRU_GLUSHKOV: tmp = bru_glushkov_construct(re, &self->opts); break;
+        case BRU_FLAT:
+            sm  = bru_thompson_construct(re, &self->opts);
+            tmp = bru_transform_flatten(sm, self->parser->opts.logfile);
+            bru_smir_free(sm);
+            break;
+    }
+    bru_regex_node_free(re.root);
+
+    // the reverse program is anchored at the end of a match, so it is compiled
+    // without the implicit `.*?` loop
+    sm = bru_transform_reverse(tmp);
+    bru_smir_free(tmp);
+
+#ifdef BRU_DEBUG
+    bru_smir_print(sm, stderr);
+#endif /* BRU_DEBUG */
+
+    prog = bru_smir_compile(sm);
+    bru_smir_free(sm);
+
+    // each program frees its regex, so the reverse program gets its own copy
+    len   = strlen(prog->regex) + 1;
+    regex = malloc(len * sizeof(char));
+    memcpy(regex, prog->regex, len * sizeof(char));
+    prog->regex = regex;
 
     return prog;
 }
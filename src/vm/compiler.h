@@ -28,6 +28,8 @@ typedef struct {
     BruCaptureSemantics capture_semantics; /**< capture semantics to use      */
     BruMemoScheme       memo_scheme;       /**< memoisation scheme to use     */
     int mark_states; /**< whether to compile state instructions               */
+    int byte_level;  /**< whether to compile to UTF-8 byte range instructions */
+    int no_captures; /**< whether to compile out the captures of the regex    */
 } BruCompilerOpts;
 
 typedef struct {
@@ -58,10 +60,11 @@ typedef BruMemoScheme MemoScheme;
 typedef BruCompilerOpts CompilerOpts;
 typedef BruCompiler     Compiler;
 
-#    define compiler_new     bru_compiler_new
-#    define compiler_default bru_compiler_default
-#    define compiler_free    bru_compiler_free
-#    define compiler_compile bru_compiler_compile
+#    define compiler_new             bru_compiler_new
+#    define compiler_default         bru_compiler_default
+#    define compiler_free            bru_compiler_free
+#    define compiler_compile         bru_compiler_compile
+#    define compiler_compile_reverse bru_compiler_compile_reverse
 #endif /* BRU_VM_COMPILER_ENABLE_SHORT_NAMES */
 
 /**
@@ -101,4 +104,19 @@ void bru_compiler_free(BruCompiler *self);
  */
 const BruProgram *bru_compiler_compile(const BruCompiler *self);
 
+/**
+ * Compile the regex tree obtained from the parser into a reverse program, which
+ * matches the reversal of every string the program matches.
+ *
+ * The reverse program is used to find the start of a match backwards from its
+ * end (see `bru_dfa_new_reverse`), so it is anchored, has no captures, and is
+ * only meant to be executed by the DFA.
+ *
+ * @param[in] self the compiler to compile
+ *
+ * @return the reverse program compiled from the regex tree obtained from the
+ *         parser
+ */
+const BruProgram *bru_compiler_compile_reverse(const BruCompiler *self);
+
 #endif /* BRU_VM_COMPILER_H */
@@ -0,0 +1,807 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../utils.h"
+#include "dfa.h"
+
+#define DFA_NASCII        128
+#define DFA_NBUCKETS_INIT 64
+#define DFA_NEPS_REGS     64
+
+#define DFA_EPS_BIT(k) ((uint64_t) 1 << (k))
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct bru_dfa_state BruDFAState;
+
+/** A thread being followed through epsilon transitions. */
+typedef struct {
+    size_t   off;    /**< offset of the instruction of the thread             */
+    uint64_t epsset; /**< `epsset` registers set without consuming input      */
+} BruDFAThread;
+
+/**
+ * A determinised state of the DFA.
+ *
+ * A state is the list of the offsets of the pending `char`, `pred`, `byte`,
+ * and `end` instructions in priority order. Instructions of lower priority than
+ * a match are never included, as the threads for them would be killed by the
+ * match, unless the DFA executes a reverse program for the longest match.
+ */
+struct bru_dfa_state {
+    BruDFAState *next[DFA_NASCII]; /**< cached transitions on ASCII bytes     */
+    BruDFAState *chain;            /**< next state in the same hash bucket    */
+    size_t       hash;             /**< hash of the instructions and match    */
+    int          is_match;         /**< whether a match ends at this state    */
+    int          has_end;          /**< whether an `end` instruction pending  */
+    size_t       ninsts;           /**< number of instructions in the state   */
+    size_t       insts[];          /**< offsets of the pending instructions   */
+};
+
+struct bru_dfa {
+    const BruProgram *program;  /**< the program of the DFA to execute        */
+    const char       *curr_sp;  /**< the SP to start the next search from     */
+    int matching_finished;      /**< flag to indicate matching is done        */
+    int byte_level; /**< whether the program consumes bytes, not codepoints   */
+    int reverse;    /**< whether the program is reversed, for longest match   */
+    int has_end;    /**< whether the program has reachable `end` instructions */
+
+    BruDFAState **buckets;    /**< hash table of the cached states            */
+    size_t        nbuckets;   /**< number of buckets in the hash table        */
+    size_t        nstates;    /**< number of cached states                    */
+    size_t        cache_used; /**< number of bytes used by the cached states  */
+    size_t        cache_size; /**< number of bytes the cached states may use  */
+    size_t        nflushes;   /**< number of times the cache has been flushed */
+    BruDFAState  *start[2];   /**< start state when not at/at start of input  */
+
+    size_t       *insts; /**< stc_vec of instructions of state being built    */
+    BruDFAThread *stack; /**< stc_vec of threads to follow through epsilons   */
+    BruDFAThread *seen_eps; /**< stc_vec of threads with `epsset` registers
+                                 visited in the current step                  */
+    size_t       *seen;  /**< generation each offset was last visited at      */
+    size_t        gen;   /**< generation of the current step                  */
+    FILE         *logfile; /**< the file for logging output                   */
+
+#ifdef BRU_BENCHMARK
+    size_t nstates_built; /**< the total number of states determinised        */
+#endif /* BRU_BENCHMARK */
+};
+
+/* --- Private function prototypes ------------------------------------------ */
+
+static BruDFA *
+dfa_new(const BruProgram *prog, size_t cache_size, FILE *logfile, int reverse);
+static int dfa_supported(BruDFA *self);
+static void dfa_begin_step(BruDFA *self);
+static int  dfa_visit(BruDFA *self, BruDFAThread thread);
+static int dfa_closure(BruDFA *self, size_t off, int at_begin, int at_end);
+static BruDFAState *dfa_start_state(BruDFA *self, int at_begin);
+static BruDFAState *dfa_step(BruDFA      *self,
+                             BruDFAState *state,
+                             const char  *sp,
+                             const char  *end);
+static int dfa_end_step(BruDFA *self, BruDFAState *state, int at_begin);
+static BruDFAState *dfa_cache_state(BruDFA *self, int is_match);
+static void         dfa_cache_flush(BruDFA *self);
+static void         dfa_cache_grow(BruDFA *self);
+static int dfa_run(BruDFA *self, const char *text, const char *text_end);
+static const char *
+dfa_scan(BruDFA *self, const char *text, const char *sp, const char *text_end);
+static const char *dfa_scan_reverse(BruDFA     *self,
+                                    const char *text,
+                                    const char *sp,
+                                    const char *match_end,
+                                    const char *text_end);
+
+/* --- API function definitions --------------------------------------------- */
+
+BruDFA *bru_dfa_new(const BruProgram *prog, size_t cache_size, FILE *logfile)
+{
+    return dfa_new(prog, cache_size, logfile, FALSE);
+}
+
+BruDFA *
+bru_dfa_new_reverse(const BruProgram *prog, size_t cache_size, FILE *logfile)
+{
+    return dfa_new(prog, cache_size, logfile, TRUE);
+}
+
+void bru_dfa_free(BruDFA *self)
+{
+#ifdef BRU_BENCHMARK
+    fprintf(self->logfile, "DFA STATES DETERMINISED: %zu\n",
+            self->nstates_built);
+    fprintf(self->logfile, "DFA CACHE FLUSHES: %zu\n", self->nflushes);
+#endif /* BRU_BENCHMARK */
+
+    dfa_cache_flush(self);
+    free(self->buckets);
+    stc_vec_free(self->insts);
+    stc_vec_free(self->stack);
+    stc_vec_free(self->seen_eps);
+    free(self->seen);
+    free(self);
+}
+
+int bru_dfa_match(BruDFA *self, const char *text)
+{
+    if (text == NULL) return 0;
+
+    return bru_dfa_match_n(self, text, strlen(text));
+}
+
+int bru_dfa_match_n(BruDFA *self, const char *text, size_t text_len)
+{
+    if (text == NULL) return 0;
+
+    self->curr_sp           = text;
+    self->matching_finished = FALSE;
+
+    return dfa_run(self, text, text + text_len);
+}
+
+int bru_dfa_find(BruDFA *self, const char *text)
+{
+    if (text == NULL) return 0;
+
+    return bru_dfa_find_n(self, text, strlen(text));
+}
+
+int bru_dfa_find_n(BruDFA *self, const char *text, size_t text_len)
+{
+    if (text == NULL) return 0;
+
+    if (self->curr_sp == NULL) {
+        self->curr_sp           = text;
+        self->matching_finished = FALSE;
+    }
+
+    return dfa_run(self, text, text + text_len);
+}
+
+const char *bru_dfa_match_end(BruDFA     *self,
+                              const char *text,
+                              const char *sp,
+                              const char *text_end)
+{
+    // every match starts with the literal prefix, so skip straight to it
+    if (!(sp = bru_program_find_prefix(self->program, sp, text_end)))
+        return NULL;
+
+    return dfa_scan(self, text, sp, text_end);
+}
+
+const char *bru_dfa_match_start(BruDFA     *self,
+                                const char *text,
+                                const char *sp,
+                                const char *match_end,
+                                const char *text_end)
+{
+    return dfa_scan_reverse(self, text, sp, match_end, text_end);
+}
+
+int bru_dfa_has_end(const BruDFA *self) { return self->has_end; }
+
+/* --- Private function definitions ----------------------------------------- */
+
+/**
+ * Construct a lazy DFA for the given program.
+ *
+ * @param[in] prog       the program for the DFA to execute
+ * @param[in] cache_size the number of bytes the cached states may use
+ * @param[in] logfile    the file for logging output
+ * @param[in] reverse    whether the program is reversed
+ *
+ * @return the constructed DFA if the program is supported; else NULL
+ */
+static BruDFA *
+dfa_new(const BruProgram *prog, size_t cache_size, FILE *logfile, int reverse)
+{
+    BruDFA *dfa = malloc(sizeof(*dfa));
+
+    dfa->program           = prog;
+    dfa->reverse           = reverse;
+    dfa->curr_sp           = NULL;
+    dfa->matching_finished = FALSE;
+    dfa->nbuckets          = DFA_NBUCKETS_INIT;
+    dfa->buckets    = calloc(dfa->nbuckets, sizeof(*dfa->buckets));
+    dfa->nstates    = 0;
+    dfa->cache_used = 0;
+    dfa->cache_size = cache_size;
+    dfa->nflushes   = 0;
+    dfa->start[0]   = NULL;
+    dfa->start[1]   = NULL;
+    stc_vec_default_init(dfa->insts);
+    stc_vec_default_init(dfa->stack);
+    stc_vec_default_init(dfa->seen_eps);
+    dfa->seen    = calloc(stc_vec_len(prog->insts), sizeof(*dfa->seen));
+    dfa->gen     = 0;
+    dfa->logfile = logfile;
+#ifdef BRU_BENCHMARK
+    dfa->nstates_built = 0;
+#endif /* BRU_BENCHMARK */
+
+    if (!dfa_supported(dfa)) {
+        bru_dfa_free(dfa);
+        return NULL;
+    }
+
+    return dfa;
+}
+
+/**
+ * Check that every instruction reachable in the program can be executed by the
+ * DFA.
+ *
+ * @param[in] self the DFA
+ *
+ * @return truthy value if the program is supported; else 0
+ */
+static int dfa_supported(BruDFA *self)
+{
+    const bru_byte_t *insts = self->program->insts, *pc;
+    BruDFAThread      thread = { 0, 0 };
+    bru_offset_t      x;
+    bru_len_t         k;
+    int               has_codepoints = FALSE;
+
+#define PUSH_OFF(p) \
+    (thread.off = (p) - insts, stc_vec_push_back(self->stack, thread))
+
+    self->byte_level = FALSE;
+    self->has_end    = FALSE;
+    dfa_begin_step(self);
+    stc_vec_clear(self->stack);
+    stc_vec_push_back(self->stack, thread);
+    while (!stc_vec_is_empty(self->stack)) {
+        thread = stc_vec_pop(self->stack);
+        if (!dfa_visit(self, thread)) continue;
+
+        pc = insts + thread.off;
+        switch (*pc++) {
+            case BRU_MATCH: break;
+
+            case BRU_END: self->has_end = TRUE; /* fallthrough */
+            case BRU_NOOP:
+            case BRU_BEGIN:
+            case BRU_STATE: PUSH_OFF(pc); break;
+
+            case BRU_CHAR:
+                has_codepoints = TRUE;
+                PUSH_OFF(pc + stc_utf8_nbytes(pc));
+                break;
+
+            case BRU_BYTE:
+                self->byte_level = TRUE;
+                PUSH_OFF(pc + 2 * sizeof(bru_byte_t));
+                break;
+
+            case BRU_EPSRESET:
+            case BRU_EPSSET:
+            case BRU_EPSCHK:
+                // the registers are tracked as bits of a mask
+                BRU_MEMREAD(k, pc, bru_len_t);
+                if (k >= DFA_NEPS_REGS) return FALSE;
+                PUSH_OFF(pc);
+                break;
+
+            case BRU_PRED: has_codepoints = TRUE; /* fallthrough */
+            case BRU_MEMO:
+            case BRU_SAVE: PUSH_OFF(pc + sizeof(bru_len_t)); break;
+
+            case BRU_JMP:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                PUSH_OFF(pc + x);
+                break;
+
+            case BRU_SPLIT:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                PUSH_OFF(pc + x);
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                PUSH_OFF(pc + x);
+                break;
+
+            case BRU_TSWITCH:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                for (; k > 0; k--) {
+                    BRU_MEMREAD(x, pc, bru_offset_t);
+                    PUSH_OFF(pc + x);
+                }
+                break;
+
+            default: return FALSE;
+        }
+    }
+#undef PUSH_OFF
+
+    // each step consumes either a codepoint or a byte, never a mix of both
+    return !(has_codepoints && self->byte_level);
+}
+
+/**
+ * Start a new step of the DFA, clearing the visited instructions and the
+ * state being built.
+ *
+ * @param[in] self the DFA
+ */
+static void dfa_begin_step(BruDFA *self)
+{
+    self->gen++;
+    stc_vec_clear(self->seen_eps);
+    stc_vec_clear(self->insts);
+}
+
+/**
+ * Mark a thread as visited in the current step.
+ *
+ * Threads are identified by their instruction and their `epsset` registers
+ * set without consuming input, as the registers decide the `epschk`
+ * instructions the thread passes.
+ *
+ * @param[in] self   the DFA
+ * @param[in] thread the thread to visit
+ *
+ * @return truthy value if the thread had not been visited before; else 0
+ */
+static int dfa_visit(BruDFA *self, BruDFAThread thread)
+{
+    size_t i, len;
+
+    if (thread.epsset == 0) {
+        if (self->seen[thread.off] == self->gen) return FALSE;
+        self->seen[thread.off] = self->gen;
+        return TRUE;
+    }
+
+    for (i = 0, len = stc_vec_len(self->seen_eps); i < len; i++)
+        if (self->seen_eps[i].off == thread.off &&
+            self->seen_eps[i].epsset == thread.epsset)
+            return FALSE;
+    stc_vec_push_back(self->seen_eps, thread);
+
+    return TRUE;
+}
+
+/**
+ * Follow the epsilon transitions from the instruction at the given offset,
+ * appending the pending instructions reached to the state being built in
+ * priority order.
+ *
+ * Threads already visited in the current step are not followed again, as the
+ * threads reaching them first have higher priority. A thread only fails an
+ * `epschk` if it set the register in the same step, as it has then not
+ * consumed any input since. For reverse programs the threads of lower priority
+ * than a match are still followed, as the longest match is wanted.
+ *
+ * @param[in] self     the DFA
+ * @param[in] off      the offset of the instruction to follow from
+ * @param[in] at_begin whether the SP is at the start of the input
+ * @param[in] at_end   whether the SP is at the end of the input
+ *
+ * @return truthy value if a match was reached; else 0
+ */
+static int dfa_closure(BruDFA *self, size_t off, int at_begin, int at_end)
+{
+    const bru_byte_t *insts  = self->program->insts, *pc, *next;
+    BruDFAThread      thread  = { off, 0 };
+    int               matched = FALSE;
+    bru_offset_t      x, y;
+    bru_len_t         k;
+
+#define PUSH_OFF(p) \
+    (thread.off = (p) - insts, stc_vec_push_back(self->stack, thread))
+
+    stc_vec_clear(self->stack);
+    stc_vec_push_back(self->stack, thread);
+    while (!stc_vec_is_empty(self->stack)) {
+        thread = stc_vec_pop(self->stack);
+        pc     = insts + thread.off;
+        // the registers do not matter once a thread stops following epsilons
+        if (*pc == BRU_CHAR || *pc == BRU_PRED || *pc == BRU_BYTE ||
+            *pc == BRU_END || *pc == BRU_MATCH)
+            thread.epsset = 0;
+        if (!dfa_visit(self, thread)) continue;
+
+        // push lower priority threads first so they are followed last
+        switch (*pc++) {
+            case BRU_MATCH:
+                if (!self->reverse) return TRUE;
+                matched = TRUE;
+                break;
+
+            case BRU_BEGIN:
+                if (at_begin) PUSH_OFF(pc);
+                break;
+
+            case BRU_END:
+                if (at_end)
+                    PUSH_OFF(pc);
+                else
+                    stc_vec_push_back(self->insts, thread.off);
+                break;
+
+            case BRU_CHAR:
+            case BRU_PRED:
+            case BRU_BYTE: stc_vec_push_back(self->insts, thread.off); break;
+
+            case BRU_NOOP:
+            case BRU_STATE: PUSH_OFF(pc); break;
+
+            // captures are not tracked by the DFA
+            case BRU_MEMO:
+            case BRU_SAVE: PUSH_OFF(pc + sizeof(bru_len_t)); break;
+
+            case BRU_EPSRESET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                thread.epsset &= ~DFA_EPS_BIT(k);
+                PUSH_OFF(pc);
+                break;
+
+            case BRU_EPSSET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                thread.epsset |= DFA_EPS_BIT(k);
+                PUSH_OFF(pc);
+                break;
+
+            case BRU_EPSCHK:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                if (!(thread.epsset & DFA_EPS_BIT(k))) PUSH_OFF(pc);
+                break;
+
+            case BRU_JMP:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                PUSH_OFF(pc + x);
+                break;
+
+            case BRU_SPLIT:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                next = pc + x;
+                BRU_MEMREAD(y, pc, bru_offset_t);
+                PUSH_OFF(pc + y);
+                PUSH_OFF(next);
+                break;
+
+            case BRU_TSWITCH:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                for (next = pc + k * sizeof(bru_offset_t); k > 0; k--) {
+                    next -= sizeof(bru_offset_t);
+                    x     = *(bru_offset_t *) next;
+                    PUSH_OFF(next + sizeof(bru_offset_t) + x);
+                }
+                break;
+        }
+    }
+#undef PUSH_OFF
+
+    return matched;
+}
+
+static BruDFAState *dfa_start_state(BruDFA *self, int at_begin)
+{
+    int is_match;
+
+    dfa_begin_step(self);
+    is_match = dfa_closure(self, 0, at_begin, FALSE);
+
+    return dfa_cache_state(self, is_match);
+}
+
+/**
+ * Determine the state reached from the given state by consuming the codepoint
+ * (or byte for byte-level programs) at the SP.
+ *
+ * NOTE: The cache may be flushed, in which case the given state is freed.
+ *
+ * @param[in] self  the DFA
+ * @param[in] state the state to step from
+ * @param[in] sp    the SP of the codepoint or byte to consume
+ * @param[in] end   the end of the text the codepoint must lie within
+ *
+ * @return the state reached
+ */
+static BruDFAState *dfa_step(BruDFA      *self,
+                             BruDFAState *state,
+                             const char  *sp,
+                             const char  *end)
+{
+    const BruProgram *prog = self->program;
+    const bru_byte_t *pc;
+    const char       *codepoint;
+    bru_len_t         k;
+    size_t            i;
+    int               is_match = FALSE;
+
+    dfa_begin_step(self);
+    for (i = 0; i < state->ninsts && !(is_match && !self->reverse); i++) {
+        pc = prog->insts + state->insts[i];
+        switch (*pc++) {
+            case BRU_CHAR:
+                BRU_CODEPOINTREAD(codepoint, pc);
+                if (BRU_CODEPOINT_IN_TEXT(sp, end) &&
+                    stc_utf8_cmp(codepoint, sp) == 0)
+                    is_match |=
+                        dfa_closure(self, pc - prog->insts, FALSE, FALSE);
+                break;
+
+            case BRU_PRED:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                if (BRU_CODEPOINT_IN_TEXT(sp, end) &&
+                    bru_intervals_table_predicate(BRU_PRED_TABLE(prog->aux, k),
+                                                  sp))
+                    is_match |=
+                        dfa_closure(self, pc - prog->insts, FALSE, FALSE);
+                break;
+
+            case BRU_BYTE:
+                if (BRU_BYTE_IN_RANGE(pc, *sp))
+                    is_match |= dfa_closure(
+                        self, pc + 2 * sizeof(bru_byte_t) - prog->insts, FALSE,
+                        FALSE);
+                break;
+
+            default: break; // `end` is not satisfied before the end of input
+        }
+    }
+
+    return dfa_cache_state(self, is_match);
+}
+
+/**
+ * Determine whether a match is reached from the `end` instructions of the
+ * given state at the end of the input.
+ *
+ * @param[in] self     the DFA
+ * @param[in] state    the state at the end of the input
+ * @param[in] at_begin whether the end of the input is also the start
+ *
+ * @return truthy value if a match was reached; else 0
+ */
+static int dfa_end_step(BruDFA *self, BruDFAState *state, int at_begin)
+{
+    size_t i, off;
+
+    dfa_begin_step(self);
+    for (i = 0; i < state->ninsts; i++) {
+        off = state->insts[i];
+        if (self->program->insts[off] == BRU_END &&
+            dfa_closure(self, off + 1, at_begin, TRUE))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ * Get the cached state for the instructions of the state being built, adding
+ * it to the cache if it is not there.
+ *
+ * NOTE: The cache is flushed if adding the state would exceed the cache size.
+ *
+ * @param[in] self     the DFA
+ * @param[in] is_match whether a match ends at the state
+ *
+ * @return the cached state
+ */
+static BruDFAState *dfa_cache_state(BruDFA *self, int is_match)
+{
+    size_t       i, hash = is_match, n = stc_vec_len(self->insts);
+    size_t       size = sizeof(BruDFAState) + n * sizeof(*self->insts);
+    BruDFAState *state;
+
+    // FNV-1a over the instruction offsets
+    for (i = 0; i < n; i++) hash = (hash ^ self->insts[i]) * 0x100000001b3ULL;
+
+    for (state = self->buckets[hash & (self->nbuckets - 1)]; state;
+         state = state->chain)
+        if (state->hash == hash && state->is_match == is_match &&
+            state->ninsts == n &&
+            memcmp(state->insts, self->insts, n * sizeof(*self->insts)) == 0)
+            return state;
+
+    if (self->nstates > 0 && self->cache_used + size > self->cache_size)
+        dfa_cache_flush(self);
+    if (self->nstates >= 2 * self->nbuckets) dfa_cache_grow(self);
+
+    state = malloc(size);
+    memset(state->next, 0, sizeof(state->next));
+    state->hash     = hash;
+    state->is_match = is_match;
+    state->has_end  = FALSE;
+    state->ninsts   = n;
+    for (i = 0; i < n; i++) {
+        state->insts[i] = self->insts[i];
+        if (self->program->insts[state->insts[i]] == BRU_END)
+            state->has_end = TRUE;
+    }
+
+    state->chain = self->buckets[hash & (self->nbuckets - 1)];
+    self->buckets[hash & (self->nbuckets - 1)] = state;
+    self->nstates++;
+    self->cache_used += size;
+#ifdef BRU_BENCHMARK
+    self->nstates_built++;
+#endif /* BRU_BENCHMARK */
+
+    return state;
+}
+
+static void dfa_cache_flush(BruDFA *self)
+{
+    BruDFAState *state, *chain;
+    size_t       i;
+
+    for (i = 0; i < self->nbuckets; i++) {
+        for (state = self->buckets[i]; state; state = chain) {
+            chain = state->chain;
+            free(state);
+        }
+        self->buckets[i] = NULL;
+    }
+
+    if (self->nstates) self->nflushes++;
+    self->nstates    = 0;
+    self->cache_used = 0;
+    self->start[0]   = NULL;
+    self->start[1]   = NULL;
+}
+
+static void dfa_cache_grow(BruDFA *self)
+{
+    BruDFAState **buckets = self->buckets, *state, *chain;
+    size_t        i, nbuckets = self->nbuckets;
+
+    self->nbuckets *= 2;
+    self->buckets   = calloc(self->nbuckets, sizeof(*self->buckets));
+    for (i = 0; i < nbuckets; i++) {
+        for (state = buckets[i]; state; state = chain) {
+            chain        = state->chain;
+            state->chain = self->buckets[state->hash & (self->nbuckets - 1)];
+            self->buckets[state->hash & (self->nbuckets - 1)] = state;
+        }
+    }
+    free(buckets);
+}
+
+static int dfa_run(BruDFA *self, const char *text, const char *text_end)
+{
+    const char *sp = self->curr_sp, *matched_sp;
+
+    if (self->matching_finished) return FALSE;
+
+    // every match starts with the literal prefix, so skip straight to it
+    if (!(sp = bru_program_find_prefix(self->program, sp, text_end))) {
+        self->matching_finished = TRUE;
+        return FALSE;
+    }
+    self->curr_sp = sp;
+    matched_sp    = dfa_scan(self, text, sp, text_end);
+
+    // an empty match can only be found after the current SP at the end of the
+    // input, so stop there to avoid reporting it twice
+    if (!matched_sp || matched_sp == text_end)
+        self->matching_finished = TRUE;
+    else
+        self->curr_sp = matched_sp != self->curr_sp
+                            ? matched_sp
+                            : stc_utf8_str_next(self->curr_sp);
+    // a codepoint cut short by the end of the input is skipped to the end
+    if (self->curr_sp > text_end) self->curr_sp = text_end;
+
+    return matched_sp != NULL;
+}
+
+/**
+ * Execute the DFA from the given SP until no instructions are pending.
+ *
+ * @param[in] self     the DFA to execute
+ * @param[in] text     the start of the input string
+ * @param[in] sp       the SP to start matching from
+ * @param[in] text_end the end of the input string
+ *
+ * @return the end of the leftmost match if one was found; else NULL
+ */
+static const char *
+dfa_scan(BruDFA *self, const char *text, const char *sp, const char *text_end)
+{
+    const char   *matched_sp = NULL;
+    BruDFAState  *state, *next;
+    unsigned char ch;
+    size_t        nflushes;
+    int           at_begin;
+
+    at_begin = sp == text;
+    if (!(state = self->start[at_begin]))
+        state = self->start[at_begin] = dfa_start_state(self, at_begin);
+
+    // the program starts with an implicit `.*?` loop, so a single pass from
+    // the current SP finds the leftmost match
+    for (;;) {
+        if (state->is_match) matched_sp = sp;
+        if (state->ninsts == 0) break;
+        if (sp >= text_end) {
+            if (sp == text_end && state->has_end &&
+                dfa_end_step(self, state, sp == text))
+                matched_sp = sp;
+            break;
+        }
+
+        ch = *sp;
+        if (ch < DFA_NASCII && (next = state->next[ch])) {
+            sp++;
+        } else {
+            nflushes = self->nflushes;
+            next     = dfa_step(self, state, sp, text_end);
+            // only ASCII transitions are cached, and only if the state
+            // stepped from has not been flushed
+            if (ch < DFA_NASCII && nflushes == self->nflushes)
+                state->next[ch] = next;
+            sp = self->byte_level ? sp + 1 : stc_utf8_str_next(sp);
+        }
+        state = next;
+    }
+
+    return matched_sp;
+}
+
+/**
+ * Execute the DFA of a reverse program backwards from the end of a match until
+ * no instructions are pending or the given SP is reached.
+ *
+ * The reverse program starts where the forward program ends, so its `begin`
+ * instructions hold at the end of the input and its `end` instructions at the
+ * start of the input, which is only reached if the given SP is the start.
+ *
+ * @param[in] self      the DFA to execute
+ * @param[in] text      the start of the input string
+ * @param[in] sp        the SP to not match back past
+ * @param[in] match_end the end of the match to match back from
+ * @param[in] text_end  the end of the input string
+ *
+ * @return the start of the longest match if one was found; else NULL
+ */
+static const char *dfa_scan_reverse(BruDFA     *self,
+                                    const char *text,
+                                    const char *sp,
+                                    const char *match_end,
+                                    const char *text_end)
+{
+    const char   *rsp = match_end, *prev_rsp, *matched_sp = NULL;
+    BruDFAState  *state, *next;
+    unsigned char ch;
+    size_t        nflushes;
+    int           at_begin;
+
+    at_begin = match_end == text_end;
+    if (!(state = self->start[at_begin]))
+        state = self->start[at_begin] = dfa_start_state(self, at_begin);
+
+    for (;;) {
+        if (state->is_match) matched_sp = rsp;
+        if (state->ninsts == 0) break;
+        if (rsp == sp) {
+            if (sp == text && state->has_end &&
+                dfa_end_step(self, state, text == text_end))
+                matched_sp = rsp;
+            break;
+        }
+
+        // step back to the start of the previous codepoint (or byte)
+        prev_rsp = rsp--;
+        if (!self->byte_level)
+            while (rsp > sp && ((unsigned char) *rsp & 0xC0) == 0x80) rsp--;
+
+        ch = *rsp;
+        if (ch < DFA_NASCII && (next = state->next[ch])) {
+            state = next;
+            continue;
+        }
+        nflushes = self->nflushes;
+        next     = dfa_step(self, state, rsp, prev_rsp);
+        if (ch < DFA_NASCII && nflushes == self->nflushes)
+            state->next[ch] = next;
+        state = next;
+    }
+
+    return matched_sp;
+}
@@ -0,0 +1,183 @@
+#ifndef BRU_VM_DFA_H
+#define BRU_VM_DFA_H
+
+#include <stdio.h>
+
+#include "program.h"
+
+/** Default number of bytes the DFA may use for cached states. */
+#define BRU_DFA_CACHE_SIZE_DEFAULT (1 << 21)
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct bru_dfa BruDFA;
+
+#if !defined(BRU_VM_DFA_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_DFA_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&    \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) || \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+typedef BruDFA DFA;
+
+#    define DFA_CACHE_SIZE_DEFAULT BRU_DFA_CACHE_SIZE_DEFAULT
+
+#    define dfa_new         bru_dfa_new
+#    define dfa_new_reverse bru_dfa_new_reverse
+#    define dfa_free        bru_dfa_free
+#    define dfa_match       bru_dfa_match
+#    define dfa_match_n     bru_dfa_match_n
+#    define dfa_find        bru_dfa_find
+#    define dfa_find_n      bru_dfa_find_n
+#    define dfa_match_end   bru_dfa_match_end
+#    define dfa_match_start bru_dfa_match_start
+#    define dfa_has_end     bru_dfa_has_end
+#endif /* BRU_VM_DFA_ENABLE_SHORT_NAMES */
+
+/* --- DFA function prototypes ---------------------------------------------- */
+
+/**
+ * Construct a lazy DFA for the given program.
+ *
+ * DFA states are determinised from the program on demand while matching, and
+ * cached along with the transitions between them. When the cached states use
+ * more than the given number of bytes, the cache is flushed and states are
+ * determinised again as needed.
+ *
+ * Only programs without counters, lookarounds, or lazy and greedy splits can
+ * be executed by the DFA. The DFA does not track captures, so capture
+ * instructions in the program are ignored.
+ *
+ * @param[in] prog       the program for the DFA to execute
+ * @param[in] cache_size the number of bytes the cached states may use
+ * @param[in] logfile    the file for logging output
+ *
+ * @return the constructed DFA if the program is supported; else NULL
+ */
+BruDFA *bru_dfa_new(const BruProgram *prog, size_t cache_size, FILE *logfile);
+
+/**
+ * Construct a lazy DFA for a reverse program, as compiled by
+ * `bru_compiler_compile_reverse`, which is executed backwards from the end of a
+ * match to find its start with `bru_dfa_match_start`.
+ *
+ * Unlike the forward DFA, the reverse DFA matches the longest string instead of
+ * following the priorities of the program, so that it finds the leftmost start
+ * of a match.
+ *
+ * @param[in] prog       the reverse program for the DFA to execute
+ * @param[in] cache_size the number of bytes the cached states may use
+ * @param[in] logfile    the file for logging output
+ *
+ * @return the constructed DFA if the program is supported; else NULL
+ */
+BruDFA *
+bru_dfa_new_reverse(const BruProgram *prog, size_t cache_size, FILE *logfile);
+
+/**
+ * Free the memory allocated for the DFA.
+ *
+ * @param[in] self the DFA to free
+ */
+void bru_dfa_free(BruDFA *self);
+
+/**
+ * Execute the DFA against an input string.
+ *
+ * @param[in] self the DFA to execute
+ * @param[in] text the input string to match against
+ *
+ * @return truthy value if the DFA matched against the input string; else 0
+ */
+int bru_dfa_match(BruDFA *self, const char *text);
+
+/**
+ * Execute the DFA against an input string of given length.
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in] self     the DFA to execute
+ * @param[in] text     the input string to match against
+ * @param[in] text_len the number of bytes in the input string
+ *
+ * @return truthy value if the DFA matched against the input string; else 0
+ */
+int bru_dfa_match_n(BruDFA *self, const char *text, size_t text_len);
+
+/**
+ * Find the next match of the regex of the DFA inside the input string if
+ * possible for partial matching.
+ *
+ * @param[in] self the DFA to execute
+ * @param[in] text the input string to find next match in
+ *
+ * @return truthy value if the DFA found a match in the input string; else 0
+ */
+int bru_dfa_find(BruDFA *self, const char *text);
+
+/**
+ * Find the next match of the regex of the DFA inside the input string of given
+ * length if possible for partial matching.
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in] self     the DFA to execute
+ * @param[in] text     the input string to find next match in
+ * @param[in] text_len the number of bytes in the input string
+ *
+ * @return truthy value if the DFA found a match in the input string; else 0
+ */
+int bru_dfa_find_n(BruDFA *self, const char *text, size_t text_len);
+
+/**
+ * Find the end of the leftmost match of the regex of the DFA inside the input
+ * string, searching from the given SP.
+ *
+ * Unlike `bru_dfa_find_n`, the DFA does not remember where to search from
+ * next, so the caller decides where each search starts.
+ *
+ * @param[in] self     the DFA to execute
+ * @param[in] text     the start of the input string
+ * @param[in] sp       the SP to search from
+ * @param[in] text_end the end of the input string
+ *
+ * @return the end of the leftmost match if one was found; else NULL
+ */
+const char *bru_dfa_match_end(BruDFA     *self,
+                              const char *text,
+                              const char *sp,
+                              const char *text_end);
+
+/**
+ * Find the start of the match ending at the given end with a reverse DFA, by
+ * executing it backwards from the end of the match.
+ *
+ * The start found is the leftmost one no earlier than the given SP, which for
+ * the end of the leftmost match found from the SP is the start of that match.
+ *
+ * @param[in] self      the reverse DFA to execute
+ * @param[in] text      the start of the input string
+ * @param[in] sp        the SP the match starts no earlier than
+ * @param[in] match_end the end of the match
+ * @param[in] text_end  the end of the input string
+ *
+ * @return the start of the match if one was found; else NULL
+ */
+const char *bru_dfa_match_start(BruDFA     *self,
+                                const char *text,
+                                const char *sp,
+                                const char *match_end,
+                                const char *text_end);
+
+/**
+ * Determine whether the program of the DFA can check for the end of the input,
+ * in which case a match cannot be found again on the input cut off at its end.
+ *
+ * @param[in] self the DFA
+ *
+ * @return truthy value if the program has reachable `end` instructions; else 0
+ */
+int bru_dfa_has_end(const BruDFA *self);
+
+#endif /* BRU_VM_DFA_H */
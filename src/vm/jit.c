@@ -0,0 +1,958 @@
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#    define JIT_X86_64
+// for `MAP_ANONYMOUS` with strict ISO C
+#    define _DEFAULT_SOURCE
+#endif
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef JIT_X86_64
+#    include <sys/mman.h>
+#endif /* JIT_X86_64 */
+
+#include "../stc/util/utf.h"
+
+#include "../utils.h"
+#include "jit.h"
+
+#define JIT_NFRAMES_INIT 64
+
+/* --- Type definitions ----------------------------------------------------- */
+
+/** A frame of the backtracking stack. */
+typedef struct {
+    const void *resume; /**< code to resume at when failing back to the frame */
+    uintptr_t   value;  /**< SP of a choice point; else the overwritten value */
+} BruJITFrame;
+
+/** The state shared between the machine code and the JIT. */
+typedef struct {
+    const char   *text;       /**< the start of the input string              */
+    const char   *text_end;   /**< the end of the input string                */
+    const char   *sp;         /**< SP to start from, then the end of a match  */
+    bru_byte_t   *memory;     /**< thread memory for the machine code         */
+    BruJITFrame  *stack;      /**< the backtracking stack                     */
+    BruJITFrame  *top;        /**< the top of the stack when it is grown      */
+    BruJITFrame  *limit;      /**< the end of the allocated stack             */
+    BruMemoTable *memo_table; /**< the memoisation table (NULL if unused)     */
+} BruJITState;
+
+struct bru_jit {
+    const BruProgram *program;  /**< the program the JIT compiled             */
+    const char       *text;     /**< the start of the input string            */
+    const char       *curr_sp;  /**< the SP to start the next search from     */
+    int matching_finished;      /**< flag to indicate matching is done        */
+    bru_len_t    ncaptures;     /**< the number of captures in the program    */
+    const char **captures;      /**< the (start, end) capture pairs, stored at
+                                     the start of the thread memory           */
+    bru_cntr_t *counters;       /**< the counters, stored at the end of the
+                                     thread memory                            */
+    size_t      ncounters;      /**< the number of counters in the program    */
+    size_t      memory_len;     /**< the number of bytes of thread memory     */
+    BruJITState state;          /**< the state of the machine code            */
+
+    void  *code;                      /**< executable mapping of machine code */
+    size_t code_size;                 /**< number of bytes of machine code    */
+    int    (*run)(BruJITState *state); /**< the entry of the machine code     */
+    FILE  *logfile;                   /**< the file for logging output        */
+};
+
+/* --- Private function prototypes ------------------------------------------ */
+
+static int jit_compile(BruJIT *self);
+static int jit_run(BruJIT *self, const char *text, const char *text_end);
+
+/* --- API function definitions --------------------------------------------- */
+
+BruJIT *
+bru_jit_new(const BruProgram *prog, BruMemoTableType memo_table, FILE *logfile)
+{
+    BruJIT *jit = malloc(sizeof(*jit));
+    size_t  captures_len, memory_len;
+
+    // the captures, memory, and counters are stored contiguously in the thread
+    // memory as for the threads of the Spencer thread manager
+    captures_len = sizeof(const char *) * 2 * prog->ncaptures;
+    memory_len   = BRU_ALIGN_UP(prog->thread_mem_len, sizeof(bru_cntr_t));
+
+    jit->program           = prog;
+    jit->text              = NULL;
+    jit->curr_sp           = NULL;
+    jit->matching_finished = FALSE;
+    jit->ncaptures         = prog->ncaptures;
+    jit->ncounters         = stc_vec_len(prog->counters);
+    jit->memory_len =
+        captures_len + memory_len + sizeof(bru_cntr_t) * jit->ncounters;
+    jit->state.memory = malloc(jit->memory_len);
+    jit->captures     = (const char **) jit->state.memory;
+    jit->counters =
+        (bru_cntr_t *) (jit->state.memory + captures_len + memory_len);
+    jit->state.stack = malloc(JIT_NFRAMES_INIT * sizeof(BruJITFrame));
+    jit->state.limit = jit->state.stack + JIT_NFRAMES_INIT;
+    jit->state.memo_table =
+        prog->nmemo_insts > 0 ? bru_memo_table_new(memo_table) : NULL;
+    jit->code      = NULL;
+    jit->code_size = 0;
+    jit->run       = NULL;
+    jit->logfile   = logfile;
+
+    if (!jit_compile(jit)) {
+        bru_jit_free(jit);
+        return NULL;
+    }
+
+    return jit;
+}
+
+void bru_jit_free(BruJIT *self)
+{
+#ifdef BRU_BENCHMARK
+    fprintf(self->logfile, "JIT MACHINE CODE: %zu bytes\n", self->code_size);
+    fprintf(self->logfile, "JIT BACKTRACKING STACK: %zu frames\n",
+            (size_t) (self->state.limit - self->state.stack));
+#endif /* BRU_BENCHMARK */
+
+#ifdef JIT_X86_64
+    if (self->code) munmap(self->code, self->code_size);
+#endif /* JIT_X86_64 */
+    if (self->state.memo_table) bru_memo_table_free(self->state.memo_table);
+    free(self->state.stack);
+    free(self->state.memory);
+    free(self);
+}
+
+int bru_jit_match(BruJIT *self, const char *text)
+{
+    if (text == NULL) return 0;
+
+    return bru_jit_match_n(self, text, strlen(text));
+}
+
+int bru_jit_match_n(BruJIT *self, const char *text, size_t text_len)
+{
+    if (text == NULL) return 0;
+
+    self->text              = text;
+    self->curr_sp           = text;
+    self->matching_finished = FALSE;
+
+    return jit_run(self, text, text + text_len);
+}
+
+int bru_jit_find(BruJIT *self, const char *text)
+{
+    if (text == NULL) return 0;
+
+    return bru_jit_find_n(self, text, strlen(text));
+}
+
+int bru_jit_find_n(BruJIT *self, const char *text, size_t text_len)
+{
+    if (text == NULL) return 0;
+
+    self->text = text;
+    if (self->curr_sp == NULL) {
+        self->curr_sp           = text;
+        self->matching_finished = FALSE;
+    }
+
+    return jit_run(self, text, text + text_len);
+}
+
+StcStringView bru_jit_capture(BruJIT *self, bru_len_t idx)
+{
+    if (idx >= self->ncaptures) return (StcStringView){ 0, NULL };
+
+    return stc_sv_from_range(self->captures[2 * idx],
+                             self->captures[2 * idx + 1]);
+}
+
+StcStringView *bru_jit_captures(BruJIT *self, bru_len_t *ncaptures)
+{
+    bru_len_t      i;
+    StcStringView *captures = malloc(self->ncaptures * sizeof(StcStringView));
+
+    if (ncaptures) *ncaptures = self->ncaptures;
+    for (i = 0; i < self->ncaptures; i++)
+        captures[i] =
+            stc_sv_from_range(self->captures[2 * i], self->captures[2 * i + 1]);
+
+    return captures;
+}
+
+bru_len_t bru_jit_captures_into(BruJIT *self, size_t *offsets, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n && i < 2 * (size_t) self->ncaptures; i++)
+        offsets[i] = self->captures[i]
+                         ? (size_t) (self->captures[i] - self->text)
+                         : SIZE_MAX;
+
+    return self->ncaptures;
+}
+
+/* --- Private function definitions ----------------------------------------- */
+
+static int jit_run(BruJIT *self, const char *text, const char *text_end)
+{
+    const BruProgram *prog = self->program;
+    const char       *matched_sp;
+    int               matched;
+
+    if (self->matching_finished) return FALSE;
+
+    // every match starts with the literal prefix, so skip straight to it
+    if (!(self->curr_sp =
+              bru_program_find_prefix(prog, self->curr_sp, text_end))) {
+        self->matching_finished = TRUE;
+        return FALSE;
+    }
+
+    // a thread can be at any of the `text_len + 1` positions in the input
+    if (self->state.memo_table)
+        bru_memo_table_init(self->state.memo_table, prog->nmemo_insts,
+                            text_end - text + 1);
+    memset(self->state.memory, 0, self->memory_len);
+    if (self->ncounters)
+        memcpy(self->counters, prog->counters,
+               sizeof(bru_cntr_t) * self->ncounters);
+
+    self->state.text     = text;
+    self->state.text_end = text_end;
+    self->state.sp       = self->curr_sp;
+    self->state.top      = self->state.stack;
+    // the program starts with an implicit `.*?` loop, so a single pass from
+    // the current SP finds the leftmost match
+    matched    = self->run(&self->state);
+    matched_sp = self->state.sp;
+
+    // an empty match can only be found after the current SP at the end of the
+    // input, so stop there to avoid reporting it twice
+    if (!matched || matched_sp == text_end)
+        self->matching_finished = TRUE;
+    else
+        self->curr_sp = matched_sp != self->curr_sp
+                            ? matched_sp
+                            : stc_utf8_str_next(self->curr_sp);
+    // a codepoint cut short by the end of the input is skipped to the end
+    if (self->curr_sp > text_end) self->curr_sp = text_end;
+
+    return matched;
+}
+
+#ifdef JIT_X86_64
+
+#    define JIT_UNBOUND SIZE_MAX
+
+/* x86-64 registers */
+#    define JIT_RAX 0
+#    define JIT_RCX 1
+#    define JIT_RDX 2
+#    define JIT_RBX 3
+#    define JIT_RSP 4
+#    define JIT_RBP 5
+#    define JIT_RSI 6
+#    define JIT_RDI 7
+#    define JIT_R12 12
+#    define JIT_R13 13
+#    define JIT_R14 14
+#    define JIT_R15 15
+
+/* callee-saved registers holding the state of the machine code */
+#    define JIT_SP    JIT_RBX /**< the SP into the input string               */
+#    define JIT_END   JIT_R12 /**< the end of the input string                */
+#    define JIT_STATE JIT_R13 /**< the `BruJITState`                          */
+#    define JIT_TOP   JIT_R14 /**< the top of the backtracking stack          */
+#    define JIT_MEM   JIT_R15 /**< the thread memory                          */
+
+/* condition codes for conditional jumps */
+#    define JIT_CC_B  0x2
+#    define JIT_CC_AE 0x3
+#    define JIT_CC_E  0x4
+#    define JIT_CC_NE 0x5
+#    define JIT_CC_BE 0x6
+#    define JIT_CC_A  0x7
+
+#    define JIT_STATE_OFF(field) ((int32_t) offsetof(BruJITState, field))
+#    define JIT_FRAME_OFF(field) ((int32_t) offsetof(BruJITFrame, field))
+
+/** The kinds of out-of-line code emitted after the instructions. */
+typedef enum {
+    JIT_STUB_RESUME,    /**< restore the SP of a choice point and jump to it  */
+    JIT_STUB_UNDO_PTR,  /**< restore a capture or memory pointer and fail     */
+    JIT_STUB_UNDO_CNTR, /**< restore a counter and fail                       */
+    JIT_STUB_PRED,      /**< check a predicate against a non-ASCII codepoint  */
+} BruJITStubKind;
+
+typedef struct {
+    BruJITStubKind kind;  /**< the kind of the stub                           */
+    size_t         label; /**< the label of the stub                          */
+    size_t target; /**< label to resume at, or of the instruction after       */
+    int32_t disp;  /**< displacement into the thread memory to restore        */
+    const BruIntervalsTable *table; /**< the lookup table of the predicate    */
+} BruJITStub;
+
+/** A rel32 operand to patch once the label it refers to is bound. */
+typedef struct {
+    size_t pos;   /**< the position of the operand in the machine code        */
+    size_t label; /**< the label the operand is relative to                   */
+} BruJITFixup;
+
+typedef struct {
+    unsigned char *code;   /**< stc_vec of the machine code                   */
+    size_t        *labels; /**< stc_vec of the positions of labels, where the
+                                first labels are for the bytecode offsets     */
+    BruJITFixup   *fixups; /**< stc_vec of the operands to patch              */
+    BruJITStub    *stubs;  /**< stc_vec of the out-of-line code to emit       */
+
+    size_t fail;    /**< label of the code popping the backtracking stack     */
+    size_t nomatch; /**< label of the code returning no match                 */
+    size_t exit;    /**< label of the epilogue                                */
+    size_t grow;    /**< label of the routine growing the backtracking stack  */
+} BruJITAsm;
+
+/* --- Machine code emission functions -------------------------------------- */
+
+static void jit_emit(BruJITAsm *a, int byte)
+{
+    stc_vec_push_back(a->code, (unsigned char) byte);
+}
+
+static void jit_emit_op(BruJITAsm *a, unsigned op)
+{
+    if (op > 0xff) jit_emit(a, op >> 8);
+    jit_emit(a, op & 0xff);
+}
+
+static void jit_emit_rex(BruJITAsm *a, int w, int reg, int rm)
+{
+    int rex = 0x40 | (w ? 8 : 0) | (reg & 8 ? 4 : 0) | (rm & 8 ? 1 : 0);
+
+    if (rex != 0x40) jit_emit(a, rex);
+}
+
+/**
+ * Emit an instruction with a register operand (or opcode extension) and a
+ * memory operand at a displacement from a base register.
+ */
+static void
+jit_emit_mem(BruJITAsm *a, int w, unsigned op, int reg, int base, int32_t disp)
+{
+    int mod = disp == 0 && (base & 7) != JIT_RBP ? 0
+              : -128 <= disp && disp <= 127      ? 1
+                                                 : 2;
+
+    jit_emit_rex(a, w, reg, base);
+    jit_emit_op(a, op);
+    jit_emit(a, mod << 6 | (reg & 7) << 3 | (base & 7));
+    if ((base & 7) == JIT_RSP) jit_emit(a, 0x24);
+    if (mod == 1)
+        jit_emit(a, disp);
+    else if (mod == 2)
+        BRU_MEMPUSH(a->code, int32_t, disp);
+}
+
+/** Emit an instruction with two register operands (or an opcode extension). */
+static void jit_emit_reg(BruJITAsm *a, int w, unsigned op, int reg, int rm)
+{
+    jit_emit_rex(a, w, reg, rm);
+    jit_emit_op(a, op);
+    jit_emit(a, 0xc0 | (reg & 7) << 3 | (rm & 7));
+}
+
+static void jit_emit_push(BruJITAsm *a, int reg)
+{
+    jit_emit_rex(a, 0, 0, reg);
+    jit_emit(a, 0x50 | (reg & 7));
+}
+
+static void jit_emit_pop(BruJITAsm *a, int reg)
+{
+    jit_emit_rex(a, 0, 0, reg);
+    jit_emit(a, 0x58 | (reg & 7));
+}
+
+static void jit_emit_mov_imm32(BruJITAsm *a, int reg, uint32_t imm)
+{
+    jit_emit_rex(a, 0, 0, reg);
+    jit_emit(a, 0xb8 | (reg & 7));
+    BRU_MEMPUSH(a->code, uint32_t, imm);
+}
+
+static void jit_emit_mov_imm64(BruJITAsm *a, int reg, uint64_t imm)
+{
+    jit_emit_rex(a, 1, 0, reg);
+    jit_emit(a, 0xb8 | (reg & 7));
+    BRU_MEMPUSH(a->code, uint64_t, imm);
+}
+
+static void jit_emit_call_abs(BruJITAsm *a, uintptr_t fn)
+{
+    jit_emit_mov_imm64(a, JIT_RAX, fn);
+    jit_emit_reg(a, 0, 0xff, 2, JIT_RAX);
+}
+
+/* --- Label functions ------------------------------------------------------ */
+
+static size_t jit_label(BruJITAsm *a)
+{
+    stc_vec_push_back(a->labels, JIT_UNBOUND);
+    return stc_vec_len_unsafe(a->labels) - 1;
+}
+
+static void jit_bind(BruJITAsm *a, size_t label)
+{
+    a->labels[label] = stc_vec_len_unsafe(a->code);
+}
+
+static void jit_emit_rel32(BruJITAsm *a, size_t label)
+{
+    BruJITFixup fixup = { stc_vec_len_unsafe(a->code), label };
+
+    stc_vec_push_back(a->fixups, fixup);
+    BRU_MEMPUSH(a->code, int32_t, 0);
+}
+
+static void jit_emit_jmp(BruJITAsm *a, size_t label)
+{
+    jit_emit(a, 0xe9);
+    jit_emit_rel32(a, label);
+}
+
+static void jit_emit_jcc(BruJITAsm *a, int cc, size_t label)
+{
+    jit_emit(a, 0x0f);
+    jit_emit(a, 0x80 | cc);
+    jit_emit_rel32(a, label);
+}
+
+static void jit_emit_call(BruJITAsm *a, size_t label)
+{
+    jit_emit(a, 0xe8);
+    jit_emit_rel32(a, label);
+}
+
+static void jit_emit_lea(BruJITAsm *a, int reg, size_t label)
+{
+    jit_emit_rex(a, 1, reg, 0);
+    jit_emit(a, 0x8d);
+    jit_emit(a, (reg & 7) << 3 | JIT_RBP); // RIP-relative
+    jit_emit_rel32(a, label);
+}
+
+static size_t jit_stub(BruJITAsm *a, BruJITStub stub)
+{
+    stub.label = jit_label(a);
+    stc_vec_push_back(a->stubs, stub);
+    return stub.label;
+}
+
+/* --- Backtracking stack functions ----------------------------------------- */
+
+/**
+ * Grow the backtracking stack when it is full. Called from the machine code
+ * with the top of the stack saved in the state.
+ *
+ * @param[in] state the state of the machine code
+ *
+ * @return the new top of the backtracking stack
+ */
+static BruJITFrame *jit_grow_stack(BruJITState *state)
+{
+    size_t nframes = state->limit - state->stack,
+           ntop    = state->top - state->stack;
+
+    state->stack = realloc(state->stack, 2 * nframes * sizeof(BruJITFrame));
+    state->limit = state->stack + 2 * nframes;
+    state->top   = state->stack + ntop;
+
+    return state->top;
+}
+
+/**
+ * Emit code to make space for a frame on the backtracking stack.
+ *
+ * Clobbers every caller-saved register.
+ */
+static void jit_emit_reserve_frame(BruJITAsm *a)
+{
+    size_t ok = jit_label(a);
+
+    jit_emit_mem(a, 1, 0x3b, JIT_TOP, JIT_STATE, JIT_STATE_OFF(limit));
+    jit_emit_jcc(a, JIT_CC_B, ok);
+    jit_emit_call(a, a->grow);
+    jit_bind(a, ok);
+}
+
+/**
+ * Emit code to push a frame resuming at the given label with the value of the
+ * given register onto the backtracking stack, once space has been reserved.
+ *
+ * Clobbers RCX.
+ */
+static void jit_emit_push_frame(BruJITAsm *a, size_t resume, int reg)
+{
+    jit_emit_lea(a, JIT_RCX, resume);
+    jit_emit_mem(a, 1, 0x89, JIT_RCX, JIT_TOP, JIT_FRAME_OFF(resume));
+    jit_emit_mem(a, 1, 0x89, reg, JIT_TOP, JIT_FRAME_OFF(value));
+    jit_emit_reg(a, 1, 0x83, 0, JIT_TOP);
+    jit_emit(a, sizeof(BruJITFrame));
+}
+
+/**
+ * Emit code to save the pointer in the thread memory at the displacement onto
+ * the backtracking stack, to be restored when failing.
+ */
+static void jit_emit_save_ptr(BruJITAsm *a, int32_t disp)
+{
+    BruJITStub stub = { JIT_STUB_UNDO_PTR, 0, 0, disp, NULL };
+
+    jit_emit_reserve_frame(a);
+    jit_emit_mem(a, 1, 0x8b, JIT_RAX, JIT_MEM, disp);
+    jit_emit_push_frame(a, jit_stub(a, stub), JIT_RAX);
+}
+
+/**
+ * Emit code to save the counter in the thread memory at the displacement onto
+ * the backtracking stack, to be restored when failing.
+ */
+static void jit_emit_save_cntr(BruJITAsm *a, int32_t disp)
+{
+    BruJITStub stub = { JIT_STUB_UNDO_CNTR, 0, 0, disp, NULL };
+
+    jit_emit_reserve_frame(a);
+    jit_emit_mem(a, 0, 0x0fb7, JIT_RAX, JIT_MEM, disp); // movzx eax, word
+    jit_emit_push_frame(a, jit_stub(a, stub), JIT_RAX);
+}
+
+/**
+ * Emit code to push a choice point resuming at the given label with the
+ * current SP onto the backtracking stack.
+ */
+static void jit_emit_choice(BruJITAsm *a, size_t target)
+{
+    BruJITStub stub = { JIT_STUB_RESUME, 0, target, 0, NULL };
+
+    jit_emit_reserve_frame(a);
+    jit_emit_push_frame(a, jit_stub(a, stub), JIT_SP);
+}
+
+/* --- Compilation functions ------------------------------------------------ */
+
+/**
+ * Check a predicate against the codepoint at the SP. Called from the machine
+ * code for non-ASCII codepoints.
+ *
+ * @param[in] table    the lookup table of the predicate
+ * @param[in] sp       the SP
+ * @param[in] text_end the end of the input string
+ *
+ * @return the number of bytes of the codepoint if it lies within the input
+ *         and satisfies the predicate; else 0
+ */
+static size_t jit_pred(const BruIntervalsTable *table,
+                       const char              *sp,
+                       const char              *text_end)
+{
+    return BRU_CODEPOINT_IN_TEXT(sp, text_end) &&
+                   bru_intervals_table_predicate(table, sp)
+               ? stc_utf8_nbytes(sp)
+               : 0;
+}
+
+static void jit_emit_stubs(BruJITAsm *a)
+{
+    BruJITStub *stub;
+    size_t      i;
+
+    for (i = 0; i < stc_vec_len(a->stubs); i++) {
+        stub = a->stubs + i;
+        jit_bind(a, stub->label);
+        switch (stub->kind) {
+            case JIT_STUB_RESUME:
+                jit_emit_reg(a, 1, 0x89, JIT_RAX, JIT_SP);
+                jit_emit_jmp(a, stub->target);
+                break;
+
+            case JIT_STUB_UNDO_PTR:
+                jit_emit_mem(a, 1, 0x89, JIT_RAX, JIT_MEM, stub->disp);
+                jit_emit_jmp(a, a->fail);
+                break;
+
+            case JIT_STUB_UNDO_CNTR:
+                jit_emit(a, 0x66);
+                jit_emit_mem(a, 0, 0x89, JIT_RAX, JIT_MEM, stub->disp);
+                jit_emit_jmp(a, a->fail);
+                break;
+
+            case JIT_STUB_PRED:
+                jit_emit_mov_imm64(a, JIT_RDI, (uintptr_t) stub->table);
+                jit_emit_reg(a, 1, 0x89, JIT_SP, JIT_RSI);
+                jit_emit_reg(a, 1, 0x89, JIT_END, JIT_RDX);
+                jit_emit_call_abs(a, (uintptr_t) jit_pred);
+                jit_emit_reg(a, 1, 0x85, JIT_RAX, JIT_RAX);
+                jit_emit_jcc(a, JIT_CC_E, a->fail);
+                jit_emit_reg(a, 1, 0x01, JIT_RAX, JIT_SP);
+                jit_emit_jmp(a, stub->target);
+                break;
+        }
+    }
+}
+
+/**
+ * Emit the machine code for the instructions of the program, where the label
+ * of each instruction is its bytecode offset.
+ *
+ * @return truthy value if every instruction is supported; else 0
+ */
+static int jit_emit_insts(BruJITAsm *a, const BruJIT *self)
+{
+    const BruProgram *prog  = self->program;
+    const bru_byte_t *insts = prog->insts, *pc = insts, *offsets,
+                     *insts_end = insts + stc_vec_len(prog->insts);
+    const char              *codepoint;
+    const BruIntervalsTable *table;
+    BruJITStub               stub = { JIT_STUB_PRED, 0, 0, 0, NULL };
+    bru_len_t                k, i;
+    bru_offset_t             x, y;
+    bru_cntr_t               n;
+    int32_t mem_off, cntr_off, nbytes, lbyte, ubyte;
+    int     cc;
+
+#    define LABEL(p) ((size_t) ((p) - insts))
+
+    mem_off  = sizeof(const char *) * 2 * prog->ncaptures;
+    cntr_off = mem_off + BRU_ALIGN_UP(prog->thread_mem_len, sizeof(bru_cntr_t));
+    while (pc < insts_end) {
+        jit_bind(a, LABEL(pc));
+        switch (*pc++) {
+            case BRU_NOOP: /* fallthrough */
+            case BRU_STATE: break;
+
+            case BRU_MATCH:
+                jit_emit_mem(a, 1, 0x89, JIT_SP, JIT_STATE, JIT_STATE_OFF(sp));
+                jit_emit_mov_imm32(a, JIT_RAX, TRUE);
+                jit_emit_jmp(a, a->exit);
+                break;
+
+            case BRU_BEGIN:
+                jit_emit_mem(a, 1, 0x3b, JIT_SP, JIT_STATE,
+                             JIT_STATE_OFF(text));
+                jit_emit_jcc(a, JIT_CC_NE, a->fail);
+                break;
+
+            case BRU_END:
+                jit_emit_reg(a, 1, 0x3b, JIT_SP, JIT_END);
+                jit_emit_jcc(a, JIT_CC_NE, a->fail);
+                break;
+
+            case BRU_MEMO:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                jit_emit_mem(a, 1, 0x8b, JIT_RDI, JIT_STATE,
+                             JIT_STATE_OFF(memo_table));
+                jit_emit_mov_imm32(a, JIT_RSI, k);
+                jit_emit_reg(a, 1, 0x89, JIT_SP, JIT_RDX);
+                jit_emit_mem(a, 1, 0x2b, JIT_RDX, JIT_STATE,
+                             JIT_STATE_OFF(text));
+                jit_emit_call_abs(a, (uintptr_t) bru_memo_table_insert);
+                jit_emit_reg(a, 0, 0x85, JIT_RAX, JIT_RAX);
+                jit_emit_jcc(a, JIT_CC_E, a->fail);
+                break;
+
+            case BRU_CHAR:
+                BRU_CODEPOINTREAD(codepoint, pc);
+                nbytes = stc_utf8_nbytes(codepoint);
+                jit_emit_mem(a, 1, 0x8d, JIT_RAX, JIT_SP, nbytes);
+                jit_emit_reg(a, 1, 0x3b, JIT_RAX, JIT_END);
+                jit_emit_jcc(a, JIT_CC_A, a->fail);
+                for (i = 0; i < nbytes; i++) {
+                    jit_emit_mem(a, 0, 0x80, 7, JIT_SP, i);
+                    jit_emit(a, codepoint[i]);
+                    jit_emit_jcc(a, JIT_CC_NE, a->fail);
+                }
+                jit_emit_reg(a, 1, 0x83, 0, JIT_SP);
+                jit_emit(a, nbytes);
+                break;
+
+            case BRU_PRED:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                table = BRU_PRED_TABLE(prog->aux, k);
+                jit_emit_reg(a, 1, 0x3b, JIT_SP, JIT_END);
+                jit_emit_jcc(a, JIT_CC_AE, a->fail);
+                jit_emit_mem(a, 0, 0x0fb6, JIT_RAX, JIT_SP, 0);
+                jit_emit(a, 0x3d); // cmp eax, imm32
+                BRU_MEMPUSH(a->code, int32_t, 0x80);
+                // non-ASCII codepoints are checked out of line, unless the
+                // predicate cannot match any
+                if (table->len > 0 || table->latin1[2] || table->latin1[3]) {
+                    stub.table  = table;
+                    stub.target = LABEL(pc);
+                    jit_emit_jcc(a, JIT_CC_AE, jit_stub(a, stub));
+                } else {
+                    jit_emit_jcc(a, JIT_CC_AE, a->fail);
+                }
+                jit_emit_mov_imm64(a, JIT_RDI, (uintptr_t) table->latin1);
+                jit_emit_mem(a, 1, 0x0fa3, JIT_RAX, JIT_RDI, 0); // bt
+                jit_emit_jcc(a, JIT_CC_AE, a->fail);
+                jit_emit_reg(a, 1, 0x83, 0, JIT_SP);
+                jit_emit(a, 1);
+                break;
+
+            case BRU_BYTE:
+                lbyte = (unsigned char) pc[0];
+                ubyte = (unsigned char) pc[1];
+                pc   += 2 * sizeof(bru_byte_t);
+                jit_emit_reg(a, 1, 0x3b, JIT_SP, JIT_END);
+                jit_emit_jcc(a, JIT_CC_AE, a->fail);
+                if (lbyte > 0 || ubyte < 0xff) {
+                    jit_emit_mem(a, 0, 0x0fb6, JIT_RAX, JIT_SP, 0);
+                    jit_emit(a, 0x2d); // sub eax, imm32
+                    BRU_MEMPUSH(a->code, int32_t, lbyte);
+                    jit_emit(a, 0x3d); // cmp eax, imm32
+                    BRU_MEMPUSH(a->code, int32_t, ubyte - lbyte);
+                    jit_emit_jcc(a, JIT_CC_A, a->fail);
+                }
+                jit_emit_reg(a, 1, 0x83, 0, JIT_SP);
+                jit_emit(a, 1);
+                break;
+
+            case BRU_SAVE:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                jit_emit_save_ptr(a, sizeof(const char *) * k);
+                jit_emit_mem(a, 1, 0x89, JIT_SP, JIT_MEM,
+                             sizeof(const char *) * k);
+                break;
+
+            case BRU_JMP:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                if (x != 0) jit_emit_jmp(a, LABEL(pc + x));
+                break;
+
+            case BRU_SPLIT:
+                // the first offset is relative to the end of itself
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                x -= sizeof(bru_offset_t);
+                BRU_MEMREAD(y, pc, bru_offset_t);
+                jit_emit_choice(a, LABEL(pc + y));
+                if (x != 0) jit_emit_jmp(a, LABEL(pc + x));
+                break;
+
+            case BRU_TSWITCH:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                offsets = pc;
+                if (k == 0) {
+                    jit_emit_jmp(a, a->fail);
+                    break;
+                }
+                // the threads are scheduled in order, so the first offset is
+                // followed first and the last is resumed last
+                for (i = k; i-- > 0;) {
+                    pc = offsets + i * sizeof(bru_offset_t);
+                    BRU_MEMREAD(x, pc, bru_offset_t);
+                    if (i > 0)
+                        jit_emit_choice(a, LABEL(pc + x));
+                    else
+                        jit_emit_jmp(a, LABEL(pc + x));
+                }
+                pc = offsets + k * sizeof(bru_offset_t);
+                break;
+
+            case BRU_EPSRESET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                jit_emit_save_ptr(a, mem_off + k);
+                jit_emit_mem(a, 1, 0xc7, 0, JIT_MEM, mem_off + k);
+                BRU_MEMPUSH(a->code, int32_t, 0);
+                break;
+
+            case BRU_EPSSET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                jit_emit_save_ptr(a, mem_off + k);
+                jit_emit_mem(a, 1, 0x89, JIT_SP, JIT_MEM, mem_off + k);
+                break;
+
+            case BRU_EPSCHK:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                jit_emit_mem(a, 1, 0x39, JIT_SP, JIT_MEM, mem_off + k);
+                jit_emit_jcc(a, JIT_CC_AE, a->fail);
+                break;
+
+            case BRU_RESET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_MEMREAD(n, pc, bru_cntr_t);
+                jit_emit_save_cntr(a, cntr_off + sizeof(bru_cntr_t) * k);
+                jit_emit(a, 0x66);
+                jit_emit_mem(a, 0, 0xc7, 0, JIT_MEM,
+                             cntr_off + sizeof(bru_cntr_t) * k);
+                BRU_MEMPUSH(a->code, uint16_t, n);
+                break;
+
+            case BRU_CMP:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_MEMREAD(n, pc, bru_cntr_t);
+                // jump to fail on the negated condition
+                switch (*pc++) {
+                    case BRU_LT: cc = JIT_CC_AE; break;
+                    case BRU_LE: cc = JIT_CC_A; break;
+                    case BRU_EQ: cc = JIT_CC_NE; break;
+                    case BRU_NE: cc = JIT_CC_E; break;
+                    case BRU_GE: cc = JIT_CC_B; break;
+                    case BRU_GT: cc = JIT_CC_BE; break;
+                    default: return FALSE;
+                }
+                jit_emit_mem(a, 0, 0x0fb7, JIT_RAX, JIT_MEM,
+                             cntr_off + sizeof(bru_cntr_t) * k);
+                jit_emit(a, 0x3d); // cmp eax, imm32
+                BRU_MEMPUSH(a->code, int32_t, n);
+                jit_emit_jcc(a, cc, a->fail);
+                break;
+
+            case BRU_INC:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                jit_emit_save_cntr(a, cntr_off + sizeof(bru_cntr_t) * k);
+                jit_emit(a, 0x66);
+                jit_emit_mem(a, 0, 0x83, 0, JIT_MEM,
+                             cntr_off + sizeof(bru_cntr_t) * k);
+                jit_emit(a, 1);
+                break;
+
+            // lookarounds, and lazy and greedy splits are not implemented by
+            // the SRVM either
+            case BRU_GSPLIT: /* fallthrough */
+            case BRU_LSPLIT: /* fallthrough */
+            case BRU_ZWA:    /* fallthrough */
+            default: return FALSE;
+        }
+    }
+    // execution can never run off the end of a program, but be safe
+    jit_bind(a, LABEL(insts_end));
+    jit_emit_jmp(a, a->fail);
+
+#    undef LABEL
+
+    return TRUE;
+}
+
+/**
+ * Compile the program of the JIT to machine code in an executable mapping.
+ *
+ * The machine code is a function taking the `BruJITState`, which follows the
+ * System V calling convention. It returns whether a match was found, writing
+ * the end of the match to the SP of the state.
+ *
+ * @param[in] self the JIT
+ *
+ * @return truthy value if the program could be compiled; else 0
+ */
+static int jit_compile(BruJIT *self)
+{
+    BruJITAsm a;
+    size_t    i, ninsts = stc_vec_len(self->program->insts);
+    int32_t   rel;
+    int       compiled = FALSE;
+
+    // counters are loaded and stored as 16-bit words
+    if (sizeof(bru_cntr_t) != sizeof(uint16_t)) return FALSE;
+
+    stc_vec_default_init(a.code);
+    stc_vec_init(a.labels, ninsts + 1);
+    stc_vec_default_init(a.fixups);
+    stc_vec_default_init(a.stubs);
+    for (i = 0; i <= ninsts; i++) stc_vec_push_back(a.labels, JIT_UNBOUND);
+    a.fail    = jit_label(&a);
+    a.nomatch = jit_label(&a);
+    a.exit    = jit_label(&a);
+    a.grow    = jit_label(&a);
+
+    // prologue, where the sentinel frame at the bottom of the backtracking
+    // stack returns no match
+    jit_emit_push(&a, JIT_RBX);
+    jit_emit_push(&a, JIT_R12);
+    jit_emit_push(&a, JIT_R13);
+    jit_emit_push(&a, JIT_R14);
+    jit_emit_push(&a, JIT_R15);
+    jit_emit_reg(&a, 1, 0x89, JIT_RDI, JIT_STATE);
+    jit_emit_mem(&a, 1, 0x8b, JIT_SP, JIT_STATE, JIT_STATE_OFF(sp));
+    jit_emit_mem(&a, 1, 0x8b, JIT_END, JIT_STATE, JIT_STATE_OFF(text_end));
+    jit_emit_mem(&a, 1, 0x8b, JIT_MEM, JIT_STATE, JIT_STATE_OFF(memory));
+    jit_emit_mem(&a, 1, 0x8b, JIT_TOP, JIT_STATE, JIT_STATE_OFF(top));
+    jit_emit_reserve_frame(&a);
+    jit_emit_push_frame(&a, a.nomatch, JIT_SP);
+
+    if (!jit_emit_insts(&a, self)) goto done;
+
+    // pop the top frame of the backtracking stack and resume at it
+    jit_bind(&a, a.fail);
+    jit_emit_reg(&a, 1, 0x83, 5, JIT_TOP);
+    jit_emit(&a, sizeof(BruJITFrame));
+    jit_emit_mem(&a, 1, 0x8b, JIT_RAX, JIT_TOP, JIT_FRAME_OFF(value));
+    jit_emit_mem(&a, 0, 0xff, 4, JIT_TOP, JIT_FRAME_OFF(resume));
+
+    // epilogue
+    jit_bind(&a, a.nomatch);
+    jit_emit_reg(&a, 0, 0x31, JIT_RAX, JIT_RAX);
+    jit_bind(&a, a.exit);
+    jit_emit_pop(&a, JIT_R15);
+    jit_emit_pop(&a, JIT_R14);
+    jit_emit_pop(&a, JIT_R13);
+    jit_emit_pop(&a, JIT_R12);
+    jit_emit_pop(&a, JIT_RBX);
+    jit_emit(&a, 0xc3);
+
+    // called with the stack misaligned by the return address
+    jit_bind(&a, a.grow);
+    jit_emit_mem(&a, 1, 0x89, JIT_TOP, JIT_STATE, JIT_STATE_OFF(top));
+    jit_emit_reg(&a, 1, 0x89, JIT_STATE, JIT_RDI);
+    jit_emit_reg(&a, 1, 0x83, 5, JIT_RSP);
+    jit_emit(&a, 8);
+    jit_emit_call_abs(&a, (uintptr_t) jit_grow_stack);
+    jit_emit_reg(&a, 1, 0x83, 0, JIT_RSP);
+    jit_emit(&a, 8);
+    jit_emit_reg(&a, 1, 0x89, JIT_RAX, JIT_TOP);
+    jit_emit(&a, 0xc3);
+
+    jit_emit_stubs(&a);
+
+    for (i = 0; i < stc_vec_len(a.fixups); i++) {
+        assert(a.labels[a.fixups[i].label] != JIT_UNBOUND);
+        rel = a.labels[a.fixups[i].label] - (a.fixups[i].pos + sizeof(rel));
+        memcpy(a.code + a.fixups[i].pos, &rel, sizeof(rel));
+    }
+
+    // map the machine code writable to copy it in, then executable
+    self->code_size = stc_vec_len(a.code);
+    self->code      = mmap(NULL, self->code_size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (self->code == MAP_FAILED) {
+        self->code = NULL;
+        goto done;
+    }
+    memcpy(self->code, a.code, self->code_size);
+    if (mprotect(self->code, self->code_size, PROT_READ | PROT_EXEC) != 0)
+        goto done;
+    // ISO C has no conversion from an object pointer to a function pointer
+    memcpy(&self->run, &self->code, sizeof(self->code));
+    compiled = TRUE;
+
+done:
+    stc_vec_free(a.code);
+    stc_vec_free(a.labels);
+    stc_vec_free(a.fixups);
+    stc_vec_free(a.stubs);
+
+    return compiled;
+}
+
+#else /* JIT_X86_64 */
+
+static int jit_compile(BruJIT *self)
+{
+    BRU_UNUSED(self);
+    return FALSE;
+}
+
+#endif /* JIT_X86_64 */
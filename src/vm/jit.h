@@ -0,0 +1,151 @@
+#ifndef BRU_VM_JIT_H
+#define BRU_VM_JIT_H
+
+#include <stdio.h>
+
+#include "../stc/fatp/string_view.h"
+
+#include "program.h"
+#include "thread_managers/memo_table.h"
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct bru_jit BruJIT;
+
+#if !defined(BRU_VM_JIT_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_JIT_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&    \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) || \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+typedef BruJIT JIT;
+
+#    define jit_new      bru_jit_new
+#    define jit_free     bru_jit_free
+#    define jit_match    bru_jit_match
+#    define jit_match_n  bru_jit_match_n
+#    define jit_find     bru_jit_find
+#    define jit_find_n   bru_jit_find_n
+#    define jit_capture  bru_jit_capture
+#    define jit_captures bru_jit_captures
+
+#    define jit_captures_into bru_jit_captures_into
+#endif /* BRU_VM_JIT_ENABLE_SHORT_NAMES */
+
+/* --- JIT function prototypes ---------------------------------------------- */
+
+/**
+ * Compile the given program to x86-64 machine code.
+ *
+ * The machine code executes the program with the same backtracking semantics
+ * as the Spencer thread manager. Instead of cloning threads, each `split` or
+ * `tswitch` pushes a choice point onto an explicit backtracking stack, and
+ * each instruction writing to thread memory pushes the value it overwrites so
+ * that failing restores the memory of the most recent choice point.
+ *
+ * Only programs without lookarounds, or lazy and greedy splits can be compiled,
+ * and only on x86-64 systems providing `mmap`. Otherwise, the program must be
+ * executed by the SRVM instead.
+ *
+ * @param[in] prog       the program to compile
+ * @param[in] memo_table the encoding of the memoisation table if the program
+ *                       has memoisation instructions
+ * @param[in] logfile    the file for logging output
+ *
+ * @return the compiled program if the program is supported; else NULL
+ */
+BruJIT *
+bru_jit_new(const BruProgram *prog, BruMemoTableType memo_table, FILE *logfile);
+
+/**
+ * Free the memory allocated for the JIT, including its machine code.
+ *
+ * @param[in] self the JIT to free
+ */
+void bru_jit_free(BruJIT *self);
+
+/**
+ * Execute the JIT against an input string.
+ *
+ * @param[in] self the JIT to execute
+ * @param[in] text the input string to match against
+ *
+ * @return truthy value if the JIT matched against the input string; else 0
+ */
+int bru_jit_match(BruJIT *self, const char *text);
+
+/**
+ * Execute the JIT against an input string of given length.
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in] self     the JIT to execute
+ * @param[in] text     the input string to match against
+ * @param[in] text_len the number of bytes in the input string
+ *
+ * @return truthy value if the JIT matched against the input string; else 0
+ */
+int bru_jit_match_n(BruJIT *self, const char *text, size_t text_len);
+
+/**
+ * Find the next match of the regex of the JIT inside the input string if
+ * possible for partial matching.
+ *
+ * @param[in] self the JIT to execute
+ * @param[in] text the input string to find next match in
+ *
+ * @return truthy value if the JIT found a match in the input string; else 0
+ */
+int bru_jit_find(BruJIT *self, const char *text);
+
+/**
+ * Find the next match of the regex of the JIT inside the input string of given
+ * length if possible for partial matching.
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in] self     the JIT to execute
+ * @param[in] text     the input string to find next match in
+ * @param[in] text_len the number of bytes in the input string
+ *
+ * @return truthy value if the JIT found a match in the input string; else 0
+ */
+int bru_jit_find_n(BruJIT *self, const char *text, size_t text_len);
+
+/**
+ * Get the string view into the input string of the capture at the given index
+ * from the previous match.
+ *
+ * @param[in] self the JIT to get the capture from
+ * @param[in] idx  the index of the capture
+ *
+ * @return the string view of the capture
+ */
+StcStringView bru_jit_capture(BruJIT *self, bru_len_t idx);
+
+/**
+ * Get the string views of all the captures from the previous match of the JIT.
+ *
+ * @param[in]  self      the JIT to get the captures from
+ * @param[out] ncaptures the number of captures in the returned array
+ *
+ * @return the array of capture string views from the JIT
+ */
+StcStringView *bru_jit_captures(BruJIT *self, bru_len_t *ncaptures);
+
+/**
+ * Write the byte offsets from the start of the input string of all the
+ * captures from the previous match of the JIT into a buffer of the caller (see
+ * `bru_srvm_captures_into`).
+ *
+ * @param[in]  self    the JIT to get the captures from
+ * @param[out] offsets the buffer of offsets
+ * @param[in]  n       the number of offsets the buffer holds, of which at most
+ *                     `2 * ncaptures` are written
+ *
+ * @return the number of captures of the JIT
+ */
+bru_len_t bru_jit_captures_into(BruJIT *self, size_t *offsets, size_t n);
+
+#endif /* BRU_VM_JIT_H */
@@ -1,4 +1,6 @@
 #include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -11,6 +13,32 @@
 
 #define BUFSIZE 512
 
+/** The alignment of each section of a program in the binary program format. */
+#define SECTION_ALIGN 8
+
+/** The flag for a program whose capture 0 spans the whole match. */
+#define FLAG_WHOLE_MATCH_CAPTURE 0x01
+
+/** The header of a program in the binary program format. */
+typedef struct {
+    char     magic[4];    /**< `BRU_PROGRAM_MAGIC` without its NUL byte       */
+    uint32_t version;     /**< `BRU_PROGRAM_VERSION` of the format            */
+    uint8_t  len_size;    /**< the number of bytes of `bru_len_t`             */
+    uint8_t  cntr_size;   /**< the number of bytes of `bru_cntr_t`            */
+    uint8_t  offset_size; /**< the number of bytes of `bru_offset_t`          */
+    uint8_t  flags;       /**< the `FLAG_*` bits set for the program          */
+    uint8_t  reserved[4]; /**< reserved for future versions (zeroed)          */
+
+    uint64_t regex_len;      /**< the number of bytes in the regex            */
+    uint64_t insts_len;      /**< the number of bytes of instructions         */
+    uint64_t aux_len;        /**< the number of bytes of auxillary memory     */
+    uint64_t nmemo_insts;    /**< the number of memoisation instructions      */
+    uint64_t ncounters;      /**< the number of counters                      */
+    uint64_t thread_mem_len; /**< the number of bytes of thread memory        */
+    uint64_t ncaptures;      /**< the number of captures                      */
+    uint64_t prefix_len;     /**< the number of bytes in the literal prefix   */
+} BruProgramHeader;
+
 /**< function type for printing an offset to a file stream */
 typedef void bru_offset_print_f(FILE             *stream,
                                 bru_offset_t      offset,
@@ -41,6 +69,9 @@ static void print_offset_as_offset(FILE             *stream,
                                    bru_offset_t      offset,
                                    const bru_byte_t *pc,
                                    const bru_byte_t *insts);
+static int save_section(FILE *stream, const void *section, size_t len);
+static int section_fits(size_t *size, uint64_t section_len, size_t len);
+static int program_verify(const BruProgram *prog);
 
 /* --- API function definitions --------------------------------------------- */
 
@@ -88,6 +119,7 @@ BruProgram *bru_program_default(const char *regex)
 void bru_program_free(BruProgram *self)
 {
     free((void *) self->regex);
+    if (self->prefix) free(self->prefix);
     stc_vec_free(self->insts);
     stc_vec_free(self->aux);
     stc_vec_free(self->counters);
@@ -108,6 +140,126 @@ void bru_program_print(const BruProgram *self, FILE *stream)
     }
 }
 
+int bru_program_save(const BruProgram *self, FILE *stream)
+{
+    BruProgramHeader header = { 0 };
+
+    memcpy(header.magic, BRU_PROGRAM_MAGIC, sizeof(header.magic));
+    header.version        = BRU_PROGRAM_VERSION;
+    header.len_size       = sizeof(bru_len_t);
+    header.cntr_size      = sizeof(bru_cntr_t);
+    header.offset_size    = sizeof(bru_offset_t);
+    header.regex_len      = self->regex ? strlen(self->regex) : 0;
+    header.insts_len      = stc_vec_len(self->insts);
+    header.aux_len        = stc_vec_len(self->aux);
+    header.nmemo_insts    = self->nmemo_insts;
+    header.ncounters      = stc_vec_len(self->counters);
+    header.thread_mem_len = self->thread_mem_len;
+    header.ncaptures      = self->ncaptures;
+    header.prefix_len     = self->prefix ? self->prefix_len : 0;
+    if (self->whole_match_capture) header.flags |= FLAG_WHOLE_MATCH_CAPTURE;
+
+    return fwrite(&header, sizeof(header), 1, stream) == 1 &&
+           save_section(stream, self->regex, header.regex_len) &&
+           save_section(stream, self->insts, header.insts_len) &&
+           save_section(stream, self->aux, header.aux_len) &&
+           save_section(stream, self->counters,
+                        header.ncounters * sizeof(bru_cntr_t)) &&
+           save_section(stream, self->prefix, header.prefix_len);
+}
+
+BruProgram *
+bru_program_load(const bru_byte_t *bytes, size_t len, size_t *nbytes)
+{
+    BruProgramHeader  header;
+    BruProgram       *prog;
+    const bru_byte_t *p;
+    char             *regex;
+    size_t            i, size = sizeof(header);
+    bru_cntr_t        c;
+
+    if (len < sizeof(header)) return NULL;
+    memcpy(&header, bytes, sizeof(header));
+    if (memcmp(header.magic, BRU_PROGRAM_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != BRU_PROGRAM_VERSION ||
+        header.len_size != sizeof(bru_len_t) ||
+        header.cntr_size != sizeof(bru_cntr_t) ||
+        header.offset_size != sizeof(bru_offset_t) ||
+        (header.flags & ~FLAG_WHOLE_MATCH_CAPTURE) != 0)
+        return NULL;
+    if (header.ncounters > len || !section_fits(&size, header.regex_len, len) ||
+        !section_fits(&size, header.insts_len, len) ||
+        !section_fits(&size, header.aux_len, len) ||
+        !section_fits(&size, header.ncounters * sizeof(bru_cntr_t), len) ||
+        !section_fits(&size, header.prefix_len, len))
+        return NULL;
+    // every capture, memoisation index, and byte of thread memory is used by
+    // at least one instruction, which bounds what the threads allocate
+    if (header.ncaptures > header.insts_len ||
+        header.nmemo_insts > header.insts_len ||
+        header.thread_mem_len > header.insts_len * sizeof(const char *))
+        return NULL;
+    // capture 0 can only span the whole match if the program has captures
+    if ((header.flags & FLAG_WHOLE_MATCH_CAPTURE) && header.ncaptures == 0)
+        return NULL;
+
+    p     = bytes + sizeof(header);
+    regex = malloc((header.regex_len + 1) * sizeof(char));
+    memcpy(regex, p, header.regex_len);
+    regex[header.regex_len]  = '\0';
+    p                       += BRU_ALIGN_UP(header.regex_len, SECTION_ALIGN);
+
+    prog = bru_program_default(regex);
+    BRU_MEMCPY(prog->insts, p, header.insts_len);
+    p += BRU_ALIGN_UP(header.insts_len, SECTION_ALIGN);
+    BRU_MEMCPY(prog->aux, p, header.aux_len);
+    p += BRU_ALIGN_UP(header.aux_len, SECTION_ALIGN);
+    for (i = 0; i < header.ncounters; i++) {
+        memcpy(&c, p + i * sizeof(c), sizeof(c));
+        stc_vec_push_back(prog->counters, c);
+    }
+    p += BRU_ALIGN_UP(header.ncounters * sizeof(c), SECTION_ALIGN);
+    prog->nmemo_insts         = header.nmemo_insts;
+    prog->thread_mem_len      = header.thread_mem_len;
+    prog->ncaptures           = header.ncaptures;
+    prog->whole_match_capture = header.flags & FLAG_WHOLE_MATCH_CAPTURE;
+    if (header.prefix_len > 0) {
+        prog->prefix = malloc((header.prefix_len + 1) * sizeof(char));
+        memcpy(prog->prefix, p, header.prefix_len);
+        prog->prefix[header.prefix_len] = '\0';
+        prog->prefix_len                = header.prefix_len;
+    }
+
+    if (!program_verify(prog)) {
+        bru_program_free(prog);
+        return NULL;
+    }
+
+    if (nbytes) *nbytes = size;
+
+    return prog;
+}
+
+const char *bru_program_find_prefix(const BruProgram *self,
+                                    const char       *sp,
+                                    const char       *text_end)
+{
+    const char *last;
+
+    // an SP past the end must not wrap around in the unsigned length below
+    if (sp > text_end) return NULL;
+    if (self->prefix == NULL) return sp;
+    if (sp >= text_end || (size_t) (text_end - sp) < self->prefix_len)
+        return NULL;
+
+    // look for the first byte with `memchr` before comparing the rest
+    for (last = text_end - self->prefix_len;
+         (sp = memchr(sp, *self->prefix, last - sp + 1)); sp++)
+        if (memcmp(sp, self->prefix, self->prefix_len) == 0) return sp;
+
+    return NULL;
+}
+
 void bru_inst_print(FILE *stream, const bru_byte_t *pc)
 {
     inst_print_formatted(stream, pc, NULL, print_predicate_as_index,
@@ -123,7 +275,7 @@ inst_print_formatted(FILE                  *stream,
                      bru_predicate_print_f *print_predicate,
                      bru_offset_print_f    *print_offset)
 {
-    char             *p;
+    const char       *p;
     const bru_byte_t *insts = prog ? prog->insts : NULL;
     const bru_byte_t *aux   = prog ? prog->aux : NULL;
     bru_cntr_t        c;
@@ -144,7 +296,7 @@ inst_print_formatted(FILE                  *stream,
             break;
 
         case BRU_CHAR:
-            BRU_MEMREAD(p, pc, char *);
+            BRU_CODEPOINTREAD(p, pc);
             fprintf(stream, "char %.*s", stc_utf8_nbytes(p), p);
             break;
 
@@ -154,6 +306,12 @@ inst_print_formatted(FILE                  *stream,
             print_predicate(stream, i, aux);
             break;
 
+        case BRU_BYTE:
+            fprintf(stream, "byte \\x%02x-\\x%02x", (unsigned char) pc[0],
+                    (unsigned char) pc[1]);
+            pc += 2 * sizeof(bru_byte_t);
+            break;
+
         case BRU_SAVE:
             BRU_MEMREAD(n, pc, bru_len_t);
             fprintf(stream, "save " BRU_LEN_FMT, n);
@@ -262,9 +420,7 @@ inst_print_formatted(FILE                  *stream,
 static void
 print_predicate_as_string(FILE *stream, bru_len_t idx, const bru_byte_t *aux)
 {
-    char *p = bru_intervals_to_str((const BruIntervals *) (aux + idx));
-    fputs(p, stream);
-    free(p);
+    fputs(BRU_PRED_STR(aux, idx), stream);
 }
 
 static void
@@ -289,9 +445,10 @@ static void print_offset_as_absolute_index(FILE             *stream,
             case BRU_BEGIN: /* fallthrough */
             case BRU_END: break;
             case BRU_MEMO: insts += sizeof(bru_len_t); break;
-            case BRU_CHAR: insts += sizeof(char *); break;
+            case BRU_CHAR: insts += stc_utf8_nbytes(insts); break;
             case BRU_PRED: /* fallthrough */
             case BRU_SAVE: insts += sizeof(bru_len_t); break;
+            case BRU_BYTE: insts += 2 * sizeof(bru_byte_t); break;
             case BRU_JMP:    /* fallthrough */
             case BRU_GSPLIT: /* fallthrough */
             case BRU_LSPLIT: insts += sizeof(bru_offset_t); break;
@@ -330,3 +487,222 @@ static void print_offset_as_offset(FILE             *stream,
     BRU_UNUSED(insts);
     fprintf(stream, BRU_OFFSET_FMT, offset);
 }
+
+/**
+ * Write a section of a program in the binary program format, padded to the
+ * alignment of sections.
+ *
+ * @param[in] stream  the file stream to write to
+ * @param[in] section the memory of the section
+ * @param[in] len     the number of bytes in the section
+ *
+ * @return truthy value if the section was written; else 0
+ */
+static int save_section(FILE *stream, const void *section, size_t len)
+{
+    static const char padding[SECTION_ALIGN] = { 0 };
+    size_t            npadding = BRU_ALIGN_UP(len, SECTION_ALIGN) - len;
+
+    return (len == 0 || fwrite(section, 1, len, stream) == len) &&
+           (npadding == 0 || fwrite(padding, 1, npadding, stream) == npadding);
+}
+
+/**
+ * Check that a section of a program in the binary program format fits in the
+ * memory after the sections before it, and add it to their size.
+ *
+ * @param[in,out] size        the number of bytes used by the previous sections
+ * @param[in]     section_len the number of bytes in the section
+ * @param[in]     len         the number of bytes of memory available
+ *
+ * @return truthy value if the section fits; else 0
+ */
+static int section_fits(size_t *size, uint64_t section_len, size_t len)
+{
+    if (section_len > len - *size ||
+        BRU_ALIGN_UP(section_len, SECTION_ALIGN) > len - *size)
+        return FALSE;
+
+    *size += BRU_ALIGN_UP(section_len, SECTION_ALIGN);
+
+    return TRUE;
+}
+
+/** Stop verifying a program as invalid unless the condition holds. */
+#define VERIFY(cond)            \
+    do {                        \
+        if (!(cond)) goto done; \
+    } while (0)
+
+/** Read an operand of the given type if it lies within the instructions. */
+#define VERIFY_READ(dst, type)                       \
+    do {                                             \
+        VERIFY((size_t) (end - pc) >= sizeof(type)); \
+        BRU_MEMREAD(dst, pc, type);                  \
+    } while (0)
+
+/** Read an offset and record its target to be checked once all are known. */
+#define VERIFY_TARGET()                                           \
+    do {                                                          \
+        VERIFY_READ(x, bru_offset_t);                             \
+        stc_vec_push_back(targets, (pc - insts) + (ptrdiff_t) x); \
+    } while (0)
+
+/**
+ * Verify the instructions of a loaded program, so that executing them never
+ * reads or writes outside the memory of the program or its threads.
+ *
+ * Every instruction must have a known bytecode and lie within the instruction
+ * stream, every offset (and every instruction continuing to the next) must
+ * reach the start of an instruction, and every index must lie within the
+ * auxillary memory, memoisation table, captures, thread memory, or counters
+ * it indexes.
+ *
+ * @param[in] prog the program to verify
+ *
+ * @return truthy value if the program is valid; else 0
+ */
+static int program_verify(const BruProgram *prog)
+{
+    const bru_byte_t        *insts = prog->insts, *pc = insts, *end;
+    const BruIntervalsTable *table;
+    size_t                   len     = stc_vec_len(insts), i;
+    size_t                   aux_len = stc_vec_len(prog->aux);
+    ptrdiff_t               *targets;
+    char                    *starts;
+    bru_offset_t             x;
+    bru_len_t                k;
+    int                      nbytes, continues, valid = FALSE;
+
+    if (len == 0) return FALSE;
+
+    end    = insts + len;
+    starts = calloc(len, sizeof(char));
+    stc_vec_default_init(targets);
+    while (pc < end) {
+        starts[pc - insts] = TRUE;
+        continues          = TRUE;
+        switch (*pc++) {
+            case BRU_NOOP:  /* fallthrough */
+            case BRU_BEGIN: /* fallthrough */
+            case BRU_END:   /* fallthrough */
+            case BRU_STATE: break;
+
+            case BRU_MATCH: continues = FALSE; break;
+
+            case BRU_MEMO:
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(k < prog->nmemo_insts);
+                break;
+
+            case BRU_CHAR:
+                VERIFY(pc < end && ((unsigned char) *pc & 0xC0) != 0x80);
+                nbytes = stc_utf8_nbytes(pc);
+                VERIFY(nbytes >= 1 && end - pc >= nbytes);
+                pc += nbytes;
+                break;
+
+            case BRU_PRED:
+                // the lookup table and the string after it must lie within
+                // the auxillary memory
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(k % _Alignof(BruIntervalsTable) == 0 &&
+                       aux_len >= sizeof(*table) &&
+                       k <= aux_len - sizeof(*table));
+                table = BRU_PRED_TABLE(prog->aux, k);
+                VERIFY(table->len <= (aux_len - k - sizeof(*table)) /
+                                         sizeof(*table->ranges));
+                i = k + bru_intervals_table_size(table);
+                VERIFY(memchr(prog->aux + i, '\0', aux_len - i));
+                break;
+
+            case BRU_BYTE:
+                VERIFY((size_t) (end - pc) >= 2 * sizeof(bru_byte_t));
+                pc += 2 * sizeof(bru_byte_t);
+                break;
+
+            case BRU_SAVE:
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(k < 2 * prog->ncaptures);
+                break;
+
+            case BRU_JMP:
+                VERIFY_TARGET();
+                continues = FALSE;
+                break;
+
+            case BRU_SPLIT:
+                VERIFY_TARGET();
+                VERIFY_TARGET();
+                continues = FALSE;
+                break;
+
+            case BRU_GSPLIT: /* fallthrough */
+            case BRU_LSPLIT: VERIFY_TARGET(); break;
+
+            case BRU_TSWITCH:
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(k > 0);
+                for (; k > 0; k--) VERIFY_TARGET();
+                continues = FALSE;
+                break;
+
+            case BRU_EPSRESET: /* fallthrough */
+            case BRU_EPSSET:   /* fallthrough */
+            case BRU_EPSCHK:
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(prog->thread_mem_len >= sizeof(const char *) &&
+                       k <= prog->thread_mem_len - sizeof(const char *));
+                break;
+
+            case BRU_RESET:
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(k < stc_vec_len(prog->counters));
+                VERIFY((size_t) (end - pc) >= sizeof(bru_cntr_t));
+                pc += sizeof(bru_cntr_t);
+                break;
+
+            case BRU_CMP:
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(k < stc_vec_len(prog->counters));
+                VERIFY((size_t) (end - pc) > sizeof(bru_cntr_t));
+                pc += sizeof(bru_cntr_t);
+                VERIFY(BRU_LT <= *pc && *pc <= BRU_GT);
+                pc++;
+                break;
+
+            case BRU_INC:
+                VERIFY_READ(k, bru_len_t);
+                VERIFY(k < stc_vec_len(prog->counters));
+                break;
+
+            case BRU_ZWA:
+                VERIFY_TARGET();
+                VERIFY_TARGET();
+                VERIFY(pc < end);
+                pc++;
+                continues = FALSE;
+                break;
+
+            default: goto done;
+        }
+
+        // the next instruction is reached like the target of a jump
+        if (continues) stc_vec_push_back(targets, pc - insts);
+    }
+
+    for (i = 0; i < stc_vec_len(targets); i++)
+        VERIFY(targets[i] >= 0 && (size_t) targets[i] < len &&
+               starts[targets[i]]);
+    valid = TRUE;
+
+done:
+    free(starts);
+    stc_vec_free(targets);
+
+    return valid;
+}
+
+#undef VERIFY
+#undef VERIFY_READ
+#undef VERIFY_TARGET
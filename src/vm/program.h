@@ -4,6 +4,7 @@
 #include <stdio.h>
 
 #include "../stc/fatp/vec.h"
+#include "../stc/util/utf.h"
 
 #include "../re/sre.h"
 #include "../types.h"
@@ -81,6 +82,81 @@
         (pc)  += sizeof(type);     \
     } while (0)
 
+/**
+ * Write the UTF-8 encoded codepoint to PC and move PC past the codepoint.
+ *
+ * @param[in,out] pc        the PC to write the codepoint to
+ * @param[in]     codepoint the UTF-8 encoded codepoint to write to PC
+ */
+#define BRU_CODEPOINTWRITE(pc, codepoint)                      \
+    do {                                                       \
+        memcpy((pc), (codepoint), stc_utf8_nbytes(codepoint)); \
+        (pc) += stc_utf8_nbytes(codepoint);                    \
+    } while (0)
+
+/**
+ * Point the destination at the UTF-8 encoded codepoint at PC, and move PC past
+ * the codepoint in the underlying byte stream.
+ *
+ * @param[in]     dst the destination to point at the codepoint
+ * @param[in,out] pc  the PC of the codepoint
+ */
+#define BRU_CODEPOINTREAD(dst, pc)     \
+    do {                               \
+        (dst)  = (pc);                 \
+        (pc)  += stc_utf8_nbytes(pc);  \
+    } while (0)
+
+/**
+ * Check whether a byte is in the byte range read from PC by a `byte`
+ * instruction.
+ *
+ * @param[in] pc the PC of the byte range
+ * @param[in] ch the byte to check
+ */
+#define BRU_BYTE_IN_RANGE(pc, ch)                       \
+    ((unsigned char) (pc)[0] <= (unsigned char) (ch) && \
+     (unsigned char) (ch) <= (unsigned char) (pc)[1])
+
+/**
+ * Check whether the whole UTF-8 codepoint at SP lies before the end of the
+ * text, so that consuming instructions never read past a range which ends
+ * part way through a codepoint.
+ *
+ * @param[in] sp       the string pointer
+ * @param[in] text_end the end of the text
+ */
+#define BRU_CODEPOINT_IN_TEXT(sp, text_end) \
+    ((sp) < (text_end) && (text_end) - (sp) >= stc_utf8_nbytes(sp))
+
+/**
+ * Get the lookup table of the predicate of a `pred` instruction.
+ *
+ * @param[in] aux the auxillary memory of the program
+ * @param[in] idx the index into the auxillary memory read from the instruction
+ */
+#define BRU_PRED_TABLE(aux, idx) ((const BruIntervalsTable *) ((aux) + (idx)))
+
+/**
+ * Get the string of the predicate of a `pred` instruction for printing, which
+ * is stored after its lookup table.
+ *
+ * @param[in] aux the auxillary memory of the program
+ * @param[in] idx the index into the auxillary memory read from the instruction
+ */
+#define BRU_PRED_STR(aux, idx) \
+    ((const char *) ((aux) + (idx) + \
+                     bru_intervals_table_size(BRU_PRED_TABLE(aux, idx))))
+
+/** The magic number at the start of a program in the binary program format. */
+#define BRU_PROGRAM_MAGIC "BRUP"
+
+/**
+ * The version of the binary program format, which changes whenever the format
+ * or the encoding of instructions changes.
+ */
+#define BRU_PROGRAM_VERSION 1
+
 /* --- Type definitions ----------------------------------------------------- */
 
 /* Bytecodes */
@@ -105,7 +181,8 @@
 #define BRU_INC        18
 #define BRU_ZWA        19
 #define BRU_STATE      20
-#define BRU_NBYTECODES 21
+#define BRU_BYTE       21
+#define BRU_NBYTECODES 22
 
 /* Order for cmp */
 #define BRU_LT 1
@@ -115,6 +192,16 @@
 #define BRU_GE 5
 #define BRU_GT 6
 
+/**
+ * A compiled regex program.
+ *
+ * A program is never modified once compiled or loaded: the SRVM, thread
+ * managers, DFA, and JIT only read it through `const BruProgram *`, and keep
+ * all state of execution (e.g., decoded instructions and memoisation tables)
+ * in their own memory. A program can therefore be shared read-only by any
+ * number of threads, as long as each thread executes it with its own SRVM and
+ * thread manager, DFA, or JIT, and the program outlives them.
+ */
 typedef struct {
     const char *regex; /**< the original regular expression string            */
 
@@ -129,6 +216,13 @@ typedef struct {
     bru_cntr_t *counters;  /**< stc_vec of the counter memory default values  */
     size_t thread_mem_len; /**< the number of bytes needed for thread memory  */
     size_t ncaptures;      /**< the number of captures in the program/regex   */
+
+    // search
+    char  *prefix;     /**< literal every match starts with (NULL if none)    */
+    size_t prefix_len; /**< the number of bytes in the literal prefix         */
+
+    // captures
+    int whole_match_capture; /**< whether capture 0 spans the whole match     */
 } BruProgram;
 
 #if !defined(BRU_VM_PROGRAM_DISABLE_SHORT_NAMES) && \
@@ -143,6 +237,16 @@ typedef struct {
 #    define MEMCPY   BRU_MEMCPY
 #    define MEMREAD  BRU_MEMREAD
 
+#    define BYTE_IN_RANGE     BRU_BYTE_IN_RANGE
+#    define CODEPOINT_IN_TEXT BRU_CODEPOINT_IN_TEXT
+#    define PRED_TABLE        BRU_PRED_TABLE
+#    define PRED_STR          BRU_PRED_STR
+#    define CODEPOINTWRITE    BRU_CODEPOINTWRITE
+#    define CODEPOINTREAD     BRU_CODEPOINTREAD
+
+#    define PROGRAM_MAGIC   BRU_PROGRAM_MAGIC
+#    define PROGRAM_VERSION BRU_PROGRAM_VERSION
+
 #    define NOOP       BRU_NOOP
 #    define MATCH      BRU_MATCH
 #    define BEGIN      BRU_BEGIN
@@ -164,6 +268,7 @@ typedef struct {
 #    define INC        BRU_INC
 #    define ZWA        BRU_ZWA
 #    define STATE      BRU_STATE
+#    define BYTE       BRU_BYTE
 #    define NBYTECODES BRU_NBYTECODES
 
 #    define LT BRU_LT
@@ -175,11 +280,14 @@ typedef struct {
 
 typedef BruProgram Program;
 
-#    define program_new     bru_program_new
-#    define program_default bru_program_default
-#    define program_free    bru_program_free
-#    define program_print   bru_program_print
-#    define inst_print      bru_inst_print
+#    define program_new         bru_program_new
+#    define program_default     bru_program_default
+#    define program_free        bru_program_free
+#    define program_print       bru_program_print
+#    define inst_print          bru_inst_print
+#    define program_find_prefix bru_program_find_prefix
+#    define program_save        bru_program_save
+#    define program_load        bru_program_load
 #endif /* BRU_VM_PROGRAM_ENABLE_SHORT_NAMES */
 
 /* --- Program function prototypes ------------------------------------------ */
@@ -234,6 +342,62 @@ void bru_program_free(BruProgram *self);
  */
 void bru_program_print(const BruProgram *self, FILE *stream);
 
+/**
+ * Write the program to the file stream in the binary program format, so that it
+ * can be loaded with `bru_program_load` without parsing and compiling its regex
+ * again.
+ *
+ * The format starts with a header of the magic number, version, and lengths,
+ * followed by the regex, instruction stream, auxillary memory, counters, and
+ * literal prefix of the program, each padded to a multiple of 8 bytes. As the
+ * instructions contain no pointers, the program is relocatable, however it is
+ * written in the byte order of the machine.
+ *
+ * Programs can be written one after the other into the same file stream.
+ *
+ * @param[in] self   the program to write
+ * @param[in] stream the file stream to write to
+ *
+ * @return truthy value if the program was written; else 0
+ */
+int bru_program_save(const BruProgram *self, FILE *stream);
+
+/**
+ * Load a program written by `bru_program_save` from memory, such as a file of
+ * programs mapped into memory.
+ *
+ * The header and instructions of the program are verified before it is
+ * returned, so that executing it never reads or writes outside the memory of
+ * the program or its threads. The instructions need not match the regex.
+ *
+ * @param[in]  bytes  the memory of the program in the binary program format
+ * @param[in]  len    the number of bytes of memory available
+ * @param[out] nbytes the number of bytes the program used in memory, which is
+ *                    where the next program in the memory starts (ignored if
+ *                    NULL)
+ *
+ * @return the loaded program if the memory holds a valid program with the
+ *         current version of the format; else NULL
+ */
+BruProgram *
+bru_program_load(const bru_byte_t *bytes, size_t len, size_t *nbytes);
+
+/**
+ * Find the next position at or after the SP where the literal prefix of the
+ * program occurs, as no match can start anywhere before it.
+ *
+ * @param[in] self     the program
+ * @param[in] sp       the SP to start searching from
+ * @param[in] text_end the end of the input string
+ *
+ * @return the SP if the program has no literal prefix, the position of the
+ *         next occurrence of the literal prefix if there is one; else NULL,
+ *         which is also returned for an SP past the end of the input string
+ */
+const char *bru_program_find_prefix(const BruProgram *self,
+                                    const char       *sp,
+                                    const char       *text_end);
+
 /**
  * Print an instruction to the file stream, with its operands.
  *
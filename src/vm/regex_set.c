@@ -0,0 +1,310 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../fa/constructions/glushkov.h"
+#include "../fa/constructions/thompson.h"
+#include "../fa/transformers/flatten.h"
+#include "../fa/transformers/search.h"
+#include "../re/sre.h"
+#include "../utils.h"
+#include "regex_set.h"
+#include "srvm.h"
+#include "thread_managers/lockstep.h"
+#include "thread_managers/set_matches.h"
+
+/* --- Type definitions ----------------------------------------------------- */
+
+struct bru_regex_set {
+    size_t      nregexes; /**< the number of regexes in the set               */
+    BruProgram *prog;     /**< the program the regexes are compiled into      */
+    bru_byte_t *matched;  /**< flags of which regexes matched the last input  */
+    BruSRVM    *srvm;     /**< the SRVM executing the program                 */
+};
+
+/* --- Helper function prototypes ------------------------------------------- */
+
+static BruStateMachine *construct(const char            *regex,
+                                  BruParserOpts          parser_opts,
+                                  const BruCompilerOpts *compiler_opts);
+static size_t           smir_union(BruStateMachine *sm,
+                                   BruStateMachine *other,
+                                   bru_state_id     accept,
+                                   size_t           rid);
+static BruActionList   *
+clone_actions(const BruActionList *acts, size_t rid, size_t *rid_end);
+
+/* --- API function definitions --------------------------------------------- */
+
+BruRegexSet *bru_regex_set_new(const char *const *regexes,
+                               size_t             nregexes,
+                               BruParserOpts      parser_opts,
+                               BruCompilerOpts    compiler_opts,
+                               size_t            *invalid)
+{
+    BruRegexSet      *set;
+    BruStateMachine  *sm, *other;
+    BruThreadManager *thread_manager;
+    bru_state_id     *sid_ordering;
+    const bru_byte_t *matches;
+    char             *regex;
+    size_t            i, len, nstates, rid;
+
+    // the regexes are joined as the regex of the program, which frees it
+    for (i = 0, len = 0; i < nregexes; i++) len += strlen(regexes[i]) + 1;
+    regex = malloc((len ? len : 1) * sizeof(char));
+    for (i = 0, len = 0; i < nregexes; i++) {
+        memcpy(regex + len, regexes[i], strlen(regexes[i]));
+        len          += strlen(regexes[i]);
+        regex[len++]  = '\n';
+    }
+    regex[len ? len - 1 : 0] = '\0';
+
+    // the accepting states are added first so that every regex can refer to
+    // its accepting state, even from its initial transitions
+    sm = bru_smir_default(regex);
+    for (i = 0; i < nregexes; i++)
+        bru_smir_state_append_action(sm, bru_smir_add_state(sm),
+                                     bru_smir_action_match());
+
+    for (i = 0, rid = 0; i < nregexes; i++) {
+        if (!(other = construct(regexes[i], parser_opts, &compiler_opts))) {
+            if (invalid) *invalid = i;
+            bru_smir_free(sm);
+            free(regex);
+            return NULL;
+        }
+        rid = smir_union(sm, other, i + 1, rid);
+        bru_smir_free(other);
+    }
+
+    // compile in the implicit `.*?` loop for single-pass unanchored search
+    sm = bru_transform_search(sm, compiler_opts.byte_level);
+
+    // move the accepting states last, so that their `match` instructions are
+    // compiled consecutively right before the `match` of the final state
+    nstates      = bru_smir_get_num_states(sm);
+    sid_ordering = malloc(nstates * sizeof(*sid_ordering));
+    for (i = 0; i < nstates; i++)
+        sid_ordering[i] = i < nregexes ? nstates - nregexes + i + 1
+                                       : i - nregexes + 1;
+    bru_smir_reorder_states(sm, sid_ordering);
+    free(sid_ordering);
+
+    set           = malloc(sizeof(*set));
+    set->nregexes = nregexes;
+    set->prog     = bru_smir_compile(sm);
+    set->matched  = calloc(nregexes ? nregexes : 1, sizeof(*set->matched));
+    bru_smir_free(sm);
+
+    matches = set->prog->insts + stc_vec_len_unsafe(set->prog->insts) -
+              nregexes - 1;
+    for (i = 0; i < nregexes; i++) assert(matches[i] == BRU_MATCH);
+
+    thread_manager = bru_thompson_thread_manager_new(
+        0, set->prog->thread_mem_len, set->prog->ncaptures,
+        parser_opts.logfile);
+    thread_manager = bru_set_matches_thread_manager_new(
+        thread_manager, matches, nregexes, set->matched);
+    set->srvm = bru_srvm_new(thread_manager, set->prog, BRU_SRVM_THREADED);
+
+    return set;
+}
+
+void bru_regex_set_free(BruRegexSet *self)
+{
+    if (!self) return;
+
+    bru_srvm_free(self->srvm);
+    bru_program_free(self->prog);
+    free(self->matched);
+    free(self);
+}
+
+size_t bru_regex_set_len(const BruRegexSet *self) { return self->nregexes; }
+
+const BruProgram *bru_regex_set_program(const BruRegexSet *self)
+{
+    return self->prog;
+}
+
+size_t bru_regex_set_matches(BruRegexSet *self, const char *text, size_t *ids)
+{
+    if (text == NULL) return 0;
+
+    return bru_regex_set_matches_n(self, text, strlen(text), ids);
+}
+
+size_t bru_regex_set_matches_n(BruRegexSet *self,
+                               const char  *text,
+                               size_t       text_len,
+                               size_t      *ids)
+{
+    size_t i, n;
+
+    if (text == NULL) return 0;
+
+    bru_srvm_match_n(self->srvm, text, text_len);
+    for (i = 0, n = 0; i < self->nregexes; i++)
+        if (self->matched[i]) {
+            if (ids) ids[n] = i;
+            n++;
+        }
+
+    return n;
+}
+
+/* --- Helper function definitions ------------------------------------------ */
+
+/**
+ * Parse a regex and construct its state machine without the implicit `.*?`
+ * loop.
+ *
+ * @param[in] regex         the regex
+ * @param[in] parser_opts   the options for parsing the regex
+ * @param[in] compiler_opts the options for constructing the state machine
+ *
+ * @return the state machine if the regex could be parsed; else NULL
+ */
+static BruStateMachine *construct(const char            *regex,
+                                  BruParserOpts          parser_opts,
+                                  const BruCompilerOpts *compiler_opts)
+{
+    BruParser       *parser;
+    BruParseResult   res;
+    BruRegex         re;
+    BruStateMachine *sm = NULL, *tmp;
+
+    parser = bru_parser_new(regex, parser_opts);
+    res    = bru_parser_parse(parser, &re);
+    bru_parser_free(parser);
+    if (res.code != BRU_PARSE_SUCCESS) return NULL;
+
+    if (compiler_opts->byte_level) re.root = bru_regex_to_bytes(re.root);
+    switch (compiler_opts->construction) {
+        case BRU_THOMPSON:
+            sm = bru_thompson_construct(re, compiler_opts);
+            break;
+
+        case BRU_GLUSHKOV:
+            sm = bru_glushkov_construct(re, compiler_opts);
+            break;
+
+        case BRU_FLAT:
+            tmp = bru_thompson_construct(re, compiler_opts);
+            sm  = bru_transform_flatten(tmp, parser_opts.logfile);
+            bru_smir_free(tmp);
+            break;
+    }
+    bru_regex_node_free(re.root);
+
+    return sm;
+}
+
+/**
+ * Copy the states and transitions of a state machine into another, where the
+ * transitions to the final state go to the given accepting state instead.
+ *
+ * The regex identifiers of the copied actions are offset by the given regex
+ * identifier so that they do not clash with those of the other state machines
+ * in the union.
+ *
+ * @param[in] sm     the state machine to copy into
+ * @param[in] other  the state machine to copy
+ * @param[in] accept the accepting state in `sm` for the final state of `other`
+ * @param[in] rid    the first regex identifier free in `sm`
+ *
+ * @return the first regex identifier free in `sm` after the copy
+ */
+static size_t smir_union(BruStateMachine *sm,
+                         BruStateMachine *other,
+                         bru_state_id     accept,
+                         size_t           rid)
+{
+    bru_state_id *sids, sid, dst;
+    bru_trans_id *out, tid;
+    size_t        i, n, nstates, rid_end = rid;
+
+    nstates = bru_smir_get_num_states(other);
+    sids    = malloc((nstates + 1) * sizeof(*sids));
+    sids[BRU_FINAL_STATE_ID] = accept;
+    for (sid = 1; sid <= nstates; sid++) {
+        sids[sid] = bru_smir_add_state(sm);
+        bru_smir_state_set_actions(
+            sm, sids[sid],
+            clone_actions(bru_smir_state_get_actions(other, sid), rid,
+                          &rid_end));
+    }
+
+    // the initial state is shared, so its transitions are added to it
+    for (sid = 0; sid <= nstates; sid++) {
+        out = bru_smir_get_out_transitions(other, sid, &n);
+        for (i = 0; i < n; i++) {
+            dst = sids[bru_smir_get_dst(other, out[i])];
+            if (BRU_IS_INITIAL_STATE(sid)) {
+                tid = bru_smir_set_initial(sm, dst);
+            } else {
+                tid = bru_smir_add_transition(sm, sids[sid]);
+                bru_smir_set_dst(sm, tid, dst);
+            }
+            bru_smir_trans_set_actions(
+                sm, tid,
+                clone_actions(bru_smir_trans_get_actions(other, out[i]), rid,
+                              &rid_end));
+        }
+        if (out) free(out);
+    }
+    free(sids);
+
+    return rid_end;
+}
+
+/**
+ * Clone a list of actions for the union, leaving out capture actions and
+ * offsetting the regex identifiers of the actions using them.
+ *
+ * @param[in]     acts    the list of actions to clone
+ * @param[in]     rid     the offset for the regex identifiers
+ * @param[in,out] rid_end one past the largest offset regex identifier
+ *
+ * @return the cloned list of actions
+ */
+static BruActionList *
+clone_actions(const BruActionList *acts, size_t rid, size_t *rid_end)
+{
+    BruActionList         *clone = bru_smir_action_list_new();
+    BruActionListIterator *ali;
+    const BruAction       *act;
+    size_t                 k;
+
+    if (!acts) return clone;
+
+    ali = bru_smir_action_list_iter(acts);
+    while ((act = bru_smir_action_list_iterator_next(ali))) {
+        switch (bru_smir_action_type(act)) {
+            case BRU_ACT_SAVE: break;
+
+            case BRU_ACT_MEMO:   /* fallthrough */
+            case BRU_ACT_EPSCHK: /* fallthrough */
+            case BRU_ACT_EPSSET:
+                k = rid + bru_smir_action_get_num(act);
+                if (k >= *rid_end) *rid_end = k + 1;
+                bru_smir_action_list_push_back(
+                    clone, bru_smir_action_num(bru_smir_action_type(act), k));
+                break;
+
+            case BRU_ACT_BEGIN: /* fallthrough */
+            case BRU_ACT_END:   /* fallthrough */
+            case BRU_ACT_CHAR:  /* fallthrough */
+            case BRU_ACT_PRED:  /* fallthrough */
+            case BRU_ACT_BYTE:  /* fallthrough */
+            case BRU_ACT_MATCH:
+                bru_smir_action_list_push_back(clone,
+                                               bru_smir_action_clone(act));
+                break;
+        }
+    }
+    free(ali);
+
+    return clone;
+}
@@ -0,0 +1,118 @@
+#ifndef BRU_VM_REGEX_SET_H
+#define BRU_VM_REGEX_SET_H
+
+#include <stddef.h>
+
+#include "../re/parser.h"
+#include "compiler.h"
+#include "program.h"
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct bru_regex_set BruRegexSet;
+
+#if !defined(BRU_VM_REGEX_SET_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_REGEX_SET_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&          \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) ||       \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+typedef BruRegexSet RegexSet;
+
+#    define regex_set_new       bru_regex_set_new
+#    define regex_set_free      bru_regex_set_free
+#    define regex_set_len       bru_regex_set_len
+#    define regex_set_program   bru_regex_set_program
+#    define regex_set_matches   bru_regex_set_matches
+#    define regex_set_matches_n bru_regex_set_matches_n
+#endif /* BRU_VM_REGEX_SET_ENABLE_SHORT_NAMES */
+
+/* --- RegexSet function prototypes ----------------------------------------- */
+
+/**
+ * Compile a set of regexes into a single program which finds which of the
+ * regexes match an input string in one pass.
+ *
+ * The state machines of the regexes are unioned into one state machine with an
+ * implicit `.*?` loop for unanchored search, where each regex ends in its own
+ * accepting state compiled to a distinct `match` instruction. The program is
+ * executed by the lockstep thread manager, and a match of one regex does not
+ * stop the threads of the others.
+ *
+ * Captures are not reported, so capture instructions are left out of the
+ * program. The memoisation scheme and state markers of the compiler options
+ * are ignored as the lockstep thread manager does not memoise.
+ *
+ * @param[in]  regexes       the regexes of the set
+ * @param[in]  nregexes      the number of regexes
+ * @param[in]  parser_opts   the options for parsing each regex
+ * @param[in]  compiler_opts the options for constructing each regex
+ * @param[out] invalid       the index of the regex which could not be parsed
+ *                           if the set could not be compiled (may be NULL)
+ *
+ * @return the compiled set if every regex could be parsed; else NULL
+ */
+BruRegexSet *bru_regex_set_new(const char *const *regexes,
+                               size_t             nregexes,
+                               BruParserOpts      parser_opts,
+                               BruCompilerOpts    compiler_opts,
+                               size_t            *invalid);
+
+/**
+ * Free the memory allocated for the set, including its program.
+ *
+ * @param[in] self the set to free
+ */
+void bru_regex_set_free(BruRegexSet *self);
+
+/**
+ * Get the number of regexes in the set.
+ *
+ * @param[in] self the set
+ *
+ * @return the number of regexes
+ */
+size_t bru_regex_set_len(const BruRegexSet *self);
+
+/**
+ * Get the program the regexes of the set are compiled into.
+ *
+ * @param[in] self the set
+ *
+ * @return the program of the set
+ */
+const BruProgram *bru_regex_set_program(const BruRegexSet *self);
+
+/**
+ * Find which regexes of the set match anywhere inside the input string.
+ *
+ * @param[in]  self the set to execute
+ * @param[in]  text the input string to match against
+ * @param[out] ids  the indices of the matching regexes in increasing order,
+ *                  with room for every regex of the set (may be NULL)
+ *
+ * @return the number of matching regexes
+ */
+size_t bru_regex_set_matches(BruRegexSet *self, const char *text, size_t *ids);
+
+/**
+ * Find which regexes of the set match anywhere inside the input string of given
+ * length.
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in]  self     the set to execute
+ * @param[in]  text     the input string to match against
+ * @param[in]  text_len the number of bytes in the input string
+ * @param[out] ids      the indices of the matching regexes in increasing
+ *                      order, with room for every regex of the set (may be
+ *                      NULL)
+ *
+ * @return the number of matching regexes
+ */
+size_t bru_regex_set_matches_n(BruRegexSet *self,
+                               const char  *text,
+                               size_t       text_len,
+                               size_t      *ids);
+
+#endif /* BRU_VM_REGEX_SET_H */
@@ -1,38 +1,110 @@
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "dfa.h"
 #include "program.h"
 #include "srvm.h"
 
+#if defined(__GNUC__) || defined(__clang__)
+#    define SRVM_COMPUTED_GOTO
+#endif
+
 /* --- Type definitions ----------------------------------------------------- */
 
+typedef struct {
+    const void       *label; /**< address of the handler of the instruction   */
+    const bru_byte_t *next;  /**< PC after the instruction, or jump target    */
+    const bru_byte_t *alt;   /**< second jump target for `split` and `zwa`    */
+
+    union {
+        const char              *codepoint; /**< codepoint for `char`         */
+        const BruIntervalsTable *table;     /**< lookup table for `pred`      */
+        const bru_byte_t        *offsets;   /**< offsets for `tswitch`        */
+    };
+
+    bru_len_t     k;     /**< index (or number of offsets) operand            */
+    bru_cntr_t    n;     /**< counter value operand for `reset` and `cmp`     */
+    bru_byte_t    order; /**< order for `cmp`                                 */
+    unsigned char lbyte; /**< lower bound of the byte range for `byte`        */
+    unsigned char ubyte; /**< upper bound of the byte range for `byte`        */
+} BruSRVMInst;
+
 struct bru_srvm {
     BruThreadManager *thread_manager; /**< the thread manager to execute with */
     const BruProgram *program;        /**< the program of the SRVM to execute */
+    const char       *text;           /**< the start of the input string      */
     const char       *curr_sp;        /**< the SP to generate threads from    */
     int          matching_finished;   /**< flag to indicate matching is done  */
-    bru_len_t    ncaptures; /**< the number of captures in the program        */
-    const char **captures;  /**< the array of (start, end) capture pairs      */
+    bru_len_t    ncaptures;   /**< the number of captures in the program      */
+    const char **captures;    /**< the array of (start, end) capture pairs    */
+    const char  *match_start; /**< the start of the last match, if known      */
+    const char  *match_end;   /**< the end of the last match                  */
+
+    BruSRVMDispatch dispatch; /**< how the SRVM dispatches instructions       */
+    BruSRVMInst    *decoded;  /**< decoded instructions by bytecode offset    */
+
+    // search strategy
+    BruSRVMSearch search;      /**< how the SRVM searches for matches         */
+    BruDFA       *dfa;         /**< DFA finding the end of each match         */
+    BruDFA       *reverse_dfa; /**< DFA finding the start of each match       */
+
+    // streaming
+    size_t  stream_offset;   /**< offset of the next chunk in the stream      */
+    size_t  stream_match;    /**< offset of the end of the match in stream    */
+    size_t *stream_captures; /**< array of (start, end) capture offset pairs  */
+    char    carry[4];  /**< bytes of a codepoint split between chunks         */
+    size_t  carry_len; /**< the number of bytes in `carry`                    */
 };
 
 /* --- Private function prototypes ------------------------------------------ */
 
-static int srvm_run(BruSRVM *self, const char *text);
+static int srvm_run(BruSRVM *self, const char *text, const char *text_end);
+static int
+srvm_run_reverse(BruSRVM *self, const char *text, const char *text_end);
+static int srvm_exec(BruSRVM     *self,
+                     const char  *text,
+                     const char  *text_end,
+                     const char **matched_sp);
+static void
+srvm_stream_chunk(BruSRVM *self, const char *chunk, size_t chunk_len, int more);
+#ifdef SRVM_COMPUTED_GOTO
+static int          srvm_run_threaded(BruSRVM     *self,
+                                      const char  *text,
+                                      const char  *text_end,
+                                      const char **matched_sp);
+static BruSRVMInst *srvm_decode(const BruProgram  *prog,
+                                const void *const *labels);
+#endif /* SRVM_COMPUTED_GOTO */
 
 /* --- API function definitions --------------------------------------------- */
 
-BruSRVM *bru_srvm_new(BruThreadManager *thread_manager, const BruProgram *prog)
+BruSRVM *bru_srvm_new(BruThreadManager *thread_manager,
+                      const BruProgram *prog,
+                      BruSRVMDispatch   dispatch)
 {
     BruSRVM *srvm = malloc(sizeof(*srvm));
 
     srvm->thread_manager    = thread_manager;
     srvm->program           = prog;
+    srvm->text              = NULL;
     srvm->curr_sp           = NULL;
     srvm->matching_finished = FALSE;
     srvm->ncaptures         = prog->ncaptures;
     srvm->captures          = malloc(2 * srvm->ncaptures * sizeof(char *));
     memset(srvm->captures, 0, 2 * srvm->ncaptures * sizeof(char *));
+    srvm->match_start     = NULL;
+    srvm->match_end       = NULL;
+    srvm->dispatch        = dispatch;
+    srvm->decoded         = NULL;
+    srvm->search          = BRU_SRVM_SEARCH_FORWARD;
+    srvm->dfa             = NULL;
+    srvm->reverse_dfa     = NULL;
+    srvm->stream_offset   = 0;
+    srvm->stream_match    = SIZE_MAX;
+    srvm->stream_captures = malloc(2 * srvm->ncaptures * sizeof(size_t));
+    srvm->carry_len       = 0;
 
     return srvm;
 }
@@ -41,25 +113,104 @@ void bru_srvm_free(BruSRVM *self)
 {
     bru_thread_manager_free(self->thread_manager);
     free(self->captures);
+    free(self->decoded);
+    free(self->stream_captures);
+    if (self->dfa) bru_dfa_free(self->dfa);
+    if (self->reverse_dfa) bru_dfa_free(self->reverse_dfa);
     free(self);
 }
 
+int bru_srvm_set_search(BruSRVM          *self,
+                        BruSRVMSearch     search,
+                        const BruProgram *reverse_prog,
+                        FILE             *logfile)
+{
+    BruDFA *dfa = NULL, *reverse_dfa = NULL;
+
+    if (search == BRU_SRVM_SEARCH_REVERSE &&
+        (!(dfa = bru_dfa_new(self->program, BRU_DFA_CACHE_SIZE_DEFAULT,
+                             logfile)) ||
+         !(reverse_dfa = bru_dfa_new_reverse(
+               reverse_prog, BRU_DFA_CACHE_SIZE_DEFAULT, logfile)))) {
+        if (dfa) bru_dfa_free(dfa);
+        return FALSE;
+    }
+
+    if (self->dfa) bru_dfa_free(self->dfa);
+    if (self->reverse_dfa) bru_dfa_free(self->reverse_dfa);
+    self->search      = search;
+    self->dfa         = dfa;
+    self->reverse_dfa = reverse_dfa;
+
+    return TRUE;
+}
+
 int bru_srvm_match(BruSRVM *self, const char *text)
 {
     if (text == NULL) return 0;
 
+    return bru_srvm_match_n(self, text, strlen(text));
+}
+
+int bru_srvm_match_n(BruSRVM *self, const char *text, size_t text_len)
+{
+    if (text == NULL) return 0;
+
+    self->text              = text;
     self->curr_sp           = text;
     self->matching_finished = FALSE;
     memset(self->captures, 0, 2 * self->ncaptures * sizeof(char *));
     bru_thread_manager_reset(self->thread_manager);
 
-    return srvm_run(self, text);
+    return srvm_run(self, text, text + text_len);
+}
+
+int bru_srvm_is_match(BruSRVM *self, const char *text)
+{
+    if (text == NULL) return 0;
+
+    return bru_srvm_is_match_n(self, text, strlen(text));
+}
+
+int bru_srvm_is_match_n(BruSRVM *self, const char *text, size_t text_len)
+{
+    const BruProgram *prog     = self->program;
+    BruThreadManager *tm       = self->thread_manager;
+    const char       *text_end, *sp;
+    int               matched;
+
+    if (text == NULL) return 0;
+    text_end = text + text_len;
+
+    // the forward DFA of the reverse search already decides whether there is a
+    // match without executing the program
+    if (self->search == BRU_SRVM_SEARCH_REVERSE)
+        return bru_dfa_match_end(self->dfa, text, text, text_end) != NULL;
+
+    bru_thread_manager_reset(tm);
+    if (!(sp = bru_program_find_prefix(prog, text, text_end))) return FALSE;
+
+    bru_thread_manager_init_memoisation(tm, prog->nmemo_insts, text, text_len);
+    bru_thread_manager_init(tm, prog->insts, sp, text_end);
+    matched = srvm_exec(self, text, text_end, NULL);
+    // the threads which were not run before the first match are left behind
+    bru_thread_manager_reset(tm);
+
+    return matched;
 }
 
 int bru_srvm_find(BruSRVM *self, const char *text)
 {
     if (text == NULL) return 0;
 
+    return bru_srvm_find_n(self, text, strlen(text));
+}
+
+int bru_srvm_find_n(BruSRVM *self, const char *text, size_t text_len)
+{
+    if (text == NULL) return 0;
+
+    self->text = text;
     if (self->curr_sp == NULL) {
         self->curr_sp           = text;
         self->matching_finished = FALSE;
@@ -67,7 +218,33 @@ int bru_srvm_find(BruSRVM *self, const char *text)
     }
     memset(self->captures, 0, 2 * self->ncaptures * sizeof(char *));
 
-    return srvm_run(self, text);
+    return srvm_run(self, text, text + text_len);
+}
+
+int bru_srvm_find_iter(BruSRVM    *self,
+                       const char *text,
+                       size_t      text_len,
+                       size_t     *offsets,
+                       size_t      noffsets)
+{
+    if (!bru_srvm_find_n(self, text, text_len)) {
+        // the next call starts a new iteration
+        self->curr_sp = NULL;
+        return FALSE;
+    }
+
+    if (noffsets > 0) {
+        if (self->match_start)
+            offsets[0] = self->match_start - text;
+        else if (self->program->whole_match_capture && self->captures[0])
+            offsets[0] = self->captures[0] - text;
+        else
+            offsets[0] = SIZE_MAX;
+    }
+    if (noffsets > 1) offsets[1] = self->match_end - text;
+    if (noffsets > 2) bru_srvm_captures_into(self, offsets + 2, noffsets - 2);
+
+    return TRUE;
 }
 
 StcStringView bru_srvm_capture(BruSRVM *self, bru_len_t idx)
@@ -91,11 +268,108 @@ StcStringView *bru_srvm_captures(BruSRVM *self, bru_len_t *ncaptures)
     return captures;
 }
 
+bru_len_t bru_srvm_captures_into(BruSRVM *self, size_t *offsets, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n && i < 2 * (size_t) self->ncaptures; i++)
+        offsets[i] = self->captures[i]
+                         ? (size_t) (self->captures[i] - self->text)
+                         : SIZE_MAX;
+
+    return self->ncaptures;
+}
+
+int bru_srvm_stream_begin(BruSRVM *self)
+{
+    bru_len_t i;
+
+    if (!self->thread_manager->stream) return FALSE;
+
+    self->curr_sp           = NULL;
+    self->matching_finished = FALSE;
+    self->stream_offset     = 0;
+    self->stream_match      = SIZE_MAX;
+    self->carry_len         = 0;
+    for (i = 0; i < 2 * self->ncaptures; i++)
+        self->stream_captures[i] = SIZE_MAX;
+    bru_thread_manager_reset(self->thread_manager);
+
+    return TRUE;
+}
+
+int bru_srvm_stream_feed(BruSRVM *self, const char *chunk, size_t chunk_len)
+{
+    size_t n, len;
+
+    if (self->matching_finished) return FALSE;
+
+    // complete the codepoint split from the previous chunk
+    if (self->carry_len > 0) {
+        len = stc_utf8_nbytes(self->carry);
+        n   = len - self->carry_len < chunk_len ? len - self->carry_len
+                                                : chunk_len;
+        memcpy(self->carry + self->carry_len, chunk, n);
+        self->carry_len += n;
+        chunk           += n;
+        chunk_len       -= n;
+        if (self->carry_len < len) return TRUE;
+        self->carry_len = 0;
+        srvm_stream_chunk(self, self->carry, len, TRUE);
+        if (self->matching_finished) return FALSE;
+    }
+
+    // hold back a codepoint split at the end of the chunk
+    for (n = chunk_len; n > 0 && chunk_len - n < sizeof(self->carry); n--) {
+        if ((chunk[n - 1] & 0xC0) == 0x80) continue;
+        if (n - 1 + stc_utf8_nbytes(chunk + n - 1) > chunk_len) {
+            self->carry_len = chunk_len - (n - 1);
+            memcpy(self->carry, chunk + n - 1, self->carry_len);
+            chunk_len = n - 1;
+        }
+        break;
+    }
+
+    if (chunk_len > 0) srvm_stream_chunk(self, chunk, chunk_len, TRUE);
+
+    return !self->matching_finished;
+}
+
+int bru_srvm_stream_end(BruSRVM *self)
+{
+    // a codepoint split at the end of the input is matched as it is
+    if (!self->matching_finished && self->carry_len > 0) {
+        memset(self->carry + self->carry_len, 0,
+               sizeof(self->carry) - self->carry_len);
+        srvm_stream_chunk(self, self->carry, self->carry_len, FALSE);
+        self->carry_len = 0;
+    }
+    if (!self->matching_finished) srvm_stream_chunk(self, "", 0, FALSE);
+
+    return self->stream_match != SIZE_MAX;
+}
+
+size_t bru_srvm_stream_match_end(const BruSRVM *self)
+{
+    return self->stream_match;
+}
+
+size_t *bru_srvm_stream_captures(const BruSRVM *self, bru_len_t *ncaptures)
+{
+    size_t *captures = malloc(2 * self->ncaptures * sizeof(size_t));
+
+    if (ncaptures) *ncaptures = self->ncaptures;
+    memcpy(captures, self->stream_captures,
+           2 * self->ncaptures * sizeof(size_t));
+
+    return captures;
+}
+
 int bru_srvm_matches(BruThreadManager *thread_manager,
                      const BruProgram *prog,
                      const char       *text)
 {
-    BruSRVM *srvm    = bru_srvm_new(thread_manager, prog);
+    BruSRVM *srvm    = bru_srvm_new(thread_manager, prog, BRU_SRVM_SWITCH);
     int      matches = bru_srvm_match(srvm, text);
     bru_srvm_free(srvm);
 
@@ -104,242 +378,502 @@ int bru_srvm_matches(BruThreadManager *thread_manager,
 
 /* --- Private function definitions ----------------------------------------- */
 
-static int srvm_run(BruSRVM *self, const char *text)
+// the execution loop for any thread manager, going through its functions
+#define BRU_SRVM_RUN_NAME            srvm_run_switch
+#define BRU_SRVM_RUN_TM              BruThreadManager *
+#define BRU_SRVM_RUN_NEXT_THREAD     bru_thread_manager_next_thread
+#define BRU_SRVM_RUN_PC              bru_thread_manager_pc
+#define BRU_SRVM_RUN_SET_PC          bru_thread_manager_set_pc
+#define BRU_SRVM_RUN_SP              bru_thread_manager_sp
+#define BRU_SRVM_RUN_INC_SP          bru_thread_manager_inc_sp
+#define BRU_SRVM_RUN_SCHEDULE        bru_thread_manager_schedule_thread
+#define BRU_SRVM_RUN_KILL            bru_thread_manager_kill_thread
+#define BRU_SRVM_RUN_CLONE           bru_thread_manager_clone_thread
+#define BRU_SRVM_RUN_NOTIFY_MATCH    bru_thread_manager_notify_thread_match
+#define BRU_SRVM_RUN_CAPTURES        bru_thread_manager_captures
+#define BRU_SRVM_RUN_SET_CAPTURE     bru_thread_manager_set_capture
+#define BRU_SRVM_RUN_MEMOISE         bru_thread_manager_memoise
+#define BRU_SRVM_RUN_COUNTER         bru_thread_manager_counter
+#define BRU_SRVM_RUN_SET_COUNTER     bru_thread_manager_set_counter
+#define BRU_SRVM_RUN_INC_COUNTER     bru_thread_manager_inc_counter
+#define BRU_SRVM_RUN_MEMORY          bru_thread_manager_memory
+#define BRU_SRVM_RUN_SET_MEMORY      bru_thread_manager_set_memory
+#define BRU_SRVM_RUN_SCHEDULE_IN_ORDER \
+    bru_thread_manager_schedule_thread_in_order
+#include "srvm_run.h"
+
+static int srvm_run(BruSRVM *self, const char *text, const char *text_end)
 {
-    void             *null    = NULL;
-    int               matched = FALSE, cond;
-    const BruProgram *prog    = self->program;
-    BruThreadManager *tm      = self->thread_manager;
-    void             *thread, *t;
-    const bru_byte_t *pc;
-    const char       *sp, *codepoint, *matched_sp;
-    bru_len_t         ncaptures, k;
-    bru_offset_t      x, y;
-    bru_cntr_t        cval, n;
-    BruIntervals     *intervals;
+    const BruProgram *prog       = self->program;
+    BruThreadManager *tm         = self->thread_manager;
+    const char       *matched_sp = NULL;
+    int               matched;
+
+    if (self->search == BRU_SRVM_SEARCH_REVERSE)
+        return srvm_run_reverse(self, text, text_end);
 
     if (self->matching_finished) return FALSE;
 
-    bru_thread_manager_init_memoisation(self->thread_manager,
-                                        self->program->nmemo_insts, text);
-    do {
-        bru_thread_manager_init(tm, self->program->insts, self->curr_sp);
-        while ((thread = bru_thread_manager_next_thread(tm))) {
-            if ((sp = bru_thread_manager_sp(tm, thread)) > text &&
-                sp[-1] == '\0') {
-                bru_thread_manager_kill_thread(tm, thread);
-                continue;
-            }
-
-            pc = bru_thread_manager_pc(tm, thread);
-            switch (*pc++) {
-                case BRU_NOOP:
-                    bru_thread_manager_set_pc(tm, thread, pc);
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_MATCH:
-                    matched_sp = sp;
-                    matched    = 1;
-                    if (self->captures)
-                        memcpy(
-                            self->captures,
-                            bru_thread_manager_captures(tm, thread, &ncaptures),
-                            2 * self->ncaptures * sizeof(char *));
-                    bru_thread_manager_notify_thread_match(tm, thread);
-                    break;
-
-                case BRU_BEGIN:
-                    if (sp == text) {
-                        bru_thread_manager_set_pc(tm, thread, pc);
-                        bru_thread_manager_schedule_thread(tm, thread);
-                    } else {
-                        bru_thread_manager_kill_thread(tm, thread);
-                    }
-                    break;
-
-                case BRU_END:
-                    if (*sp == '\0') {
-                        bru_thread_manager_set_pc(tm, thread, pc);
-                        bru_thread_manager_schedule_thread(tm, thread);
-                    } else {
-                        bru_thread_manager_kill_thread(tm, thread);
-                    }
-                    break;
-
-                case BRU_MEMO:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    if (bru_thread_manager_memoise(tm, thread, k)) {
-                        bru_thread_manager_set_pc(tm, thread, pc);
-                        bru_thread_manager_schedule_thread(tm, thread);
-                    } else {
-                        bru_thread_manager_kill_thread(tm, thread);
-                    }
-                    break;
-
-                case BRU_CHAR:
-                    BRU_MEMREAD(codepoint, pc, const char *);
-                    if (*sp && stc_utf8_cmp(codepoint, sp) == 0) {
-                        bru_thread_manager_set_pc(tm, thread, pc);
-                        bru_thread_manager_inc_sp(tm, thread);
-                        bru_thread_manager_schedule_thread(tm, thread);
-                    } else {
-                        bru_thread_manager_kill_thread(tm, thread);
-                    }
-                    break;
-
-                case BRU_PRED:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    intervals = (BruIntervals *) (prog->aux + k);
-                    if (*sp && bru_intervals_predicate(intervals, sp)) {
-                        bru_thread_manager_set_pc(tm, thread, pc);
-                        bru_thread_manager_inc_sp(tm, thread);
-                        bru_thread_manager_schedule_thread(tm, thread);
-                    } else {
-                        bru_thread_manager_kill_thread(tm, thread);
-                    }
-                    break;
-
-                case BRU_SAVE:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    bru_thread_manager_set_pc(tm, thread, pc);
-                    bru_thread_manager_set_capture(tm, thread, k);
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_JMP:
-                    BRU_MEMREAD(x, pc, bru_offset_t);
-                    bru_thread_manager_set_pc(tm, thread, pc + x);
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_SPLIT:
-                    t = bru_thread_manager_clone_thread(tm, thread);
-                    BRU_MEMREAD(x, pc, bru_offset_t);
-                    bru_thread_manager_set_pc(tm, thread, pc + x);
-                    BRU_MEMREAD(y, pc, bru_offset_t);
-                    bru_thread_manager_set_pc(tm, t, pc + y);
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    bru_thread_manager_schedule_thread(tm, t);
-                    break;
-
-                /* TODO: */
-                case BRU_GSPLIT: break;
-                case BRU_LSPLIT: break;
-
-                case BRU_TSWITCH:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    // k > 1 to reuse current thread for last offset
-                    for (; k > 1; k--) {
-                        BRU_MEMREAD(x, pc, bru_offset_t);
-                        t = bru_thread_manager_clone_thread(tm, thread);
-                        bru_thread_manager_set_pc(tm, t, pc + x);
-                        bru_thread_manager_schedule_thread_in_order(tm, t);
-                    }
-                    // reuse current thread
-                    BRU_MEMREAD(x, pc, bru_offset_t);
-                    bru_thread_manager_set_pc(tm, thread, pc + x);
-                    bru_thread_manager_schedule_thread_in_order(tm, thread);
-                    break;
-
-                case BRU_EPSRESET:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    bru_thread_manager_set_pc(tm, thread, pc);
-                    bru_thread_manager_set_memory(tm, thread, k, &null,
-                                                  sizeof(null));
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_EPSSET:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    bru_thread_manager_set_pc(tm, thread, pc);
-                    bru_thread_manager_set_memory(tm, thread, k, &sp,
-                                                  sizeof(sp));
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_EPSCHK:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    if (*(char **) bru_thread_manager_memory(tm, thread, k) <
-                        sp) {
-                        bru_thread_manager_set_pc(tm, thread, pc);
-                        bru_thread_manager_schedule_thread(tm, thread);
-                    } else {
-                        bru_thread_manager_kill_thread(tm, thread);
-                    }
-                    break;
-
-                case BRU_RESET:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    BRU_MEMREAD(cval, pc, bru_cntr_t);
-                    bru_thread_manager_set_pc(tm, thread, pc);
-                    bru_thread_manager_set_counter(tm, thread, k, cval);
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_CMP:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    BRU_MEMREAD(n, pc, bru_cntr_t);
-                    cval = bru_thread_manager_counter(tm, thread, k);
-                    switch (*pc++) {
-                        case BRU_LT: cond = (cval < n); break;
-                        case BRU_LE: cond = (cval <= n); break;
-                        case BRU_EQ: cond = (cval == n); break;
-                        case BRU_NE: cond = (cval != n); break;
-                        case BRU_GE: cond = (cval >= n); break;
-                        case BRU_GT: cond = (cval > n); break;
-                        default: cond = 0; break;
-                    }
-
-                    if (cond) {
-                        bru_thread_manager_set_pc(tm, thread, pc);
-                        bru_thread_manager_schedule_thread(tm, thread);
-                    } else {
-                        bru_thread_manager_kill_thread(tm, thread);
-                    }
-                    break;
-
-                case BRU_INC:
-                    BRU_MEMREAD(k, pc, bru_len_t);
-                    bru_thread_manager_set_pc(tm, thread, pc);
-                    bru_thread_manager_inc_counter(tm, thread, k);
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_ZWA:
-                    t = bru_thread_manager_clone_thread(tm, thread);
-                    BRU_MEMREAD(x, pc, bru_offset_t);
-                    bru_thread_manager_set_pc(tm, t, pc + x);
-                    BRU_MEMREAD(y, pc, bru_offset_t);
-                    bru_thread_manager_set_pc(tm, thread, pc + y);
-                    // TODO:
-                    // s = malloc(sizeof(*s));
-                    // bru_scheduler_copy_with(s, scheduler, t);
-                    //
-                    // if (srvm_run(text, thread_manager, s, NULL) == *pc)
-                    //     bru_scheduler_schedule(scheduler, thread);
-                    // else
-                    //     bru_scheduler_kill(scheduler, thread);
-                    // bru_scheduler_free(s);
-                    break;
-
-                case BRU_STATE:
-                    bru_thread_manager_set_pc(tm, thread, pc);
-                    bru_thread_manager_schedule_thread(tm, thread);
-                    break;
-
-                case BRU_NBYTECODES: assert(0 && "unreachable");
-            }
-        }
+    // every match starts with the literal prefix, so skip straight to it
+    if (!(self->curr_sp =
+              bru_program_find_prefix(prog, self->curr_sp, text_end))) {
+        self->matching_finished = TRUE;
+        return FALSE;
+    }
 
-        if (bru_thread_manager_done_exec(tm)) {
-            self->matching_finished = TRUE;
-            break;
-        }
-        self->curr_sp = matched && matched_sp != self->curr_sp
+    bru_thread_manager_init_memoisation(tm, prog->nmemo_insts, text,
+                                        text_end - text);
+    // the program starts with an implicit `.*?` loop, so a single pass from
+    // the current SP finds the leftmost match
+    bru_thread_manager_init(tm, prog->insts, self->curr_sp, text_end);
+    matched = srvm_exec(self, text, text_end, &matched_sp);
+    // the threads do not record where the match started
+    self->match_start = NULL;
+    self->match_end   = matched_sp;
+
+    // an empty match can only be found after the current SP at the end of the
+    // input, so stop there to avoid reporting it twice
+    if (!matched || matched_sp == text_end)
+        self->matching_finished = TRUE;
+    else
+        self->curr_sp = matched_sp != self->curr_sp
+                            ? matched_sp
+                            : stc_utf8_str_next(self->curr_sp);
+    // a codepoint cut short by the end of the input is skipped to the end
+    if (self->curr_sp > text_end) self->curr_sp = text_end;
+
+    return matched;
+}
+
+/**
+ * Find the next match with the reverse search strategy, where the DFAs narrow
+ * down the span of the input the thread manager executes the program on.
+ *
+ * @param[in] self     the SRVM to execute
+ * @param[in] text     the start of the input string
+ * @param[in] text_end the end of the input string
+ *
+ * @return truthy value if a match was found; else 0
+ */
+static int
+srvm_run_reverse(BruSRVM *self, const char *text, const char *text_end)
+{
+    const BruProgram *prog       = self->program;
+    BruThreadManager *tm         = self->thread_manager;
+    const char       *matched_sp = NULL, *start, *end, *span_end;
+    int               matched;
+
+    if (self->matching_finished) return FALSE;
+
+    // the forward DFA finds where the leftmost match ends and the reverse DFA
+    // where it starts, without tracking any captures
+    if (!(end = bru_dfa_match_end(self->dfa, text, self->curr_sp, text_end))) {
+        self->matching_finished = TRUE;
+        return FALSE;
+    }
+    if (!(start = bru_dfa_match_start(self->reverse_dfa, text, self->curr_sp,
+                                      end, text_end)))
+        start = self->curr_sp;
+
+    // the leftmost match is the first found from its start, and the input past
+    // its end is only looked at by programs checking for the end of the input
+    span_end = bru_dfa_has_end(self->dfa) ? text_end : end;
+    bru_thread_manager_init_memoisation(tm, prog->nmemo_insts, text,
+                                        span_end - text);
+    bru_thread_manager_init(tm, prog->insts, start, span_end);
+    matched = srvm_exec(self, text, span_end, &matched_sp);
+    self->match_start = start;
+    self->match_end   = matched_sp;
+
+    // an empty match can only be found after the current SP at the end of the
+    // input, so stop there to avoid reporting it twice
+    if (!matched || matched_sp == text_end)
+        self->matching_finished = TRUE;
+    else
+        self->curr_sp = matched_sp != self->curr_sp
                             ? matched_sp
                             : stc_utf8_str_next(self->curr_sp);
-    } while (!matched);
+    // a codepoint cut short by the end of the input is skipped to the end
+    if (self->curr_sp > text_end) self->curr_sp = text_end;
 
     return matched;
 }
+
+/**
+ * Execute the threads of the thread manager of the SRVM with its dispatch until
+ * none are left.
+ *
+ * @param[in]  self       the SRVM to execute
+ * @param[in]  text       the start of the input string
+ * @param[in]  text_end   the end of the input string
+ * @param[out] matched_sp the end of the match if one was found, or NULL to stop
+ *                        at the first match reached
+ *
+ * @return truthy value if a match was found; else 0
+ */
+static int srvm_exec(BruSRVM     *self,
+                     const char  *text,
+                     const char  *text_end,
+                     const char **matched_sp)
+{
+    BruThreadManager *tm = self->thread_manager;
+
+    if (self->dispatch == BRU_SRVM_SPECIALISED && tm->run)
+        return bru_thread_manager_run(tm, self->program, text, text_end,
+                                      self->captures, self->ncaptures, NULL,
+                                      matched_sp);
+#ifdef SRVM_COMPUTED_GOTO
+    if (self->dispatch == BRU_SRVM_THREADED)
+        return srvm_run_threaded(self, text, text_end, matched_sp);
+#endif /* SRVM_COMPUTED_GOTO */
+
+    return srvm_run_switch(tm, self->program, text, text_end, self->captures,
+                           self->ncaptures, NULL, matched_sp);
+}
+
+/**
+ * Execute the threads of the thread manager of the SRVM over the next chunk of
+ * a stream, recording the offsets of a match found in the chunk.
+ *
+ * @param[in] self      the SRVM to execute
+ * @param[in] chunk     the next chunk of the stream
+ * @param[in] chunk_len the number of bytes in the chunk
+ * @param[in] more      whether more input follows the chunk
+ */
+static void
+srvm_stream_chunk(BruSRVM *self, const char *chunk, size_t chunk_len, int more)
+{
+    BruThreadManager *tm         = self->thread_manager;
+    const char       *matched_sp = NULL;
+    bru_len_t         i;
+
+    if (self->curr_sp == NULL) {
+        self->curr_sp = chunk;
+        bru_thread_manager_init(tm, self->program->insts, chunk,
+                                chunk + chunk_len);
+    }
+    if (!bru_thread_manager_stream(tm, chunk, chunk + chunk_len, more)) {
+        self->matching_finished = TRUE;
+        return;
+    }
+
+    // only the first chunk starts at the beginning of the input
+    if (srvm_exec(self, self->stream_offset ? NULL : chunk, chunk + chunk_len,
+                  &matched_sp)) {
+        // SPs of previous chunks are relative to the chunk (see `stream` of
+        // the thread manager), so the offsets are computed modulo the size of
+        // the address space
+        self->stream_match = self->stream_offset +
+                             ((uintptr_t) matched_sp - (uintptr_t) chunk);
+        for (i = 0; i < 2 * self->ncaptures; i++)
+            self->stream_captures[i] =
+                self->captures[i] ? self->stream_offset +
+                                        ((uintptr_t) self->captures[i] -
+                                         (uintptr_t) chunk)
+                                  : SIZE_MAX;
+    }
+    self->stream_offset += chunk_len;
+    if (!more) self->matching_finished = TRUE;
+}
+
+#ifdef SRVM_COMPUTED_GOTO
+
+/* Taking the address of a label and `goto *` are GNU extensions. */
+#    pragma GCC diagnostic push
+#    pragma GCC diagnostic ignored "-Wpedantic"
+
+static int srvm_run_threaded(BruSRVM     *self,
+                             const char  *text,
+                             const char  *text_end,
+                             const char **matched_sp)
+{
+    static const void *const labels[BRU_NBYTECODES] = {
+        [BRU_NOOP] = &&op_noop,         [BRU_MATCH] = &&op_match,
+        [BRU_BEGIN] = &&op_begin,       [BRU_END] = &&op_end,
+        [BRU_MEMO] = &&op_memo,         [BRU_CHAR] = &&op_char,
+        [BRU_PRED] = &&op_pred,         [BRU_BYTE] = &&op_byte,
+        [BRU_SAVE] = &&op_save,         [BRU_JMP] = &&op_jmp,
+        [BRU_SPLIT] = &&op_split,       [BRU_GSPLIT] = &&op_todo,
+        [BRU_LSPLIT] = &&op_todo,       [BRU_TSWITCH] = &&op_tswitch,
+        [BRU_EPSRESET] = &&op_epsreset, [BRU_EPSSET] = &&op_epsset,
+        [BRU_EPSCHK] = &&op_epschk,     [BRU_RESET] = &&op_reset,
+        [BRU_CMP] = &&op_cmp,           [BRU_INC] = &&op_inc,
+        [BRU_ZWA] = &&op_zwa,           [BRU_STATE] = &&op_state,
+    };
+
+    void              *null    = NULL;
+    int                matched = FALSE, cond;
+    const BruProgram  *prog    = self->program;
+    BruThreadManager  *tm      = self->thread_manager;
+    void              *thread, *t;
+    const bru_byte_t  *pc;
+    const char        *sp;
+    const BruSRVMInst *inst;
+    bru_len_t          ncaptures, k;
+    bru_offset_t       x;
+    bru_cntr_t         cval;
+
+    if (!self->decoded) self->decoded = srvm_decode(prog, labels);
+
+// every handler dispatches the next thread itself so that each indirect jump
+// is predicted separately
+#    define DISPATCH()                                                \
+        do {                                                          \
+            if (!(thread = bru_thread_manager_next_thread(tm)))       \
+                return matched;                                       \
+            sp   = bru_thread_manager_sp(tm, thread);                 \
+            inst = self->decoded +                                    \
+                   (bru_thread_manager_pc(tm, thread) - prog->insts); \
+            goto *inst->label;                                        \
+        } while (0)
+
+#    define CONTINUE_IF(cond)                                      \
+        do {                                                       \
+            if (cond) {                                            \
+                bru_thread_manager_set_pc(tm, thread, inst->next); \
+                bru_thread_manager_schedule_thread(tm, thread);    \
+            } else {                                               \
+                bru_thread_manager_kill_thread(tm, thread);        \
+            }                                                      \
+            DISPATCH();                                            \
+        } while (0)
+
+#    define CONSUME_IF(cond, nbytes)                               \
+        do {                                                       \
+            if (cond) {                                            \
+                bru_thread_manager_set_pc(tm, thread, inst->next); \
+                bru_thread_manager_inc_sp(tm, thread, (nbytes));   \
+                bru_thread_manager_schedule_thread(tm, thread);    \
+            } else {                                               \
+                bru_thread_manager_kill_thread(tm, thread);        \
+            }                                                      \
+            DISPATCH();                                            \
+        } while (0)
+
+    DISPATCH();
+
+op_noop:
+op_state:
+    CONTINUE_IF(TRUE);
+
+op_match:
+    if (!matched_sp) {
+        bru_thread_manager_kill_thread(tm, thread);
+        return TRUE;
+    }
+    *matched_sp = sp;
+    matched     = TRUE;
+    if (self->captures)
+        memcpy(self->captures,
+               bru_thread_manager_captures(tm, thread, &ncaptures),
+               2 * self->ncaptures * sizeof(char *));
+    bru_thread_manager_notify_thread_match(tm, thread);
+    DISPATCH();
+
+op_begin:
+    CONTINUE_IF(sp == text);
+
+op_end:
+    CONTINUE_IF(sp == text_end);
+
+op_memo:
+    CONTINUE_IF(bru_thread_manager_memoise(tm, thread, inst->k));
+
+op_char:
+    CONSUME_IF(BRU_CODEPOINT_IN_TEXT(sp, text_end) &&
+                   stc_utf8_cmp(inst->codepoint, sp) == 0,
+               stc_utf8_nbytes(sp));
+
+op_pred:
+    CONSUME_IF(BRU_CODEPOINT_IN_TEXT(sp, text_end) &&
+                   bru_intervals_table_predicate(inst->table, sp),
+               stc_utf8_nbytes(sp));
+
+op_byte:
+    CONSUME_IF(sp < text_end && inst->lbyte <= (unsigned char) *sp &&
+                   (unsigned char) *sp <= inst->ubyte,
+               1);
+
+op_save:
+    bru_thread_manager_set_capture(tm, thread, inst->k);
+    CONTINUE_IF(TRUE);
+
+op_jmp:
+    CONTINUE_IF(TRUE);
+
+op_split:
+    t = bru_thread_manager_clone_thread(tm, thread);
+    bru_thread_manager_set_pc(tm, thread, inst->next);
+    bru_thread_manager_set_pc(tm, t, inst->alt);
+    bru_thread_manager_schedule_thread(tm, thread);
+    bru_thread_manager_schedule_thread(tm, t);
+    DISPATCH();
+
+/* TODO: */
+op_todo:
+    DISPATCH();
+
+op_tswitch:
+    // k > 1 to reuse current thread for last offset
+    for (pc = inst->offsets, k = inst->k; k > 1; k--) {
+        BRU_MEMREAD(x, pc, bru_offset_t);
+        t = bru_thread_manager_clone_thread(tm, thread);
+        bru_thread_manager_set_pc(tm, t, pc + x);
+        bru_thread_manager_schedule_thread_in_order(tm, t);
+    }
+    // reuse current thread
+    BRU_MEMREAD(x, pc, bru_offset_t);
+    bru_thread_manager_set_pc(tm, thread, pc + x);
+    bru_thread_manager_schedule_thread_in_order(tm, thread);
+    DISPATCH();
+
+op_epsreset:
+    bru_thread_manager_set_memory(tm, thread, inst->k, &null, sizeof(null));
+    CONTINUE_IF(TRUE);
+
+op_epsset:
+    bru_thread_manager_set_memory(tm, thread, inst->k, &sp, sizeof(sp));
+    CONTINUE_IF(TRUE);
+
+op_epschk:
+    CONTINUE_IF(*(char **) bru_thread_manager_memory(tm, thread, inst->k) <
+                sp);
+
+op_reset:
+    bru_thread_manager_set_counter(tm, thread, inst->k, inst->n);
+    CONTINUE_IF(TRUE);
+
+op_cmp:
+    cval = bru_thread_manager_counter(tm, thread, inst->k);
+    switch (inst->order) {
+        case BRU_LT: cond = (cval < inst->n); break;
+        case BRU_LE: cond = (cval <= inst->n); break;
+        case BRU_EQ: cond = (cval == inst->n); break;
+        case BRU_NE: cond = (cval != inst->n); break;
+        case BRU_GE: cond = (cval >= inst->n); break;
+        case BRU_GT: cond = (cval > inst->n); break;
+        default: cond = 0; break;
+    }
+    CONTINUE_IF(cond);
+
+op_inc:
+    bru_thread_manager_inc_counter(tm, thread, inst->k);
+    CONTINUE_IF(TRUE);
+
+op_zwa:
+    // TODO: see `srvm_run_switch`
+    t = bru_thread_manager_clone_thread(tm, thread);
+    bru_thread_manager_set_pc(tm, t, inst->next);
+    bru_thread_manager_set_pc(tm, thread, inst->alt);
+    DISPATCH();
+
+#    undef DISPATCH
+#    undef CONTINUE_IF
+#    undef CONSUME_IF
+}
+
+#    pragma GCC diagnostic pop
+
+/**
+ * Decode the instructions of a program so that the operands of each
+ * instruction are read once instead of every time a thread executes it.
+ *
+ * The decoded instruction of the instruction at a PC is found at the offset of
+ * the PC in the instruction byte stream, so threads keep executing bytecode
+ * PCs and the thread managers are unaffected.
+ *
+ * @param[in] prog   the program to decode
+ * @param[in] labels the addresses of the handlers of each bytecode
+ *
+ * @return the decoded instructions indexed by bytecode offset
+ */
+static BruSRVMInst *srvm_decode(const BruProgram  *prog,
+                                const void *const *labels)
+{
+    const bru_byte_t *pc  = prog->insts;
+    const bru_byte_t *end = pc + stc_vec_len_unsafe(prog->insts);
+    BruSRVMInst      *decoded, *inst;
+    bru_offset_t      x;
+    bru_len_t         k;
+
+    decoded = calloc(end - pc, sizeof(*decoded));
+    while (pc < end) {
+        inst        = decoded + (pc - prog->insts);
+        inst->label = labels[(unsigned char) *pc];
+        switch (*pc++) {
+            case BRU_NOOP:
+            case BRU_MATCH:
+            case BRU_BEGIN:
+            case BRU_END:
+            case BRU_STATE: break;
+
+            case BRU_MEMO:
+            case BRU_SAVE:
+            case BRU_EPSRESET:
+            case BRU_EPSSET:
+            case BRU_EPSCHK:
+            case BRU_INC: BRU_MEMREAD(inst->k, pc, bru_len_t); break;
+
+            case BRU_CHAR:
+                BRU_CODEPOINTREAD(inst->codepoint, pc);
+                break;
+
+            case BRU_PRED:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                inst->table = BRU_PRED_TABLE(prog->aux, k);
+                break;
+
+            case BRU_BYTE:
+                inst->lbyte = (unsigned char) *pc++;
+                inst->ubyte = (unsigned char) *pc++;
+                break;
+
+            case BRU_JMP:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                inst->next = pc + x;
+                break;
+
+            case BRU_SPLIT:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                inst->next = pc + x;
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                inst->alt = pc + x;
+                break;
+
+            case BRU_ZWA:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                inst->next = pc + x;
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                inst->alt = pc + x;
+                pc++;
+                break;
+
+            case BRU_GSPLIT:
+            case BRU_LSPLIT: pc += sizeof(bru_offset_t); break;
+
+            case BRU_TSWITCH:
+                BRU_MEMREAD(inst->k, pc, bru_len_t);
+                inst->offsets  = pc;
+                pc            += inst->k * sizeof(bru_offset_t);
+                break;
+
+            case BRU_RESET:
+                BRU_MEMREAD(inst->k, pc, bru_len_t);
+                BRU_MEMREAD(inst->n, pc, bru_cntr_t);
+                break;
+
+            case BRU_CMP:
+                BRU_MEMREAD(inst->k, pc, bru_len_t);
+                BRU_MEMREAD(inst->n, pc, bru_cntr_t);
+                inst->order = *pc++;
+                break;
+
+            default: assert(0 && "unreachable");
+        }
+        if (!inst->next) inst->next = pc;
+    }
+
+    return decoded;
+}
+
+#endif /* SRVM_COMPUTED_GOTO */
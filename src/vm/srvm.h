@@ -1,27 +1,65 @@
 #ifndef BRU_VM_SRVM_H
 #define BRU_VM_SRVM_H
 
+#include <stdio.h>
+
 #include "../stc/fatp/string_view.h"
 
+#include "program.h"
 #include "thread_managers/thread_manager.h"
 
 /* --- Type definitions ----------------------------------------------------- */
 
 typedef struct bru_srvm BruSRVM;
 
+typedef enum {
+    BRU_SRVM_SWITCH,      /**< dispatch with a switch over the bytecode       */
+    BRU_SRVM_THREADED,    /**< dispatch with computed gotos on decoded insts  */
+    BRU_SRVM_SPECIALISED, /**< switch specialised to the thread manager       */
+} BruSRVMDispatch;
+
+typedef enum {
+    BRU_SRVM_SEARCH_FORWARD, /**< find each match in a single forward pass    */
+    BRU_SRVM_SEARCH_REVERSE, /**< find the bounds of each match with DFAs
+                                  before executing on the match only          */
+} BruSRVMSearch;
+
 #if !defined(BRU_VM_SRVM_DISABLE_SHORT_NAMES) && \
     (defined(BRU_VM_SRVM_ENABLE_SHORT_NAMES) ||  \
      !defined(BRU_VM_DISABLE_SHORT_NAMES) &&     \
          (defined(BRU_VM_ENABLE_SHORT_NAMES) ||  \
           defined(BRU_ENABLE_SHORT_NAMES)))
-typedef BruSRVM SRVM;
-
-#    define srvm_new      bru_srvm_new
-#    define srvm_free     bru_srvm_free
-#    define srvm_match    bru_srvm_match
-#    define srvm_find     bru_srvm_find
-#    define srvm_capture  bru_srvm_capture
-#    define srvm_captures bru_srvm_captures
+typedef BruSRVM         SRVM;
+typedef BruSRVMDispatch SRVMDispatch;
+typedef BruSRVMSearch   SRVMSearch;
+
+#    define SRVM_SWITCH      BRU_SRVM_SWITCH
+#    define SRVM_THREADED    BRU_SRVM_THREADED
+#    define SRVM_SPECIALISED BRU_SRVM_SPECIALISED
+
+#    define SRVM_SEARCH_FORWARD BRU_SRVM_SEARCH_FORWARD
+#    define SRVM_SEARCH_REVERSE BRU_SRVM_SEARCH_REVERSE
+
+#    define srvm_new        bru_srvm_new
+#    define srvm_free       bru_srvm_free
+#    define srvm_set_search bru_srvm_set_search
+#    define srvm_match      bru_srvm_match
+#    define srvm_match_n    bru_srvm_match_n
+#    define srvm_is_match   bru_srvm_is_match
+#    define srvm_is_match_n bru_srvm_is_match_n
+#    define srvm_find       bru_srvm_find
+#    define srvm_find_n     bru_srvm_find_n
+#    define srvm_find_iter  bru_srvm_find_iter
+#    define srvm_capture    bru_srvm_capture
+#    define srvm_captures   bru_srvm_captures
+
+#    define srvm_captures_into bru_srvm_captures_into
+
+#    define srvm_stream_begin     bru_srvm_stream_begin
+#    define srvm_stream_feed      bru_srvm_stream_feed
+#    define srvm_stream_end       bru_srvm_stream_end
+#    define srvm_stream_match_end bru_srvm_stream_match_end
+#    define srvm_stream_captures  bru_srvm_stream_captures
 #    define srvm_matches  bru_srvm_matches
 #endif /* BRU_VM_SRVM_ENABLE_SHORT_NAMES */
 
@@ -31,12 +69,25 @@ typedef BruSRVM SRVM;
  * Construct a Symbolic Regular Expression Virtual Machine with given thream
  * manager and program.
  *
+ * The threaded dispatch decodes the program into an instruction per bytecode
+ * offset with resolved operands the first time it is executed, and uses GCC or
+ * Clang computed gotos to jump between instruction handlers. Other compilers
+ * fall back to the switch dispatch.
+ *
+ * The specialised dispatch uses the execution loop the thread manager provides
+ * with its thread operations inlined (see `srvm_run.h`), which the Spencer and
+ * lockstep thread managers do, also when wrapped for memoisation. Other thread
+ * managers fall back to the switch dispatch.
+ *
  * @param[in] thread_manager the thread manager for the SRVM to use
  * @param[in] prog           the program for the SRVM to execute
+ * @param[in] dispatch       how the SRVM dispatches instructions
  *
  * @return the constructed SRVM
  */
-BruSRVM *bru_srvm_new(BruThreadManager *thread_manager, const BruProgram *prog);
+BruSRVM *bru_srvm_new(BruThreadManager *thread_manager,
+                      const BruProgram *prog,
+                      BruSRVMDispatch   dispatch);
 
 /**
  * Free the memory allocated for the SRVM.
@@ -45,6 +96,35 @@ BruSRVM *bru_srvm_new(BruThreadManager *thread_manager, const BruProgram *prog);
  */
 void bru_srvm_free(BruSRVM *self);
 
+/**
+ * Set how the SRVM searches for matches in the input string.
+ *
+ * With the reverse search, as in RE2, a forward DFA first finds the end of the
+ * leftmost match and a reverse DFA then finds its start by executing the
+ * reverse program backwards from the end. Only then does the thread manager
+ * execute the program, from the start of the match and up to its end, to find
+ * the captures. The unanchored search is thereby done without any threads, and
+ * the threads never see the input outside of the match unless the program
+ * checks for the end of the input.
+ *
+ * The reverse program must be compiled from the same regex with the same
+ * options as the program of the SRVM (see `bru_compiler_compile_reverse`), and
+ * must not be freed before the SRVM. The stream functions always search
+ * forward.
+ *
+ * @param[in] self         the SRVM
+ * @param[in] search       how the SRVM searches for matches
+ * @param[in] reverse_prog the reverse program for the reverse search
+ * @param[in] logfile      the file for logging output of the DFAs
+ *
+ * @return truthy value if the search was set, or 0 if the DFAs do not support
+ *         the programs for the reverse search
+ */
+int bru_srvm_set_search(BruSRVM          *self,
+                        BruSRVMSearch     search,
+                        const BruProgram *reverse_prog,
+                        FILE             *logfile);
+
 /**
  * Execute the SRVM against an input string.
  *
@@ -55,6 +135,50 @@ void bru_srvm_free(BruSRVM *self);
  */
 int bru_srvm_match(BruSRVM *self, const char *text);
 
+/**
+ * Execute the SRVM against an input string of given length.
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in] self     the SRVM to execute
+ * @param[in] text     the input string to match against
+ * @param[in] text_len the number of bytes in the input string
+ *
+ * @return truthy value if the SRVM matched against the input string; else 0
+ */
+int bru_srvm_match_n(BruSRVM *self, const char *text, size_t text_len);
+
+/**
+ * Check whether the regex of the SRVM matches anywhere in an input string.
+ *
+ * Unlike `bru_srvm_match`, execution stops at the first match reached instead
+ * of resolving the match with the highest priority, and neither the end nor
+ * the captures of the match are recorded. Programs compiled with `no_captures`
+ * set in the compiler options need no capture memory in their threads at all.
+ *
+ * @param[in] self the SRVM to execute
+ * @param[in] text the input string to match against
+ *
+ * @return truthy value if the regex matches the input string; else 0
+ */
+int bru_srvm_is_match(BruSRVM *self, const char *text);
+
+/**
+ * Check whether the regex of the SRVM matches anywhere in an input string of
+ * given length (see `bru_srvm_is_match`).
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in] self     the SRVM to execute
+ * @param[in] text     the input string to match against
+ * @param[in] text_len the number of bytes in the input string
+ *
+ * @return truthy value if the regex matches the input string; else 0
+ */
+int bru_srvm_is_match_n(BruSRVM *self, const char *text, size_t text_len);
+
 /**
  * Find the next match of the regex of the SRVM inside the input string if
  * possible for partial matching.
@@ -66,6 +190,54 @@ int bru_srvm_match(BruSRVM *self, const char *text);
  */
 int bru_srvm_find(BruSRVM *self, const char *text);
 
+/**
+ * Find the next match of the regex of the SRVM inside the input string of given
+ * length if possible for partial matching.
+ *
+ * The input string does not need to be NUL-terminated and may contain NUL
+ * bytes, however it must not end part way through a UTF-8 encoded codepoint.
+ *
+ * @param[in] self     the SRVM to execute
+ * @param[in] text     the input string to find next match in
+ * @param[in] text_len the number of bytes in the input string
+ *
+ * @return truthy value if the SRVM found a match in the input string; else 0
+ */
+int bru_srvm_find_n(BruSRVM *self, const char *text, size_t text_len);
+
+/**
+ * Iterate over the non-overlapping matches of the regex of the SRVM in the
+ * input string of given length, writing the byte offsets of each match into a
+ * buffer of the caller.
+ *
+ * The first call starts from the beginning of the input string and each
+ * following call resumes at the end of the previous match, as with
+ * `bru_srvm_find_n`, until no match is left, after which the next call starts
+ * a new iteration. The threads of the thread manager are reused from match to
+ * match and no memory is allocated per match.
+ *
+ * The buffer receives the start and end of the match followed by the (start,
+ * end) pairs of the captures, where SIZE_MAX marks an offset that is not known.
+ * The start of the match is known from the reverse search, or from capture 0
+ * when the regex was parsed with `whole_match_capture`. Otherwise the forward
+ * search never records where the winning thread left the implicit `.*?` loop,
+ * so the start is SIZE_MAX.
+ *
+ * @param[in]  self     the SRVM to execute
+ * @param[in]  text     the input string to find the next match in
+ * @param[in]  text_len the number of bytes in the input string
+ * @param[out] offsets  the buffer of offsets from the start of the input string
+ * @param[in]  noffsets the number of offsets the buffer holds, of which at most
+ *                      `2 * ncaptures + 2` are written
+ *
+ * @return truthy value if the SRVM found a match in the input string; else 0
+ */
+int bru_srvm_find_iter(BruSRVM    *self,
+                       const char *text,
+                       size_t      text_len,
+                       size_t     *offsets,
+                       size_t      noffsets);
+
 /**
  * Get the string view into the input string of the capture at the given index
  * from the previous match.
@@ -87,6 +259,87 @@ StcStringView bru_srvm_capture(BruSRVM *self, bru_len_t idx);
  */
 StcStringView *bru_srvm_captures(BruSRVM *self, bru_len_t *ncaptures);
 
+/**
+ * Write the byte offsets from the start of the input string of all the
+ * captures from the previous match of the SRVM into a buffer of the caller.
+ *
+ * Unlike `bru_srvm_captures`, no memory is allocated, so the same buffer can be
+ * reused for every match. The buffer receives the (start, end) pairs of the
+ * captures, where SIZE_MAX marks an offset that was not captured.
+ *
+ * @param[in]  self    the SRVM to get the captures from
+ * @param[out] offsets the buffer of offsets
+ * @param[in]  n       the number of offsets the buffer holds, of which at most
+ *                     `2 * ncaptures` are written
+ *
+ * @return the number of captures of the SRVM
+ */
+bru_len_t bru_srvm_captures_into(BruSRVM *self, size_t *offsets, size_t n);
+
+/**
+ * Begin matching the regex of the SRVM against a stream of input given in
+ * chunks with `bru_srvm_stream_feed`, which is ended by `bru_srvm_stream_end`.
+ *
+ * Only the threads of the current chunk are kept in memory, so input which
+ * does not fit in memory can be matched. This needs a thread manager which can
+ * suspend its threads at the end of a chunk, which the lockstep thread manager
+ * does. As the chunks are not kept, the captures and end of the leftmost match
+ * are reported as offsets from the start of the stream instead of string
+ * views.
+ *
+ * @param[in] self the SRVM to execute
+ *
+ * @return truthy value if the thread manager of the SRVM can stream; else 0
+ */
+int bru_srvm_stream_begin(BruSRVM *self);
+
+/**
+ * Execute the SRVM against the next chunk of the stream.
+ *
+ * The chunk may end part way through a UTF-8 encoded codepoint, in which case
+ * the bytes of the codepoint are held back until the next chunk. The chunk is
+ * not used after the function returns.
+ *
+ * @param[in] self      the SRVM to execute
+ * @param[in] chunk     the next chunk of the stream
+ * @param[in] chunk_len the number of bytes in the chunk
+ *
+ * @return 0 if the match is already decided, so that the rest of the stream
+ *         can be skipped; else truthy value
+ */
+int bru_srvm_stream_feed(BruSRVM *self, const char *chunk, size_t chunk_len);
+
+/**
+ * End the stream, executing the SRVM at the end of the input.
+ *
+ * @param[in] self the SRVM to execute
+ *
+ * @return truthy value if the SRVM matched inside the stream; else 0
+ */
+int bru_srvm_stream_end(BruSRVM *self);
+
+/**
+ * Get the offset from the start of the stream of the end of the leftmost match
+ * found by the SRVM.
+ *
+ * @param[in] self the SRVM to get the offset from
+ *
+ * @return the offset of the end of the match, or SIZE_MAX if none was found
+ */
+size_t bru_srvm_stream_match_end(const BruSRVM *self);
+
+/**
+ * Get the offsets from the start of the stream of all the captures from the
+ * leftmost match found by the SRVM.
+ *
+ * @param[in]  self      the SRVM to get the captures from
+ * @param[out] ncaptures the number of captures in the returned array
+ *
+ * @return the array of (start, end) offset pairs of the captures, where
+ *         SIZE_MAX marks an offset that was not captured
+ */
+size_t *bru_srvm_stream_captures(const BruSRVM *self, bru_len_t *ncaptures);
+
 /**
  * Determine whether the regex represented by the program matches the input text
  * by using the given thread manager.
@@ -0,0 +1,322 @@
+/**
+ * The SRVM execution loop as a template to be instantiated for specific thread
+ * managers, so that their thread operations can be called (and inlined)
+ * directly instead of through the function pointers of `BruThreadManager`.
+ *
+ * To instantiate the loop, define the macros below and include this file. It
+ * can be included multiple times as every macro is undefined at the end.
+ *
+ *     BRU_SRVM_RUN_NAME      name of the function to define
+ *     BRU_SRVM_RUN_TM        type of the thread manager passed to operations
+ *
+ * and the thread operations, each taking the thread manager `tm` first:
+ *
+ *     BRU_SRVM_RUN_NEXT_THREAD(tm)
+ *     BRU_SRVM_RUN_PC(tm, t)              BRU_SRVM_RUN_SET_PC(tm, t, pc)
+ *     BRU_SRVM_RUN_SP(tm, t)              BRU_SRVM_RUN_INC_SP(tm, t, nbytes)
+ *     BRU_SRVM_RUN_SCHEDULE(tm, t)        BRU_SRVM_RUN_SCHEDULE_IN_ORDER(tm, t)
+ *     BRU_SRVM_RUN_KILL(tm, t)            BRU_SRVM_RUN_CLONE(tm, t)
+ *     BRU_SRVM_RUN_NOTIFY_MATCH(tm, t)    BRU_SRVM_RUN_CAPTURES(tm, t, n)
+ *     BRU_SRVM_RUN_SET_CAPTURE(tm, t, k)  BRU_SRVM_RUN_COUNTER(tm, t, k)
+ *     BRU_SRVM_RUN_SET_COUNTER(tm, t, k, val)
+ *     BRU_SRVM_RUN_INC_COUNTER(tm, t, k)  BRU_SRVM_RUN_MEMORY(tm, t, k)
+ *     BRU_SRVM_RUN_SET_MEMORY(tm, t, k, val, size)
+ *
+ * Optionally, `BRU_SRVM_RUN_MEMOISE(tm, t, k)` can be defined as well. If it
+ * is not, the `memo_table` argument of the function is used for memoisation
+ * (and `memo` instructions always succeed if it is NULL).
+ *
+ * The defined function has the signature
+ *
+ *     static int BRU_SRVM_RUN_NAME(BRU_SRVM_RUN_TM    tm,
+ *                                  const BruProgram  *prog,
+ *                                  const char        *text,
+ *                                  const char        *text_end,
+ *                                  const char       **captures,
+ *                                  bru_len_t          ncaptures,
+ *                                  BruMemoTable      *memo_table,
+ *                                  const char       **matched_sp);
+ *
+ * and executes the threads of the thread manager until none are left, which
+ * must already have been initialised with the start of the program. It returns
+ * whether a match was found, writing the end of the match to `matched_sp` and
+ * its captures to `captures` (if not NULL).
+ *
+ * If `matched_sp` is NULL, only whether there is a match is needed, so the
+ * function returns at the first `match` instruction reached instead of
+ * resolving which match has the highest priority. The threads left in the
+ * thread manager must then be reset by the caller.
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "../stc/util/utf.h"
+
+#include "program.h"
+#include "thread_managers/memo_table.h"
+
+#ifndef BRU_SRVM_RUN_MEMOISE
+#    define BRU_SRVM_RUN_MEMOISE(tm, t, k) \
+        (!memo_table || bru_memo_table_insert(memo_table, (k), sp - text))
+#endif /* BRU_SRVM_RUN_MEMOISE */
+
+static int BRU_SRVM_RUN_NAME(BRU_SRVM_RUN_TM    tm,
+                             const BruProgram  *prog,
+                             const char        *text,
+                             const char        *text_end,
+                             const char       **captures,
+                             bru_len_t          ncaptures,
+                             BruMemoTable      *memo_table,
+                             const char       **matched_sp)
+{
+    void                    *null    = NULL;
+    int                      matched = FALSE, cond;
+    void                    *thread, *t;
+    const bru_byte_t        *pc;
+    const char              *sp, *codepoint;
+    bru_len_t                k;
+    bru_offset_t             x, y;
+    bru_cntr_t               cval, n;
+    const BruIntervalsTable *table;
+
+    (void) memo_table;
+
+    while ((thread = BRU_SRVM_RUN_NEXT_THREAD(tm))) {
+        sp = BRU_SRVM_RUN_SP(tm, thread);
+        pc = BRU_SRVM_RUN_PC(tm, thread);
+        switch (*pc++) {
+            case BRU_NOOP:
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_MATCH:
+                if (!matched_sp) {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                    return TRUE;
+                }
+                *matched_sp = sp;
+                matched     = TRUE;
+                if (captures)
+                    memcpy(captures, BRU_SRVM_RUN_CAPTURES(tm, thread, &k),
+                           2 * ncaptures * sizeof(char *));
+                BRU_SRVM_RUN_NOTIFY_MATCH(tm, thread);
+                break;
+
+            case BRU_BEGIN:
+                if (sp == text) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_END:
+                if (sp == text_end) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_MEMO:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                if (BRU_SRVM_RUN_MEMOISE(tm, thread, k)) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_CHAR:
+                BRU_CODEPOINTREAD(codepoint, pc);
+                if (BRU_CODEPOINT_IN_TEXT(sp, text_end) &&
+                    stc_utf8_cmp(codepoint, sp) == 0) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                    BRU_SRVM_RUN_INC_SP(tm, thread, stc_utf8_nbytes(sp));
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_PRED:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                table = BRU_PRED_TABLE(prog->aux, k);
+                if (BRU_CODEPOINT_IN_TEXT(sp, text_end) &&
+                    bru_intervals_table_predicate(table, sp)) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                    BRU_SRVM_RUN_INC_SP(tm, thread, stc_utf8_nbytes(sp));
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_BYTE:
+                if (sp < text_end && BRU_BYTE_IN_RANGE(pc, *sp)) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread,
+                                        pc + 2 * sizeof(bru_byte_t));
+                    BRU_SRVM_RUN_INC_SP(tm, thread, 1);
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_SAVE:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                BRU_SRVM_RUN_SET_CAPTURE(tm, thread, k);
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_JMP:
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc + x);
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_SPLIT:
+                t = BRU_SRVM_RUN_CLONE(tm, thread);
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc + x);
+                BRU_MEMREAD(y, pc, bru_offset_t);
+                BRU_SRVM_RUN_SET_PC(tm, t, pc + y);
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                BRU_SRVM_RUN_SCHEDULE(tm, t);
+                break;
+
+            /* TODO: */
+            case BRU_GSPLIT: break;
+            case BRU_LSPLIT: break;
+
+            case BRU_TSWITCH:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                // k > 1 to reuse current thread for last offset
+                for (; k > 1; k--) {
+                    BRU_MEMREAD(x, pc, bru_offset_t);
+                    t = BRU_SRVM_RUN_CLONE(tm, thread);
+                    BRU_SRVM_RUN_SET_PC(tm, t, pc + x);
+                    BRU_SRVM_RUN_SCHEDULE_IN_ORDER(tm, t);
+                }
+                // reuse current thread
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc + x);
+                BRU_SRVM_RUN_SCHEDULE_IN_ORDER(tm, thread);
+                break;
+
+            case BRU_EPSRESET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                BRU_SRVM_RUN_SET_MEMORY(tm, thread, k, &null, sizeof(null));
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_EPSSET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                BRU_SRVM_RUN_SET_MEMORY(tm, thread, k, &sp, sizeof(sp));
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_EPSCHK:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                if (*(char **) BRU_SRVM_RUN_MEMORY(tm, thread, k) < sp) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_RESET:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_MEMREAD(cval, pc, bru_cntr_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                BRU_SRVM_RUN_SET_COUNTER(tm, thread, k, cval);
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_CMP:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_MEMREAD(n, pc, bru_cntr_t);
+                cval = BRU_SRVM_RUN_COUNTER(tm, thread, k);
+                switch (*pc++) {
+                    case BRU_LT: cond = (cval < n); break;
+                    case BRU_LE: cond = (cval <= n); break;
+                    case BRU_EQ: cond = (cval == n); break;
+                    case BRU_NE: cond = (cval != n); break;
+                    case BRU_GE: cond = (cval >= n); break;
+                    case BRU_GT: cond = (cval > n); break;
+                    default: cond = 0; break;
+                }
+
+                if (cond) {
+                    BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                    BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                } else {
+                    BRU_SRVM_RUN_KILL(tm, thread);
+                }
+                break;
+
+            case BRU_INC:
+                BRU_MEMREAD(k, pc, bru_len_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                BRU_SRVM_RUN_INC_COUNTER(tm, thread, k);
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_ZWA:
+                t = BRU_SRVM_RUN_CLONE(tm, thread);
+                BRU_MEMREAD(x, pc, bru_offset_t);
+                BRU_SRVM_RUN_SET_PC(tm, t, pc + x);
+                BRU_MEMREAD(y, pc, bru_offset_t);
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc + y);
+                // TODO:
+                // s = malloc(sizeof(*s));
+                // bru_scheduler_copy_with(s, scheduler, t);
+                //
+                // if (srvm_run(text, thread_manager, s, NULL) == *pc)
+                //     bru_scheduler_schedule(scheduler, thread);
+                // else
+                //     bru_scheduler_kill(scheduler, thread);
+                // bru_scheduler_free(s);
+                break;
+
+            case BRU_STATE:
+                BRU_SRVM_RUN_SET_PC(tm, thread, pc);
+                BRU_SRVM_RUN_SCHEDULE(tm, thread);
+                break;
+
+            case BRU_NBYTECODES: assert(0 && "unreachable");
+        }
+    }
+
+    return matched;
+}
+
+#undef BRU_SRVM_RUN_NAME
+#undef BRU_SRVM_RUN_TM
+#undef BRU_SRVM_RUN_NEXT_THREAD
+#undef BRU_SRVM_RUN_PC
+#undef BRU_SRVM_RUN_SET_PC
+#undef BRU_SRVM_RUN_SP
+#undef BRU_SRVM_RUN_INC_SP
+#undef BRU_SRVM_RUN_SCHEDULE
+#undef BRU_SRVM_RUN_SCHEDULE_IN_ORDER
+#undef BRU_SRVM_RUN_KILL
+#undef BRU_SRVM_RUN_CLONE
+#undef BRU_SRVM_RUN_NOTIFY_MATCH
+#undef BRU_SRVM_RUN_CAPTURES
+#undef BRU_SRVM_RUN_SET_CAPTURE
+#undef BRU_SRVM_RUN_MEMOISE
+#undef BRU_SRVM_RUN_COUNTER
+#undef BRU_SRVM_RUN_SET_COUNTER
+#undef BRU_SRVM_RUN_INC_COUNTER
+#undef BRU_SRVM_RUN_MEMORY
+#undef BRU_SRVM_RUN_SET_MEMORY
@@ -14,10 +14,10 @@ typedef struct {
 
 static void all_matches_thread_manager_init(void             *impl,
                                             const bru_byte_t *start_pc,
-                                            const char       *start_sp);
+                                            const char       *start_sp,
+                                            const char       *text_end);
 static void all_matches_thread_manager_reset(void *impl);
 static void all_matches_thread_manager_free(void *impl);
-static int  all_matches_thread_manager_done_exec(void *impl);
 
 static void all_matches_thread_manager_schedule_thread(void      *impl,
                                                        BruThread *t);
@@ -31,13 +31,14 @@ static BruThread *all_matches_thread_manager_clone_thread(void            *impl,
 static void all_matches_thread_manager_kill_thread(void *impl, BruThread *t);
 static void all_matches_thread_manager_init_memoisation(void       *impl,
                                                         size_t      nmemo_insts,
-                                                        const char *text);
+                                                        const char *text,
+                                                        size_t      text_len);
 
 static const bru_byte_t *all_matches_thread_pc(void *impl, const BruThread *t);
 static void
 all_matches_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc);
 static const char *all_matches_thread_sp(void *impl, const BruThread *t);
-static void        all_matches_thread_inc_sp(void *impl, BruThread *t);
+static void all_matches_thread_inc_sp(void *impl, BruThread *t, size_t nbytes);
 static int all_matches_thread_memoise(void *impl, BruThread *t, bru_len_t idx);
 static bru_cntr_t
 all_matches_thread_counter(void *impl, const BruThread *t, bru_len_t idx);
@@ -84,10 +85,11 @@ bru_all_matches_thread_manager_new(BruThreadManager *thread_manager,
 
 static void all_matches_thread_manager_init(void             *impl,
                                             const bru_byte_t *start_pc,
-                                            const char       *start_sp)
+                                            const char       *start_sp,
+                                            const char       *text_end)
 {
     bru_thread_manager_init(((BruAllMatchesThreadManager *) impl)->__manager,
-                            start_pc, start_sp);
+                            start_pc, start_sp, text_end);
 }
 
 static void print_match(BruAllMatchesThreadManager *self, BruThread *t)
@@ -135,12 +137,6 @@ static void all_matches_thread_manager_free(void *impl)
     free(impl);
 }
 
-static int all_matches_thread_manager_done_exec(void *impl)
-{
-    return bru_thread_manager_done_exec(
-        ((BruAllMatchesThreadManager *) impl)->__manager);
-}
-
 static void all_matches_thread_manager_schedule_thread(void *impl, BruThread *t)
 {
     bru_thread_manager_schedule_thread(
@@ -205,18 +201,21 @@ static const char *all_matches_thread_sp(void *impl, const BruThread *t)
         ((BruAllMatchesThreadManager *) impl)->__manager, t);
 }
 
-static void all_matches_thread_inc_sp(void *impl, BruThread *t)
+static void all_matches_thread_inc_sp(void *impl, BruThread *t, size_t nbytes)
 {
     bru_thread_manager_inc_sp(((BruAllMatchesThreadManager *) impl)->__manager,
-                              t);
+                              t, nbytes);
 }
 
 static void all_matches_thread_manager_init_memoisation(void       *impl,
                                                         size_t      nmemo_insts,
-                                                        const char *text)
+                                                        const char *text,
+                                                        size_t      text_len)
 {
-    bru_thread_manager_init_memoisation(
-        ((BruAllMatchesThreadManager *) impl)->__manager, nmemo_insts, text);
+    BruAllMatchesThreadManager *self = impl;
+
+    bru_thread_manager_init_memoisation(self->__manager, nmemo_insts, text,
+                                        text_len);
 }
 
 static int all_matches_thread_memoise(void *impl, BruThread *t, bru_len_t idx)
@@ -30,10 +30,10 @@ typedef struct {
 
 static void benchmark_thread_manager_init(void             *impl,
                                           const bru_byte_t *start_pc,
-                                          const char       *start_sp);
+                                          const char       *start_sp,
+                                          const char       *text_end);
 static void benchmark_thread_manager_reset(void *impl);
 static void benchmark_thread_manager_free(void *impl);
-static int  benchmark_thread_manager_done_exec(void *impl);
 
 static void benchmark_thread_manager_schedule_thread(void *impl, BruThread *t);
 static void benchmark_thread_manager_schedule_thread_in_order(void      *impl,
@@ -46,13 +46,14 @@ static BruThread *benchmark_thread_manager_clone_thread(void            *impl,
 static void benchmark_thread_manager_kill_thread(void *impl, BruThread *t);
 static void benchmark_thread_manager_init_memoisation(void       *impl,
                                                       size_t      nmemo_insts,
-                                                      const char *text);
+                                                      const char *text,
+                                                      size_t      text_len);
 
 static const bru_byte_t *benchmark_thread_pc(void *impl, const BruThread *t);
 static void
 benchmark_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc);
 static const char *benchmark_thread_sp(void *impl, const BruThread *t);
-static void        benchmark_thread_inc_sp(void *impl, BruThread *t);
+static void benchmark_thread_inc_sp(void *impl, BruThread *t, size_t nbytes);
 static int benchmark_thread_memoise(void *impl, BruThread *t, bru_len_t idx);
 static bru_cntr_t
 benchmark_thread_counter(void *impl, const BruThread *t, bru_len_t idx);
@@ -98,10 +99,11 @@ bru_benchmark_thread_manager_new(BruThreadManager *thread_manager,
 
 static void benchmark_thread_manager_init(void             *impl,
                                           const bru_byte_t *start_pc,
-                                          const char       *start_sp)
+                                          const char       *start_sp,
+                                          const char       *text_end)
 {
     bru_thread_manager_init(((BruBenchmarkThreadManager *) impl)->__manager,
-                            start_pc, start_sp);
+                            start_pc, start_sp, text_end);
 }
 
 static void benchmark_thread_manager_reset(void *impl)
@@ -121,18 +123,13 @@ static void benchmark_thread_manager_free(void *impl)
     LOG_INSTS(self, BRU_MEMO);
     LOG_INSTS(self, BRU_CHAR);
     LOG_INSTS(self, BRU_PRED);
+    LOG_INSTS(self, BRU_BYTE);
     LOG_INSTS(self, BRU_STATE);
 
     bru_thread_manager_free(self->__manager);
     free(impl);
 }
 
-static int benchmark_thread_manager_done_exec(void *impl)
-{
-    return bru_thread_manager_done_exec(
-        ((BruBenchmarkThreadManager *) impl)->__manager);
-}
-
 static void benchmark_thread_manager_schedule_thread(void *impl, BruThread *t)
 {
     bru_thread_manager_schedule_thread(
@@ -197,18 +194,21 @@ static const char *benchmark_thread_sp(void *impl, const BruThread *t)
         ((BruBenchmarkThreadManager *) impl)->__manager, t);
 }
 
-static void benchmark_thread_inc_sp(void *impl, BruThread *t)
+static void benchmark_thread_inc_sp(void *impl, BruThread *t, size_t nbytes)
 {
     bru_thread_manager_inc_sp(((BruBenchmarkThreadManager *) impl)->__manager,
-                              t);
+                              t, nbytes);
 }
 
 static void benchmark_thread_manager_init_memoisation(void       *impl,
                                                       size_t      nmemo_insts,
-                                                      const char *text)
+                                                      const char *text,
+                                                      size_t      text_len)
 {
-    bru_thread_manager_init_memoisation(
-        ((BruBenchmarkThreadManager *) impl)->__manager, nmemo_insts, text);
+    BruBenchmarkThreadManager *self = impl;
+
+    bru_thread_manager_init_memoisation(self->__manager, nmemo_insts, text,
+                                        text_len);
 }
 
 static int benchmark_thread_memoise(void *impl, BruThread *t, bru_len_t idx)
@@ -0,0 +1,414 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../stc/fatp/vec.h"
+
+#include "../../utils.h"
+#include "bitstate.h"
+#include "thread_manager.h"
+#include "thread_pool.h"
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct bru_bitstate_thread {
+    const bru_byte_t *pc;
+    const char       *sp;
+    const char       *memory_sp; /**< the SP at which memory was last set     */
+    bru_byte_t       *memory;    /**< general memory stored after the thread  */
+    const char      **captures;  /**< capture SPs stored after the thread     */
+} BruBitStateThread;
+
+typedef struct bru_bitstate_thread_manager {
+    // job stack for DFS scheduling, in the same order as the Spencer scheduler
+    size_t in_order_idx; /**< the index for inserting threads when in-order   */
+    BruThread  *active;  /**< the active thread, which is not on the stack    */
+    BruThread **stack;   /**< stc_vec of the threads waiting to run           */
+    BruThreadPool *pool; /**< the pool of threads                             */
+
+    // visited set of (PC, SP) pairs
+    const bru_byte_t *insts;     /**< the instruction stream of the program   */
+    size_t            insts_len; /**< the number of bytes of the stream       */
+    const char       *start_sp;  /**< the SP of the first position of the set */
+    const char       *text_end;  /**< the SP of the last position of the set  */
+    bru_byte_t       *visited;   /**< bitset of the pairs run since `init`    */
+    size_t            visited_alloc; /**< the number of bytes allocated       */
+
+    // for spawning threads
+    bru_len_t memory_len; /**< number bytes allocated for thread memory       */
+    bru_len_t ncaptures;  /**< number captures to allocate memory in threads  */
+} BruBitStateThreadManager;
+
+/* --- BitStateThreadManager function prototypes ---------------------------- */
+
+static void bitstate_thread_manager_init(void             *impl,
+                                         const bru_byte_t *start_pc,
+                                         const char       *start_sp,
+                                         const char       *text_end);
+static void bitstate_thread_manager_reset(void *impl);
+static void bitstate_thread_manager_free(void *impl);
+
+static void bitstate_thread_manager_schedule_thread(void *impl, BruThread *t);
+static void bitstate_thread_manager_schedule_thread_in_order(void      *impl,
+                                                             BruThread *t);
+static BruThread *bitstate_thread_manager_next_thread(void *impl);
+static void       bitstate_thread_manager_notify_thread_match(void      *impl,
+                                                              BruThread *t);
+static BruThread *bitstate_thread_manager_clone_thread(void            *impl,
+                                                       const BruThread *t);
+static void       bitstate_thread_manager_kill_thread(void *impl, BruThread *t);
+static const bru_byte_t *bitstate_thread_pc(void *impl, const BruThread *t);
+static void
+bitstate_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc);
+static const char *bitstate_thread_sp(void *impl, const BruThread *t);
+static void bitstate_thread_inc_sp(void *impl, BruThread *t, size_t nbytes);
+static void *
+bitstate_thread_memory(void *impl, const BruThread *t, bru_len_t idx);
+static void bitstate_thread_set_memory(void       *impl,
+                                       BruThread  *t,
+                                       bru_len_t   idx,
+                                       const void *val,
+                                       size_t      size);
+static const char *const *
+bitstate_thread_captures(void *impl, const BruThread *t, bru_len_t *ncaptures);
+static void
+bitstate_thread_set_capture(void *impl, BruThread *t, bru_len_t idx);
+static int bitstate_thread_manager_run(void              *impl,
+                                       const BruProgram  *prog,
+                                       const char        *text,
+                                       const char        *text_end,
+                                       const char       **captures,
+                                       bru_len_t          ncaptures,
+                                       BruMemoTable      *memo_table,
+                                       const char       **matched_sp);
+
+/* --- Helper function prototypes ------------------------------------------- */
+
+static BruThread *bitstate_thread_manager_pop(BruBitStateThreadManager *self);
+static int        bitstate_thread_manager_visit(BruBitStateThreadManager *self,
+                                                const BruThread          *t);
+static BruBitStateThread *
+bitstate_thread_manager_get_thread(BruBitStateThreadManager *self);
+
+/* --- BitStateThreadManager function definitions --------------------------- */
+
+BruThreadManager *bru_bitstate_thread_manager_new(const BruProgram *prog,
+                                                  FILE             *logfile)
+{
+    BruThreadManager         *tm;
+    BruBitStateThreadManager *btm;
+
+    if (!stc_vec_is_empty(prog->counters)) return NULL;
+
+    tm  = malloc(sizeof(*tm));
+    btm = malloc(sizeof(*btm));
+
+    btm->in_order_idx = 0;
+    btm->active       = NULL;
+    stc_vec_default_init(btm->stack); // NOLINT(bugprone-sizeof-expression)
+    btm->insts         = prog->insts;
+    btm->insts_len     = stc_vec_len(prog->insts);
+    btm->start_sp      = NULL;
+    btm->text_end      = NULL;
+    btm->visited       = NULL;
+    btm->visited_alloc = 0;
+    btm->memory_len    = prog->thread_mem_len;
+    btm->ncaptures     = prog->ncaptures;
+    btm->pool          = bru_thread_pool_new(
+        sizeof(BruBitStateThread) + sizeof(const char *) * 2 * btm->ncaptures +
+            btm->memory_len,
+        logfile);
+
+    BRU_THREAD_MANAGER_SET_REQUIRED_FUNCS(tm, bitstate);
+
+    tm->counter     = bru_thread_manager_counter_noop;
+    tm->set_counter = bru_thread_manager_set_counter_noop;
+    tm->inc_counter = bru_thread_manager_inc_counter_noop;
+    tm->memory      = bitstate_thread_memory;
+    tm->set_memory  = bitstate_thread_set_memory;
+    tm->captures    = bitstate_thread_captures;
+    tm->set_capture = bitstate_thread_set_capture;
+
+    // the visited set already runs each memoised pair at most once
+    tm->init_memoisation = bru_thread_manager_init_memoisation_noop;
+    tm->memoise          = bru_thread_manager_memoise_noop;
+
+    tm->run  = bitstate_thread_manager_run;
+    tm->impl = btm;
+
+    return tm;
+}
+
+static void bitstate_thread_manager_init(void             *impl,
+                                         const bru_byte_t *start_pc,
+                                         const char       *start_sp,
+                                         const char       *text_end)
+{
+    BruBitStateThreadManager *self = impl;
+    BruBitStateThread        *bt   = bitstate_thread_manager_get_thread(self);
+    size_t                    nbytes;
+
+    // threads only move forward, so the set only needs the positions from the
+    // start SP up to and including the end of the input
+    nbytes = ((text_end - start_sp + 1) * self->insts_len + 7) / 8;
+    if (nbytes > self->visited_alloc) {
+        free(self->visited);
+        self->visited       = malloc(nbytes);
+        self->visited_alloc = nbytes;
+    }
+    memset(self->visited, 0, nbytes);
+    self->start_sp = start_sp;
+    self->text_end = text_end;
+
+    bt->pc        = start_pc;
+    bt->sp        = start_sp;
+    bt->memory_sp = NULL;
+    memset(bt->memory, 0, sizeof(*bt->memory) * self->memory_len);
+    memset(bt->captures, 0, sizeof(*bt->captures) * 2 * self->ncaptures);
+
+    bitstate_thread_manager_schedule_thread(impl, (BruThread *) bt);
+}
+
+static void bitstate_thread_manager_reset(void *impl)
+{
+    BruBitStateThreadManager *self = impl;
+    BruThread                *t;
+
+    self->in_order_idx = 0;
+    while ((t = bitstate_thread_manager_pop(self)))
+        bitstate_thread_manager_kill_thread(impl, t);
+}
+
+static void bitstate_thread_manager_free(void *impl)
+{
+    BruBitStateThreadManager *self = impl;
+
+    bitstate_thread_manager_reset(impl);
+    stc_vec_free(self->stack);
+    bru_thread_pool_free(self->pool);
+    free(self->visited);
+    free(impl);
+}
+
+static void bitstate_thread_manager_schedule_thread(void *impl, BruThread *t)
+{
+    BruBitStateThreadManager *self = impl;
+
+    self->in_order_idx = stc_vec_len_unsafe(self->stack) + 1;
+    if (self->active)
+        // NOLINTNEXTLINE(bugprone-sizeof-expression)
+        stc_vec_push_back(self->stack, t);
+    else
+        self->active = t;
+}
+
+static void bitstate_thread_manager_schedule_thread_in_order(void      *impl,
+                                                             BruThread *t)
+{
+    BruBitStateThreadManager *self = impl;
+    size_t                    len  = stc_vec_len_unsafe(self->stack);
+
+    if (self->in_order_idx > len) {
+        bitstate_thread_manager_schedule_thread(impl, t);
+        self->in_order_idx = len;
+    } else if (self->in_order_idx == len) {
+        // NOLINTNEXTLINE(bugprone-sizeof-expression)
+        stc_vec_push_back(self->stack, t);
+    } else {
+        // NOLINTNEXTLINE(bugprone-sizeof-expression)
+        stc_vec_insert(self->stack, self->in_order_idx, t);
+    }
+}
+
+static BruThread *bitstate_thread_manager_next_thread(void *impl)
+{
+    BruBitStateThreadManager *self = impl;
+    BruThread                *t;
+
+    // a pair is checked when its thread runs rather than when it is scheduled,
+    // so that the first thread to run it is the one with the highest priority
+    while ((t = bitstate_thread_manager_pop(self)) &&
+           !bitstate_thread_manager_visit(self, t))
+        bitstate_thread_manager_kill_thread(impl, t);
+
+    return t;
+}
+
+static void bitstate_thread_manager_notify_thread_match(void      *impl,
+                                                        BruThread *t)
+{
+    // empty the job stack
+    bitstate_thread_manager_kill_thread(impl, t);
+    bitstate_thread_manager_reset(impl);
+}
+
+static BruThread *bitstate_thread_manager_clone_thread(void            *impl,
+                                                       const BruThread *t)
+{
+    BruBitStateThreadManager *self = impl;
+    BruBitStateThread        *bt   = bitstate_thread_manager_get_thread(self);
+    const BruBitStateThread  *src  = (const BruBitStateThread *) t;
+
+    bt->pc        = src->pc;
+    bt->sp        = src->sp;
+    bt->memory_sp = src->memory_sp;
+    memcpy(bt->memory, src->memory, sizeof(*bt->memory) * self->memory_len);
+    memcpy(bt->captures, src->captures,
+           sizeof(*bt->captures) * 2 * self->ncaptures);
+
+    return (BruThread *) bt;
+}
+
+static void bitstate_thread_manager_kill_thread(void *impl, BruThread *t)
+{
+    bru_thread_pool_add_thread(((BruBitStateThreadManager *) impl)->pool, t);
+}
+
+static const bru_byte_t *bitstate_thread_pc(void *impl, const BruThread *t)
+{
+    BRU_UNUSED(impl);
+    return t->pc;
+}
+
+static void
+bitstate_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc)
+{
+    BRU_UNUSED(impl);
+    t->pc = pc;
+}
+
+static const char *bitstate_thread_sp(void *impl, const BruThread *t)
+{
+    BRU_UNUSED(impl);
+    return t->sp;
+}
+
+static void bitstate_thread_inc_sp(void *impl, BruThread *t, size_t nbytes)
+{
+    BRU_UNUSED(impl);
+    t->sp += nbytes;
+}
+
+static void *
+bitstate_thread_memory(void *impl, const BruThread *t, bru_len_t idx)
+{
+    BRU_UNUSED(impl);
+    return ((BruBitStateThread *) t)->memory + idx;
+}
+
+static void bitstate_thread_set_memory(void       *impl,
+                                       BruThread  *t,
+                                       bru_len_t   idx,
+                                       const void *val,
+                                       size_t      size)
+{
+    BRU_UNUSED(impl);
+    ((BruBitStateThread *) t)->memory_sp = t->sp;
+    memcpy(((BruBitStateThread *) t)->memory + idx, val, size);
+}
+
+static const char *const *
+bitstate_thread_captures(void *impl, const BruThread *t, bru_len_t *ncaptures)
+{
+    if (ncaptures) *ncaptures = ((BruBitStateThreadManager *) impl)->ncaptures;
+    return ((BruBitStateThread *) t)->captures;
+}
+
+static void
+bitstate_thread_set_capture(void *impl, BruThread *t, bru_len_t idx)
+{
+    BRU_UNUSED(impl);
+    ((BruBitStateThread *) t)->captures[idx] = ((BruBitStateThread *) t)->sp;
+}
+
+/* --- Helper functions ----------------------------------------------------- */
+
+/**
+ * Take the next thread to run off the job stack.
+ *
+ * @param[in] self the bit-state thread manager
+ *
+ * @return the next thread if there is one; else NULL
+ */
+static BruThread *bitstate_thread_manager_pop(BruBitStateThreadManager *self)
+{
+    BruThread *t = self->active;
+
+    self->in_order_idx = stc_vec_len_unsafe(self->stack) + 1;
+    self->active       = NULL;
+    if (t == NULL && !stc_vec_is_empty(self->stack))
+        t = stc_vec_pop(self->stack);
+
+    return t;
+}
+
+/**
+ * Add the (PC, SP) pair of a thread to the visited set.
+ *
+ * A thread which set its memory at its SP (with `epsset`) may fail an `epschk`
+ * that another thread at the same pair passes, so it neither checks nor adds
+ * its pair. Once it moves past the SP, its memory no longer decides what it
+ * matches. Such threads only run in between steps over the input, so matching
+ * still takes linear time in the length of the input.
+ *
+ * A thread with its SP outside the positions of the set, such as past the end
+ * of the input, has no pair in the set and is killed.
+ *
+ * @param[in] self the bit-state thread manager
+ * @param[in] t    the thread
+ *
+ * @return truthy value if the pair was not visited yet; else 0
+ */
+static int bitstate_thread_manager_visit(BruBitStateThreadManager *self,
+                                         const BruThread          *t)
+{
+    size_t     i;
+    bru_byte_t mask;
+
+    if (t->sp < self->start_sp || t->sp > self->text_end) return FALSE;
+    if (((const BruBitStateThread *) t)->memory_sp == t->sp) return TRUE;
+
+    i    = (t->sp - self->start_sp) * self->insts_len + (t->pc - self->insts);
+    mask = 1 << (i % 8);
+    if (self->visited[i / 8] & mask) return FALSE;
+    self->visited[i / 8] |= mask;
+
+    return TRUE;
+}
+
+static BruBitStateThread *
+bitstate_thread_manager_get_thread(BruBitStateThreadManager *self)
+{
+    BruBitStateThread *bt =
+        (BruBitStateThread *) bru_thread_pool_get_thread(self->pool);
+
+    // the captures and memory are stored contiguously after the thread in the
+    // block from the pool
+    bt->captures = (const char **) (bt + 1);
+    bt->memory   = (bru_byte_t *) (bt->captures + 2 * self->ncaptures);
+
+    return bt;
+}
+
+/* --- Specialised execution loop ------------------------------------------- */
+
+#define BRU_SRVM_RUN_NAME         bitstate_thread_manager_run
+#define BRU_SRVM_RUN_TM           void *
+#define BRU_SRVM_RUN_NEXT_THREAD  bitstate_thread_manager_next_thread
+#define BRU_SRVM_RUN_PC           bitstate_thread_pc
+#define BRU_SRVM_RUN_SET_PC       bitstate_thread_set_pc
+#define BRU_SRVM_RUN_SP           bitstate_thread_sp
+#define BRU_SRVM_RUN_INC_SP       bitstate_thread_inc_sp
+#define BRU_SRVM_RUN_SCHEDULE     bitstate_thread_manager_schedule_thread
+#define BRU_SRVM_RUN_KILL         bitstate_thread_manager_kill_thread
+#define BRU_SRVM_RUN_CLONE        bitstate_thread_manager_clone_thread
+#define BRU_SRVM_RUN_NOTIFY_MATCH bitstate_thread_manager_notify_thread_match
+#define BRU_SRVM_RUN_CAPTURES     bitstate_thread_captures
+#define BRU_SRVM_RUN_SET_CAPTURE  bitstate_thread_set_capture
+#define BRU_SRVM_RUN_COUNTER      bru_thread_manager_counter_noop
+#define BRU_SRVM_RUN_SET_COUNTER  bru_thread_manager_set_counter_noop
+#define BRU_SRVM_RUN_INC_COUNTER  bru_thread_manager_inc_counter_noop
+#define BRU_SRVM_RUN_MEMORY       bitstate_thread_memory
+#define BRU_SRVM_RUN_SET_MEMORY   bitstate_thread_set_memory
+#define BRU_SRVM_RUN_SCHEDULE_IN_ORDER \
+    bitstate_thread_manager_schedule_thread_in_order
+#include "../srvm_run.h"
@@ -0,0 +1,51 @@
+#ifndef BRU_VM_THREAD_MANAGER_BITSTATE_H
+#define BRU_VM_THREAD_MANAGER_BITSTATE_H
+
+#include <stdio.h>
+
+#include "../program.h"
+#include "thread_manager.h"
+
+/**
+ * The number of bits of the visited set (the number of bytes of the instruction
+ * stream times the number of positions in the input) up to which the bit-state
+ * thread manager is preferred over the Spencer and lockstep thread managers.
+ */
+#define BRU_BITSTATE_MAX_BITS (256 * 1024)
+
+#if !defined(BRU_VM_THREAD_MANAGER_BITSTATE_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_THREAD_MANAGER_BITSTATE_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&                        \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) ||                     \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+#    define BITSTATE_MAX_BITS BRU_BITSTATE_MAX_BITS
+
+#    define bitstate_thread_manager_new bru_bitstate_thread_manager_new
+#endif /* BRU_VM_THREAD_MANAGER_BITSTATE_ENABLE_SHORT_NAMES */
+
+/* --- BitState ThreadManager function prototypes --------------------------- */
+
+/**
+ * Construct a thread manager that performs bounded backtracking regex matching.
+ *
+ * Threads are run depth-first in the same order as the Spencer-style thread
+ * manager, however each (PC, SP) pair is run at most once per match: a thread
+ * reaching a pair again is killed, since the thread which reached it first has
+ * already found every match from it. The pairs are kept in a visited bitset of
+ * the length of the instruction stream times the length of the input, so that
+ * matching takes linear time in the length of the input, and threads are taken
+ * from a thread pool so that no memory is allocated once it is warmed up.
+ *
+ * Counters are not supported since a pair does not decide what a thread with
+ * counters matches.
+ *
+ * @param[in] prog    the program the thread manager will execute
+ * @param[in] logfile the file for logging output
+ *
+ * @return the constructed bit-state thread manager if the program is supported;
+ *         else NULL
+ */
+BruThreadManager *bru_bitstate_thread_manager_new(const BruProgram *prog,
+                                                  FILE             *logfile);
+
+#endif /* BRU_VM_THREAD_MANAGER_BITSTATE_H */
@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cow_captures.h"
+#include "thread_pool.h"
+
+/* --- Type definitions ----------------------------------------------------- */
+
+struct bru_cow_captures {
+    size_t      nrefs; /**< the number of threads referencing the captures   */
+    const char *sps[]; /**< the capture SPs                                   */
+};
+
+struct bru_cow_captures_pool {
+    BruThreadPool *pool;      /**< the blocks of the capture arrays           */
+    bru_len_t      ncaptures; /**< the number of captures of each array       */
+};
+
+/* --- API function definitions --------------------------------------------- */
+
+BruCowCapturesPool *bru_cow_captures_pool_new(bru_len_t ncaptures,
+                                              FILE     *logfile)
+{
+    BruCowCapturesPool *pool = malloc(sizeof(*pool));
+
+    // the thread pool only hands out blocks of a fixed size, which need not
+    // hold threads
+    pool->pool = bru_thread_pool_new(
+        sizeof(BruCowCaptures) + sizeof(const char *) * 2 * ncaptures, logfile);
+    pool->ncaptures = ncaptures;
+
+    return pool;
+}
+
+void bru_cow_captures_pool_free(BruCowCapturesPool *self)
+{
+    bru_thread_pool_free(self->pool);
+    free(self);
+}
+
+const char **bru_cow_captures_new(BruCowCapturesPool *self,
+                                  BruCowCaptures    **captures)
+{
+    BruCowCaptures *c =
+        (BruCowCaptures *) bru_thread_pool_get_thread(self->pool);
+
+    c->nrefs = 1;
+    memset(c->sps, 0, sizeof(*c->sps) * 2 * self->ncaptures);
+    *captures = c;
+
+    return c->sps;
+}
+
+void bru_cow_captures_share(BruCowCaptures *captures) { captures->nrefs++; }
+
+const char **bru_cow_captures_own(BruCowCapturesPool *self,
+                                  BruCowCaptures    **captures)
+{
+    BruCowCaptures *c = *captures;
+
+    if (c->nrefs > 1) {
+        c->nrefs--;
+        c        = (BruCowCaptures *) bru_thread_pool_get_thread(self->pool);
+        c->nrefs = 1;
+        memcpy(c->sps, (*captures)->sps, sizeof(*c->sps) * 2 * self->ncaptures);
+        *captures = c;
+    }
+
+    return c->sps;
+}
+
+void bru_cow_captures_release(BruCowCapturesPool *self,
+                              BruCowCaptures     *captures)
+{
+    if (--captures->nrefs == 0)
+        bru_thread_pool_add_thread(self->pool, (BruThread *) captures);
+}
@@ -0,0 +1,98 @@
+#ifndef BRU_VM_THREAD_MANAGER_COW_CAPTURES_H
+#define BRU_VM_THREAD_MANAGER_COW_CAPTURES_H
+
+#include <stdio.h>
+
+#include "../../types.h"
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct bru_cow_captures      BruCowCaptures;
+typedef struct bru_cow_captures_pool BruCowCapturesPool;
+
+#if !defined(BRU_VM_THREAD_MANAGER_COW_CAPTURES_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_THREAD_MANAGER_COW_CAPTURES_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&                            \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) ||                         \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+typedef BruCowCaptures     CowCaptures;
+typedef BruCowCapturesPool CowCapturesPool;
+
+#    define cow_captures_pool_new  bru_cow_captures_pool_new
+#    define cow_captures_pool_free bru_cow_captures_pool_free
+#    define cow_captures_new       bru_cow_captures_new
+#    define cow_captures_share     bru_cow_captures_share
+#    define cow_captures_own       bru_cow_captures_own
+#    define cow_captures_release   bru_cow_captures_release
+#endif /* BRU_VM_THREAD_MANAGER_COW_CAPTURES_ENABLE_SHORT_NAMES */
+
+/* --- API function prototypes ---------------------------------------------- */
+
+/**
+ * Create a new pool of copy-on-write capture arrays.
+ *
+ * A copy-on-write capture array is shared by every thread cloned from the
+ * thread which created it, and counts the threads referencing it, so that
+ * cloning a thread only increments the count instead of copying the captures.
+ * The array is only copied when a thread sharing it sets a capture. Arrays are
+ * taken from a thread pool so that no memory is allocated once it is warmed up.
+ *
+ * @param[in] ncaptures the number of captures of each array
+ * @param[in] logfile   the file for logging output
+ *
+ * @return the pool of copy-on-write capture arrays
+ */
+BruCowCapturesPool *bru_cow_captures_pool_new(bru_len_t ncaptures,
+                                              FILE     *logfile);
+
+/**
+ * Free the pool of copy-on-write capture arrays, including all arrays that were
+ * obtained from the pool.
+ *
+ * @param[in] self the pool of copy-on-write capture arrays
+ */
+void bru_cow_captures_pool_free(BruCowCapturesPool *self);
+
+/**
+ * Get a new capture array from the pool with all captures unset, referenced
+ * only by the caller.
+ *
+ * @param[in]  self     the pool of copy-on-write capture arrays
+ * @param[out] captures the new copy-on-write capture array
+ *
+ * @return the capture SPs of the new array
+ */
+const char **bru_cow_captures_new(BruCowCapturesPool *self,
+                                  BruCowCaptures    **captures);
+
+/**
+ * Add a reference to a capture array for a thread cloned from one referencing
+ * it.
+ *
+ * @param[in] captures the copy-on-write capture array
+ */
+void bru_cow_captures_share(BruCowCaptures *captures);
+
+/**
+ * Make a capture array writable by the caller, by replacing it with a copy only
+ * referenced by the caller if it is shared.
+ *
+ * @param[in]     self     the pool of copy-on-write capture arrays
+ * @param[in,out] captures the copy-on-write capture array to make writable
+ *
+ * @return the capture SPs of the writable array
+ */
+const char **bru_cow_captures_own(BruCowCapturesPool *self,
+                                  BruCowCaptures    **captures);
+
+/**
+ * Remove a reference to a capture array, returning it to the pool once it is
+ * no longer referenced.
+ *
+ * @param[in] self     the pool of copy-on-write capture arrays
+ * @param[in] captures the copy-on-write capture array
+ */
+void bru_cow_captures_release(BruCowCapturesPool *self,
+                              BruCowCaptures     *captures);
+
+#endif /* BRU_VM_THREAD_MANAGER_COW_CAPTURES_H */
@@ -1,10 +1,12 @@
+#include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
-#include "../../stc/fatp/slice.h"
 #include "../../stc/fatp/vec.h"
 
 #include "../../utils.h"
+#include "cow_captures.h"
 #include "lockstep.h"
 #include "thread_manager.h"
 #include "thread_pool.h"
@@ -14,25 +16,58 @@
 typedef struct bru_thompson_thread {
     const bru_byte_t *pc;
     const char       *sp;
-    bru_cntr_t       *counters; /**< stc_slice of counter values              */
-    bru_byte_t       *memory;   /**< stc_slice for general memory             */
-    const char      **captures; /**< stc_slice of capture SPs                 */
+    bru_cntr_t       *counters; /**< counter values stored after the thread   */
+    bru_byte_t       *memory;   /**< general memory stored after the thread   */
+    const char      **captures; /**< capture SPs stored after the thread      */
+    BruCowCaptures   *cow;      /**< the captures if copy-on-write, else NULL */
 } BruThompsonThread;
 
+typedef struct {
+    size_t     pc_idx; /**< offset of the thread PC into the instructions     */
+    size_t     hash;   /**< hash of the counter values of the thread          */
+    size_t     chain;  /**< index of the next entry with the same PC offset   */
+    BruThread *thread; /**< the thread in the set                             */
+} BruThompsonThreadSetEntry;
+
+/**
+ * Sparse set of threads keyed by PC offset (as in the Pike VM), where threads
+ * with the same PC offset are chained and distinguished by their counter
+ * values. Membership and insertion are constant time for counter-free programs
+ * and clearing the set is always constant time.
+ */
+typedef struct {
+    const bru_byte_t          *insts;      /**< start of instruction stream   */
+    size_t                    *sparse;     /**< maps PC offset to dense index */
+    size_t                     sparse_len; /**< number of offsets in sparse   */
+    BruThompsonThreadSetEntry *dense;      /**< stc_vec of entries in set     */
+    bru_len_t                  ncounters;  /**< number of counters of thread  */
+} BruThompsonThreadSet;
+
 typedef struct bru_thompson_scheduler {
     int in_lockstep; /**< whether to execute the synchronisation thread queue */
 
-    BruThread **curr; /**< stc_vec for current queue of threads to execute    */
-    BruThread **next; /**< stc_vec for next queue of threads to be executed   */
-    BruThread **sync; /**< stc_vec for synchronisation queue for lockstep     */
+    BruThread          **curr;     /**< stc_vec for current queue of threads  */
+    size_t               head;     /**< index of next thread to pop in `curr` */
+    BruThread          **next;     /**< stc_vec for next queue of threads     */
+    BruThread          **sync;     /**< stc_vec for synchronisation queue     */
+    BruThompsonThreadSet sync_set; /**< set of the threads in `sync`          */
+
+#ifdef BRU_BENCHMARK
+    size_t max_step_len; /**< the most threads synchronised in a single step  */
+#endif /* BRU_BENCHMARK */
 } BruThompsonScheduler;
 
 typedef struct bru_thompson_thread_manager {
     BruThompsonScheduler *scheduler; /**< Thompson scheduler for scheduling   */
     BruThreadPool        *pool;      /**< the pool of threads                 */
-    const bru_byte_t     *start_pc;  /**< the starting PC for new threads     */
+    BruCowCapturesPool   *cow;       /**< pool of shared captures, or NULL    */
     const char           *sp;        /**< the string pointer for lockstep     */
-    int                   matched;   /**< whether a match has been found      */
+    const char           *text_end;  /**< the end of the input string         */
+    FILE                 *logfile;   /**< the file for logging output         */
+
+    // for streaming
+    int more;      /**< whether more input follows `text_end` in the stream   */
+    int suspended; /**< whether the threads are suspended at `text_end`       */
 
     // for spawning threads
     bru_len_t ncounters;  /**< number counter values to spawn threads with    */
@@ -44,10 +79,10 @@ typedef struct bru_thompson_thread_manager {
 
 static void thompson_thread_manager_init(void             *impl,
                                          const bru_byte_t *start_pc,
-                                         const char       *start_sp);
+                                         const char       *start_sp,
+                                         const char       *text_end);
 static void thompson_thread_manager_reset(void *impl);
 static void thompson_thread_manager_free(void *impl);
-static int  thompson_thread_manager_done_exec(void *impl);
 
 static void thompson_thread_manager_schedule_new_thread(void             *impl,
                                                         const bru_byte_t *pc,
@@ -66,7 +101,7 @@ static const bru_byte_t *thompson_thread_pc(void *impl, const BruThread *t);
 static void
 thompson_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc);
 static const char *thompson_thread_sp(void *impl, const BruThread *t);
-static void        thompson_thread_inc_sp(void *impl, BruThread *t);
+static void thompson_thread_inc_sp(void *impl, BruThread *t, size_t nbytes);
 static bru_cntr_t
 thompson_thread_counter(void *impl, const BruThread *t, bru_len_t idx);
 static void thompson_thread_set_counter(void      *impl,
@@ -86,28 +121,60 @@ static const char *const *
 thompson_thread_captures(void *impl, const BruThread *t, bru_len_t *ncaptures);
 static void
            thompson_thread_set_capture(void *impl, BruThread *t, bru_len_t idx);
-static int thompson_threads_contain(BruThread **threads, BruThread *thread);
+static int thompson_thread_manager_run(void              *impl,
+                                       const BruProgram  *prog,
+                                       const char        *text,
+                                       const char        *text_end,
+                                       const char       **captures,
+                                       bru_len_t          ncaptures,
+                                       BruMemoTable      *memo_table,
+                                       const char       **matched_sp);
+static int thompson_thread_manager_stream(void       *impl,
+                                          const char *chunk,
+                                          const char *chunk_end,
+                                          int         more);
+static int
+thompson_thread_eq(BruThread *t1, BruThread *t2, bru_len_t ncounters);
+static size_t thompson_thread_hash(BruThread *t, bru_len_t ncounters);
+
+/* --- ThompsonThreadSet function prototypes -------------------------------- */
+
+static void thompson_thread_set_init(BruThompsonThreadSet *self,
+                                     bru_len_t             ncounters);
+static int  thompson_thread_set_contains(BruThompsonThreadSet *self,
+                                         BruThread            *thread);
+static void thompson_thread_set_insert(BruThompsonThreadSet *self,
+                                       BruThread            *thread);
+static void thompson_thread_set_clear(BruThompsonThreadSet *self);
+static void thompson_thread_set_free(BruThompsonThreadSet *self);
 
 /* --- ThompsonScheduler function prototypes -------------------------------- */
 
-static BruThompsonScheduler *thompson_scheduler_new(void);
+static BruThompsonScheduler *thompson_scheduler_new(bru_len_t ncounters);
 static int        thompson_scheduler_schedule(BruThompsonScheduler *self,
                                               BruThread            *thread);
 static int        thompson_scheduler_done_step(BruThompsonScheduler *self);
 static int        thompson_scheduler_has_next(BruThompsonScheduler *self);
 static BruThread *thompson_scheduler_next(BruThompsonScheduler *self);
+static int        thompson_scheduler_curr_is_empty(BruThompsonScheduler *self);
 static void       thompson_scheduler_free(BruThompsonScheduler *self);
 
 /* --- Helper function prototypes ------------------------------------------- */
 
-static BruThompsonThread             *
-thompson_thread_manager_new_thread(BruThompsonThreadManager *self);
 static void thompson_thread_manager_copy_thread(BruThompsonThreadManager *self,
                                                 BruThompsonThread        *dst,
                                                 const BruThompsonThread  *src);
 static BruThompsonThread             *
 thompson_thread_manager_get_thread(BruThompsonThreadManager *self);
-static void thompson_thread_free(BruThread *t);
+static void
+thompson_thread_manager_rebase_thread(BruThompsonThreadManager *self,
+                                      BruThompsonThread        *tt,
+                                      uintptr_t                 delta);
+static BruThreadManager *thompson_thread_manager_create(bru_len_t ncounters,
+                                                        bru_len_t memory_len,
+                                                        bru_len_t ncaptures,
+                                                        int       cow,
+                                                        FILE     *logfile);
 
 /* --- ThompsonThreadManager function definitions --------------------------- */
 
@@ -115,15 +182,43 @@ BruThreadManager *bru_thompson_thread_manager_new(bru_len_t ncounters,
                                                   bru_len_t memory_len,
                                                   bru_len_t ncaptures,
                                                   FILE     *logfile)
+{
+    return thompson_thread_manager_create(ncounters, memory_len, ncaptures,
+                                          FALSE, logfile);
+}
+
+BruThreadManager *bru_thompson_cow_thread_manager_new(bru_len_t ncounters,
+                                                      bru_len_t memory_len,
+                                                      bru_len_t ncaptures,
+                                                      FILE     *logfile)
+{
+    return thompson_thread_manager_create(ncounters, memory_len, ncaptures,
+                                          TRUE, logfile);
+}
+
+static BruThreadManager *thompson_thread_manager_create(bru_len_t ncounters,
+                                                        bru_len_t memory_len,
+                                                        bru_len_t ncaptures,
+                                                        int       cow,
+                                                        FILE     *logfile)
 {
     BruThreadManager         *tm  = malloc(sizeof(*tm));
     BruThompsonThreadManager *ttm = malloc(sizeof(*ttm));
 
-    ttm->scheduler  = thompson_scheduler_new();
-    ttm->pool       = bru_thread_pool_new(logfile);
+    ttm->scheduler  = thompson_scheduler_new(ncounters);
     ttm->ncounters  = ncounters;
     ttm->memory_len = memory_len;
     ttm->ncaptures  = ncaptures;
+    ttm->logfile    = logfile;
+    ttm->cow        = NULL;
+    if (cow) ttm->cow = bru_cow_captures_pool_new(ncaptures, logfile);
+    // copy-on-write captures are not stored after the thread
+    ttm->pool = bru_thread_pool_new(
+        sizeof(BruThompsonThread) +
+            (cow ? 0 : sizeof(const char *) * 2 * ncaptures) +
+            BRU_ALIGN_UP(memory_len, sizeof(bru_cntr_t)) +
+            sizeof(bru_cntr_t) * ncounters,
+        logfile);
 
     BRU_THREAD_MANAGER_SET_REQUIRED_FUNCS(tm, thompson);
 
@@ -140,22 +235,29 @@ BruThreadManager *bru_thompson_thread_manager_new(bru_len_t ncounters,
     tm->init_memoisation = bru_thread_manager_init_memoisation_noop;
     tm->memoise          = bru_thread_manager_memoise_noop;
 
-    tm->impl = ttm;
+    tm->run    = thompson_thread_manager_run;
+    tm->stream = thompson_thread_manager_stream;
+    tm->impl   = ttm;
 
     return tm;
 }
 
 static void thompson_thread_manager_init(void             *impl,
                                          const bru_byte_t *start_pc,
-                                         const char       *start_sp)
+                                         const char       *start_sp,
+                                         const char       *text_end)
 {
     BruThompsonThreadManager *self = impl;
 
-    self->start_pc               = start_pc;
     self->sp                     = start_sp;
-    self->matched                = FALSE;
+    self->text_end               = text_end;
+    self->more                   = FALSE;
+    self->suspended              = FALSE;
     self->scheduler->in_lockstep = FALSE;
 
+    thompson_thread_set_clear(&self->scheduler->sync_set);
+    self->scheduler->sync_set.insts = start_pc;
+
     thompson_thread_manager_schedule_new_thread(impl, start_pc, start_sp);
 }
 
@@ -173,16 +275,16 @@ static void thompson_thread_manager_free(void *impl)
     BruThompsonThreadManager *self = impl;
 
     thompson_thread_manager_reset(impl);
+#ifdef BRU_BENCHMARK
+    fprintf(self->logfile, "MAX THREADS IN LOCKSTEP: %zu\n",
+            self->scheduler->max_step_len);
+#endif /* BRU_BENCHMARK */
     thompson_scheduler_free(self->scheduler);
-    bru_thread_pool_free(self->pool, thompson_thread_free);
+    bru_thread_pool_free(self->pool);
+    if (self->cow) bru_cow_captures_pool_free(self->cow);
     free(impl);
 }
 
-static int thompson_thread_manager_done_exec(void *impl)
-{
-    return *((BruThompsonThreadManager *) impl)->sp == '\0';
-}
-
 static void thompson_thread_manager_schedule_new_thread(void             *impl,
                                                         const bru_byte_t *pc,
                                                         const char       *sp)
@@ -195,7 +297,10 @@ static void thompson_thread_manager_schedule_new_thread(void             *impl,
 
     memset(tt->counters, 0, sizeof(*tt->counters) * self->ncounters);
     memset(tt->memory, 0, sizeof(*tt->memory) * self->memory_len);
-    memset(tt->captures, 0, sizeof(*tt->captures) * 2 * self->ncaptures);
+    if (self->cow)
+        tt->captures = bru_cow_captures_new(self->cow, &tt->cow);
+    else
+        memset(tt->captures, 0, sizeof(*tt->captures) * 2 * self->ncaptures);
 
     thompson_thread_manager_schedule_thread(impl, (BruThread *) tt);
 }
@@ -210,18 +315,25 @@ static void thompson_thread_manager_schedule_thread(void *impl, BruThread *t)
 static BruThread *thompson_thread_manager_next_thread(void *impl)
 {
     BruThompsonThreadManager *self = impl;
-    size_t                    i, len;
-
-    if (thompson_scheduler_done_step(self->scheduler) && *self->sp &&
-        (!self->matched || thompson_scheduler_has_next(self->scheduler))) {
-        self->sp = stc_utf8_str_next(self->sp);
-        for (i = 0, len = stc_vec_len(self->scheduler->next); i < len; i++)
-            self->scheduler->next[i]->sp = self->sp;
-        for (i = 0, len = stc_vec_len(self->scheduler->sync); i < len; i++)
-            self->scheduler->sync[i]->sp = self->sp;
-        if (!self->matched)
-            thompson_thread_manager_schedule_new_thread(impl, self->start_pc,
-                                                        self->sp);
+    const char               *sp;
+
+    // NOTE: new threads do not need to be spawned at each position as the
+    // program starts with an implicit `.*?` loop for unanchored search
+    // NOTE: every thread left after a step has consumed the same number of
+    // bytes (a codepoint, or a single byte for byte-level programs)
+    if (thompson_scheduler_done_step(self->scheduler) &&
+        self->sp < self->text_end &&
+        thompson_scheduler_has_next(self->scheduler)) {
+        sp = stc_vec_is_empty(self->scheduler->next)
+                 ? self->scheduler->sync[0]->sp
+                 : self->scheduler->next[0]->sp;
+        // the threads cannot tell the end of the chunk from the end of the
+        // input, so they wait for the next chunk of the stream
+        if (sp == self->text_end && self->more) {
+            self->suspended = TRUE;
+            return NULL;
+        }
+        self->sp = sp;
     }
 
     return thompson_scheduler_next(self->scheduler);
@@ -233,11 +345,11 @@ static void thompson_thread_manager_notify_thread_match(void      *impl,
     BruThompsonScheduler *ts = ((BruThompsonThreadManager *) impl)->scheduler;
     size_t                i, len = stc_vec_len(ts->curr);
 
-    ((BruThompsonThreadManager *) impl)->matched = TRUE;
     thompson_thread_manager_kill_thread(impl, t);
-    for (i = 0; i < len; i++)
+    for (i = ts->head; i < len; i++)
         thompson_thread_manager_kill_thread(impl, ts->curr[i]);
     stc_vec_clear(ts->curr);
+    ts->head = 0;
 }
 
 static BruThread *thompson_thread_manager_clone_thread(void            *impl,
@@ -254,9 +366,42 @@ static BruThread *thompson_thread_manager_clone_thread(void            *impl,
 static void thompson_thread_manager_kill_thread(void *impl, BruThread *t)
 {
     BruThompsonThreadManager *self = impl;
+
+    if (t && self->cow)
+        bru_cow_captures_release(self->cow, ((BruThompsonThread *) t)->cow);
     bru_thread_pool_add_thread(self->pool, t);
 }
 
+static int thompson_thread_manager_stream(void       *impl,
+                                          const char *chunk,
+                                          const char *chunk_end,
+                                          int         more)
+{
+    BruThompsonThreadManager *self = impl;
+    BruThompsonScheduler     *ts   = self->scheduler;
+    uintptr_t                 delta;
+    size_t                    i;
+
+    if (self->suspended) {
+        // the SPs of the previous chunks are kept relative to the current
+        // chunk, as if the stream were contiguous in memory
+        delta = (uintptr_t) chunk - (uintptr_t) self->text_end;
+        for (i = 0; i < stc_vec_len(ts->next); i++)
+            thompson_thread_manager_rebase_thread(
+                self, (BruThompsonThread *) ts->next[i], delta);
+        for (i = 0; i < stc_vec_len(ts->sync); i++)
+            thompson_thread_manager_rebase_thread(
+                self, (BruThompsonThread *) ts->sync[i], delta);
+        self->sp = chunk;
+    }
+
+    self->text_end  = chunk_end;
+    self->more      = more;
+    self->suspended = FALSE;
+
+    return thompson_scheduler_has_next(ts);
+}
+
 /* --- Thread function definitions ------------------------------------------ */
 
 static const bru_byte_t *thompson_thread_pc(void *impl, const BruThread *t)
@@ -278,11 +423,10 @@ static const char *thompson_thread_sp(void *impl, const BruThread *t)
     return t->sp;
 }
 
-static void thompson_thread_inc_sp(void *impl, BruThread *t)
+static void thompson_thread_inc_sp(void *impl, BruThread *t, size_t nbytes)
 {
     BRU_UNUSED(impl);
-    BRU_UNUSED(t);
-    // t->sp = stc_utf8_str_next(t->sp);
+    t->sp += nbytes;
 }
 
 static bru_cntr_t
@@ -327,51 +471,128 @@ static void thompson_thread_set_memory(void       *impl,
 static const char *const *
 thompson_thread_captures(void *impl, const BruThread *t, bru_len_t *ncaptures)
 {
-    BRU_UNUSED(impl);
-    if (ncaptures)
-        *ncaptures = stc_slice_len(((BruThompsonThread *) t)->captures) / 2;
+    if (ncaptures) *ncaptures = ((BruThompsonThreadManager *) impl)->ncaptures;
     return ((BruThompsonThread *) t)->captures;
 }
 
 static void thompson_thread_set_capture(void *impl, BruThread *t, bru_len_t idx)
 {
-    BRU_UNUSED(impl);
-    ((BruThompsonThread *) t)->captures[idx] = t->sp;
+    BruThompsonThreadManager *self = impl;
+    BruThompsonThread        *tt   = (BruThompsonThread *) t;
+
+    if (self->cow) tt->captures = bru_cow_captures_own(self->cow, &tt->cow);
+    tt->captures[idx] = t->sp;
 }
 
-static int thompson_thread_eq(BruThread *t1, BruThread *t2)
+static int
+thompson_thread_eq(BruThread *t1, BruThread *t2, bru_len_t ncounters)
 {
     BruThompsonThread *tt1 = (BruThompsonThread *) t1,
                       *tt2 = (BruThompsonThread *) t2;
-    bru_len_t i, len = stc_slice_len(tt1->counters);
-    int       eq = tt1->pc == tt2->pc && len == stc_slice_len(tt2->counters);
+    bru_len_t i;
+    int       eq = tt1->pc == tt2->pc;
 
-    for (i = 0; i < len && eq; i++) eq = tt1->counters[i] == tt2->counters[i];
+    for (i = 0; i < ncounters && eq; i++)
+        eq = tt1->counters[i] == tt2->counters[i];
 
     return eq;
 }
 
-static int thompson_threads_contain(BruThread **threads, BruThread *thread)
+static size_t thompson_thread_hash(BruThread *t, bru_len_t ncounters)
 {
-    size_t i, len;
+    BruThompsonThread *tt = (BruThompsonThread *) t;
+    bru_len_t          i;
+    size_t             hash = 0;
+
+    for (i = 0; i < ncounters; i++) hash = hash * 31 + tt->counters[i];
+
+    return hash;
+}
 
-    len = stc_vec_len(threads);
-    for (i = 0; i < len; i++)
-        if (thompson_thread_eq(threads[i], thread)) return TRUE;
+/* --- ThompsonThreadSet function definitions ------------------------------- */
+
+static void thompson_thread_set_init(BruThompsonThreadSet *self,
+                                     bru_len_t             ncounters)
+{
+    self->insts      = NULL;
+    self->sparse     = NULL;
+    self->sparse_len = 0;
+    stc_vec_default_init(self->dense);
+    self->ncounters = ncounters;
+}
+
+static int thompson_thread_set_contains(BruThompsonThreadSet *self,
+                                        BruThread            *thread)
+{
+    size_t i, hash, pc_idx = thread->pc - self->insts;
+
+    if (pc_idx >= self->sparse_len) return FALSE;
+    i = self->sparse[pc_idx];
+    if (i >= stc_vec_len(self->dense) || self->dense[i].pc_idx != pc_idx)
+        return FALSE;
+
+    hash = thompson_thread_hash(thread, self->ncounters);
+    for (; i != SIZE_MAX; i = self->dense[i].chain)
+        if (self->dense[i].hash == hash &&
+            thompson_thread_eq(self->dense[i].thread, thread,
+                               self->ncounters))
+            return TRUE;
 
     return FALSE;
 }
 
+static void thompson_thread_set_insert(BruThompsonThreadSet *self,
+                                       BruThread            *thread)
+{
+    BruThompsonThreadSetEntry entry;
+    size_t                    i, len, pc_idx = thread->pc - self->insts;
+
+    if (pc_idx >= self->sparse_len) {
+        len = self->sparse_len;
+        self->sparse_len = 2 * len > pc_idx ? 2 * len : pc_idx + 1;
+        self->sparse =
+            realloc(self->sparse, sizeof(*self->sparse) * self->sparse_len);
+        memset(self->sparse + len, 0,
+               sizeof(*self->sparse) * (self->sparse_len - len));
+    }
+
+    // chain the entry in front of the other entries with the same PC offset
+    len          = stc_vec_len(self->dense);
+    i            = self->sparse[pc_idx];
+    entry.pc_idx = pc_idx;
+    entry.hash   = thompson_thread_hash(thread, self->ncounters);
+    entry.chain  = i < len && self->dense[i].pc_idx == pc_idx ? i : SIZE_MAX;
+    entry.thread = thread;
+    stc_vec_push_back(self->dense, entry);
+    self->sparse[pc_idx] = len;
+}
+
+static void thompson_thread_set_clear(BruThompsonThreadSet *self)
+{
+    stc_vec_clear(self->dense);
+}
+
+static void thompson_thread_set_free(BruThompsonThreadSet *self)
+{
+    if (self->sparse) free(self->sparse);
+    stc_vec_free(self->dense);
+}
+
 /* --- ThompsonScheduler function definitions ------------------------------- */
 
-static BruThompsonScheduler *thompson_scheduler_new(void)
+static BruThompsonScheduler *thompson_scheduler_new(bru_len_t ncounters)
 {
     BruThompsonScheduler *ts = malloc(sizeof(*ts));
 
     ts->in_lockstep = FALSE;
     stc_vec_default_init(ts->curr); // NOLINT(bugprone-sizeof-expression)
+    ts->head = 0;
     stc_vec_default_init(ts->next); // NOLINT(bugprone-sizeof-expression)
     stc_vec_default_init(ts->sync); // NOLINT(bugprone-sizeof-expression)
+    thompson_thread_set_init(&ts->sync_set, ncounters);
+#ifdef BRU_BENCHMARK
+    ts->max_step_len = 0;
+#endif /* BRU_BENCHMARK */
 
     return ts;
 }
@@ -379,17 +600,22 @@ static BruThompsonScheduler *thompson_scheduler_new(void)
 static int thompson_scheduler_schedule(BruThompsonScheduler *self,
                                        BruThread            *thread)
 {
-    if (thompson_threads_contain(self->sync, thread)) return FALSE;
-
     switch (*thread->pc) {
         case BRU_CHAR:
         case BRU_PRED:
-            if (stc_vec_is_empty(self->next))
+        case BRU_BYTE:
+            // only threads at a CHAR, PRED, or BYTE can be in the sync queue
+            if (thompson_thread_set_contains(&self->sync_set, thread))
+                return FALSE;
+
+            if (stc_vec_is_empty(self->next)) {
+                thompson_thread_set_insert(&self->sync_set, thread);
                 // NOLINTNEXTLINE(bugprone-sizeof-expression)
                 stc_vec_push_back(self->sync, thread);
-            else
+            } else {
                 // NOLINTNEXTLINE(bugprone-sizeof-expression)
                 stc_vec_push_back(self->next, thread);
+            }
             break;
 
         default:
@@ -402,12 +628,13 @@ static int thompson_scheduler_schedule(BruThompsonScheduler *self,
 
 static int thompson_scheduler_done_step(BruThompsonScheduler *self)
 {
-    return stc_vec_is_empty(self->curr) && self->in_lockstep;
+    return thompson_scheduler_curr_is_empty(self) && self->in_lockstep;
 }
 
 static int thompson_scheduler_has_next(BruThompsonScheduler *self)
 {
-    return !(stc_vec_is_empty(self->curr) && stc_vec_is_empty(self->next) &&
+    return !(thompson_scheduler_curr_is_empty(self) &&
+             stc_vec_is_empty(self->next) &&
              stc_vec_is_empty(self->sync));
 }
 
@@ -417,12 +644,20 @@ static BruThread *thompson_scheduler_next(BruThompsonScheduler *self)
     BruThread **tmp;
 
 thompson_scheduler_next_start:
-    if (stc_vec_is_empty(self->curr)) {
+    if (thompson_scheduler_curr_is_empty(self)) {
+        // the popped threads are only discarded once the whole queue is popped
+        stc_vec_clear(self->curr);
+        self->head = 0;
         if (stc_vec_is_empty(self->next)) {
             self->in_lockstep = TRUE;
             tmp               = self->curr;
             self->curr        = self->sync;
             self->sync        = tmp;
+            thompson_thread_set_clear(&self->sync_set);
+#ifdef BRU_BENCHMARK
+            if (stc_vec_len(self->curr) > self->max_step_len)
+                self->max_step_len = stc_vec_len(self->curr);
+#endif /* BRU_BENCHMARK */
         } else {
             self->in_lockstep = FALSE;
             tmp               = self->curr;
@@ -431,13 +666,12 @@ thompson_scheduler_next_start:
         }
     }
 
-    if (!stc_vec_is_empty(self->curr)) {
-        thread = self->curr[0];
-        // NOLINTNEXTLINE(bugprone-sizeof-expression)
-        stc_vec_remove(self->curr, 0);
+    if (!thompson_scheduler_curr_is_empty(self)) {
+        thread = self->curr[self->head++];
         switch (*thread->pc) {
             case BRU_CHAR:
             case BRU_PRED:
+            case BRU_BYTE:
                 if (!self->in_lockstep) {
                     thompson_scheduler_schedule(self, thread);
                     goto thompson_scheduler_next_start;
@@ -451,28 +685,22 @@ thompson_scheduler_next_start:
     return thread;
 }
 
+static int thompson_scheduler_curr_is_empty(BruThompsonScheduler *self)
+{
+    return self->head >= stc_vec_len(self->curr);
+}
+
 static void thompson_scheduler_free(BruThompsonScheduler *self)
 {
     stc_vec_free(self->curr);
     stc_vec_free(self->next);
     stc_vec_free(self->sync);
+    thompson_thread_set_free(&self->sync_set);
     free(self);
 }
 
 /* --- Helper functions ----------------------------------------------------- */
 
-static BruThompsonThread *
-thompson_thread_manager_new_thread(BruThompsonThreadManager *self)
-{
-    BruThompsonThread *tt = malloc(sizeof(*tt));
-
-    stc_slice_init(tt->memory, self->memory_len);
-    stc_slice_init(tt->captures, 2 * self->ncaptures);
-    stc_slice_init(tt->counters, self->ncounters);
-
-    return tt;
-}
-
 static void thompson_thread_manager_copy_thread(BruThompsonThreadManager *self,
                                                 BruThompsonThread        *dst,
                                                 const BruThompsonThread  *src)
@@ -480,8 +708,14 @@ static void thompson_thread_manager_copy_thread(BruThompsonThreadManager *self,
     dst->pc = src->pc;
     dst->sp = src->sp;
     memcpy(dst->memory, src->memory, sizeof(*dst->memory) * self->memory_len);
-    memcpy(dst->captures, src->captures,
-           sizeof(*dst->captures) * 2 * self->ncaptures);
+    if (self->cow) {
+        dst->captures = src->captures;
+        dst->cow      = src->cow;
+        bru_cow_captures_share(dst->cow);
+    } else {
+        memcpy(dst->captures, src->captures,
+               sizeof(*dst->captures) * 2 * self->ncaptures);
+    }
     memcpy(dst->counters, src->counters,
            sizeof(*dst->counters) * self->ncounters);
 }
@@ -492,17 +726,66 @@ thompson_thread_manager_get_thread(BruThompsonThreadManager *self)
     BruThompsonThread *tt =
         (BruThompsonThread *) bru_thread_pool_get_thread(self->pool);
 
-    if (!tt) tt = thompson_thread_manager_new_thread(self);
+    // the captures, memory, and counters are stored contiguously after the
+    // thread in the block from the pool, unless the captures are copy-on-write
+    tt->captures = (const char **) (tt + 1);
+    tt->memory   = (bru_byte_t *) (tt->captures +
+                                 (self->cow ? 0 : 2 * self->ncaptures));
+    tt->counters =
+        (bru_cntr_t *) (tt->memory +
+                        BRU_ALIGN_UP(self->memory_len, sizeof(bru_cntr_t)));
 
     return tt;
 }
 
-static void thompson_thread_free(BruThread *t)
-{
-    BruThompsonThread *tt = (BruThompsonThread *) t;
+static void
+thompson_thread_manager_rebase_thread(BruThompsonThreadManager *self,
+                                      BruThompsonThread        *tt,
+                                      uintptr_t                 delta)
+{
+    const char *sp;
+    bru_len_t   i;
+
+    // every suspended thread waits at the end of the previous chunk
+    assert(tt->sp == self->text_end);
+    tt->sp = (const char *) ((uintptr_t) tt->sp + delta);
+
+    // a shared capture array would otherwise be rebased once per thread
+    if (self->cow) tt->captures = bru_cow_captures_own(self->cow, &tt->cow);
+    for (i = 0; i < 2 * self->ncaptures; i++) {
+        if (!(sp = tt->captures[i])) continue;
+        tt->captures[i] = (const char *) ((uintptr_t) sp + delta);
+    }
 
-    stc_slice_free(tt->memory);
-    stc_slice_free(tt->counters);
-    stc_slice_free(tt->captures);
-    free(tt);
+    // the thread memory only holds the SPs of `epsset` instructions
+    for (i = 0; i + sizeof(sp) <= self->memory_len; i += sizeof(sp)) {
+        memcpy(&sp, tt->memory + i, sizeof(sp));
+        if (!sp) continue;
+        sp = (const char *) ((uintptr_t) sp + delta);
+        memcpy(tt->memory + i, &sp, sizeof(sp));
+    }
 }
+
+/* --- Specialised execution loop ------------------------------------------- */
+
+#define BRU_SRVM_RUN_NAME            thompson_thread_manager_run
+#define BRU_SRVM_RUN_TM              void *
+#define BRU_SRVM_RUN_NEXT_THREAD     thompson_thread_manager_next_thread
+#define BRU_SRVM_RUN_PC              thompson_thread_pc
+#define BRU_SRVM_RUN_SET_PC          thompson_thread_set_pc
+#define BRU_SRVM_RUN_SP              thompson_thread_sp
+#define BRU_SRVM_RUN_INC_SP          thompson_thread_inc_sp
+#define BRU_SRVM_RUN_SCHEDULE        thompson_thread_manager_schedule_thread
+#define BRU_SRVM_RUN_KILL            thompson_thread_manager_kill_thread
+#define BRU_SRVM_RUN_CLONE           thompson_thread_manager_clone_thread
+#define BRU_SRVM_RUN_NOTIFY_MATCH    thompson_thread_manager_notify_thread_match
+#define BRU_SRVM_RUN_CAPTURES        thompson_thread_captures
+#define BRU_SRVM_RUN_SET_CAPTURE     thompson_thread_set_capture
+#define BRU_SRVM_RUN_COUNTER         thompson_thread_counter
+#define BRU_SRVM_RUN_SET_COUNTER     thompson_thread_set_counter
+#define BRU_SRVM_RUN_INC_COUNTER     thompson_thread_inc_counter
+#define BRU_SRVM_RUN_MEMORY          thompson_thread_memory
+#define BRU_SRVM_RUN_SET_MEMORY      thompson_thread_set_memory
+#define BRU_SRVM_RUN_SCHEDULE_IN_ORDER \
+    thompson_thread_manager_schedule_thread_in_order
+#include "../srvm_run.h"
@@ -0,0 +1,270 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../stc/fatp/vec.h"
+
+#include "../../types.h"
+#include "memo_table.h"
+
+#define HASH_CAP_INIT 64
+#define HASH_EMPTY    0
+
+/* --- Type definitions ----------------------------------------------------- */
+
+typedef struct {
+    size_t start; /**< the first visited position of the run                  */
+    size_t end;   /**< one past the last visited position of the run          */
+} BruMemoRun;
+
+struct bru_memo_table {
+    BruMemoTableType type;        /**< the encoding of the table              */
+    size_t           nmemo_insts; /**< number of memoisation instructions     */
+    size_t           npositions;  /**< number of positions in the input       */
+    size_t           peak_memory; /**< peak number of bytes used by the table */
+
+    // BRU_MT_BITSET
+    bru_byte_t *bits;       /**< the bits of the table                        */
+    size_t      bits_alloc; /**< number of bytes allocated for the bits       */
+
+    // BRU_MT_RLE
+    BruMemoRun **runs;       /**< stc_vec of sorted runs per instruction      */
+    size_t       runs_alloc; /**< number of instructions allocated for runs   */
+    size_t       nruns;      /**< total number of runs over all instructions  */
+
+    // BRU_MT_HASH
+    size_t *keys;     /**< open addressing table of keys of visited pairs     */
+    size_t  keys_cap; /**< number of slots in the table of keys (power of 2)  */
+    size_t  nkeys;    /**< number of keys in the table                        */
+};
+
+/* --- Helper function prototypes ------------------------------------------- */
+
+static void   memo_table_update_peak(BruMemoTable *self, size_t memory);
+static int    memo_table_bitset_insert(BruMemoTable *self, size_t i);
+static int    memo_table_rle_insert(BruMemoTable *self, size_t idx, size_t pos);
+static int    memo_table_hash_insert(BruMemoTable *self, size_t key);
+static void   memo_table_hash_grow(BruMemoTable *self);
+static size_t memo_table_hash_slot(size_t key, size_t cap);
+
+/* --- API function definitions --------------------------------------------- */
+
+BruMemoTable *bru_memo_table_new(BruMemoTableType type)
+{
+    BruMemoTable *mt = malloc(sizeof(*mt));
+
+    mt->type        = type;
+    mt->nmemo_insts = 0;
+    mt->npositions  = 0;
+    mt->peak_memory = 0;
+    mt->bits        = NULL;
+    mt->bits_alloc  = 0;
+    mt->runs        = NULL;
+    mt->runs_alloc  = 0;
+    mt->nruns       = 0;
+    mt->keys        = NULL;
+    mt->keys_cap    = 0;
+    mt->nkeys       = 0;
+
+    return mt;
+}
+
+void bru_memo_table_free(BruMemoTable *self)
+{
+    size_t i;
+
+    if (self->bits) free(self->bits);
+    for (i = 0; i < self->runs_alloc; i++) stc_vec_free(self->runs[i]);
+    if (self->runs) free(self->runs);
+    if (self->keys) free(self->keys);
+    free(self);
+}
+
+void bru_memo_table_init(BruMemoTable *self,
+                         size_t        nmemo_insts,
+                         size_t        npositions)
+{
+    size_t i, nbytes;
+
+    self->nmemo_insts = nmemo_insts;
+    self->npositions  = npositions;
+
+    switch (self->type) {
+        case BRU_MT_BITSET:
+            nbytes = (nmemo_insts * npositions + 7) / 8;
+            if (nbytes > self->bits_alloc) {
+                if (self->bits) free(self->bits);
+                self->bits       = malloc(nbytes);
+                self->bits_alloc = nbytes;
+            }
+            memo_table_update_peak(self, nbytes);
+            break;
+
+        case BRU_MT_RLE:
+            if (nmemo_insts > self->runs_alloc) {
+                self->runs =
+                    realloc(self->runs, nmemo_insts * sizeof(*self->runs));
+                for (i = self->runs_alloc; i < nmemo_insts; i++)
+                    stc_vec_default_init(self->runs[i]);
+                self->runs_alloc = nmemo_insts;
+            }
+            break;
+
+        case BRU_MT_HASH:
+            if (self->keys_cap == 0) {
+                self->keys_cap = HASH_CAP_INIT;
+                self->keys     = malloc(self->keys_cap * sizeof(*self->keys));
+                memo_table_update_peak(self,
+                                       self->keys_cap * sizeof(*self->keys));
+            }
+            break;
+    }
+
+    bru_memo_table_clear(self);
+}
+
+void bru_memo_table_clear(BruMemoTable *self)
+{
+    size_t i;
+
+    switch (self->type) {
+        case BRU_MT_BITSET:
+            if (self->bits)
+                memset(self->bits, 0,
+                       (self->nmemo_insts * self->npositions + 7) / 8);
+            break;
+
+        case BRU_MT_RLE:
+            for (i = 0; i < self->nmemo_insts; i++)
+                stc_vec_clear(self->runs[i]);
+            self->nruns = 0;
+            break;
+
+        case BRU_MT_HASH:
+            if (self->keys)
+                memset(self->keys, HASH_EMPTY,
+                       self->keys_cap * sizeof(*self->keys));
+            self->nkeys = 0;
+            break;
+    }
+}
+
+int bru_memo_table_insert(BruMemoTable *self, size_t idx, size_t pos)
+{
+    switch (self->type) {
+        case BRU_MT_BITSET:
+            return memo_table_bitset_insert(self, idx * self->npositions + pos);
+        case BRU_MT_RLE: return memo_table_rle_insert(self, idx, pos);
+        case BRU_MT_HASH:
+            // offset the key by one so that the empty key is never used
+            return memo_table_hash_insert(self,
+                                          idx * self->npositions + pos + 1);
+    }
+
+    return FALSE;
+}
+
+size_t bru_memo_table_memory(const BruMemoTable *self)
+{
+    return self->peak_memory;
+}
+
+/* --- Helper function definitions ------------------------------------------ */
+
+static void memo_table_update_peak(BruMemoTable *self, size_t memory)
+{
+    if (memory > self->peak_memory) self->peak_memory = memory;
+}
+
+static int memo_table_bitset_insert(BruMemoTable *self, size_t i)
+{
+    bru_byte_t mask = 1 << (i % 8);
+
+    if (self->bits[i / 8] & mask) return FALSE;
+    self->bits[i / 8] |= mask;
+
+    return TRUE;
+}
+
+static int memo_table_rle_insert(BruMemoTable *self, size_t idx, size_t pos)
+{
+    BruMemoRun *runs = self->runs[idx];
+    size_t      lo = 0, hi = stc_vec_len(runs), mid;
+    BruMemoRun  run;
+
+    // find the first run starting after the position
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (runs[mid].start <= pos)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo > 0 && pos < runs[lo - 1].end) return FALSE;
+
+    if (lo > 0 && runs[lo - 1].end == pos) {
+        // extend the previous run, merging it with the next run if they meet
+        runs[lo - 1].end++;
+        if (lo < stc_vec_len(runs) && runs[lo].start == pos + 1) {
+            runs[lo - 1].end = runs[lo].end;
+            stc_vec_remove(runs, lo);
+            self->nruns--;
+        }
+    } else if (lo < stc_vec_len(runs) && runs[lo].start == pos + 1) {
+        runs[lo].start = pos;
+    } else {
+        run.start = pos;
+        run.end   = pos + 1;
+        stc_vec_insert(runs, lo, run);
+        self->runs[idx] = runs;
+        self->nruns++;
+        memo_table_update_peak(self, self->nruns * sizeof(run));
+    }
+
+    return TRUE;
+}
+
+static int memo_table_hash_insert(BruMemoTable *self, size_t key)
+{
+    size_t i, mask = self->keys_cap - 1;
+
+    for (i = memo_table_hash_slot(key, self->keys_cap);
+         self->keys[i] != HASH_EMPTY; i = (i + 1) & mask)
+        if (self->keys[i] == key) return FALSE;
+
+    self->keys[i] = key;
+    // keep the load factor at most a half for short probe sequences
+    if (2 * ++self->nkeys > self->keys_cap) memo_table_hash_grow(self);
+
+    return TRUE;
+}
+
+static void memo_table_hash_grow(BruMemoTable *self)
+{
+    size_t *keys = self->keys, cap = self->keys_cap, i, j, mask;
+
+    self->keys_cap = 2 * cap;
+    self->keys     = malloc(self->keys_cap * sizeof(*self->keys));
+    memset(self->keys, HASH_EMPTY, self->keys_cap * sizeof(*self->keys));
+    memo_table_update_peak(self, self->keys_cap * sizeof(*self->keys));
+
+    mask = self->keys_cap - 1;
+    for (i = 0; i < cap; i++) {
+        if (keys[i] == HASH_EMPTY) continue;
+        for (j = memo_table_hash_slot(keys[i], self->keys_cap);
+             self->keys[j] != HASH_EMPTY; j = (j + 1) & mask)
+            ;
+        self->keys[j] = keys[i];
+    }
+    free(keys);
+}
+
+static size_t memo_table_hash_slot(size_t key, size_t cap)
+{
+    // Fibonacci hashing to spread consecutive keys over the table
+    key ^= key >> 16;
+    key *= (size_t) 0x9E3779B97F4A7C15ULL;
+    key ^= key >> 16;
+
+    return key & (cap - 1);
+}
@@ -0,0 +1,100 @@
+#ifndef BRU_VM_THREAD_MANAGER_MEMO_TABLE_H
+#define BRU_VM_THREAD_MANAGER_MEMO_TABLE_H
+
+#include <stddef.h>
+
+/* --- Type definitions ----------------------------------------------------- */
+
+/**
+ * The encodings of the memoisation table that records which (memoisation
+ * instruction, input position) pairs have been visited.
+ */
+typedef enum {
+    BRU_MT_BITSET, /**< dense table with a single bit for each pair           */
+    BRU_MT_RLE,    /**< runs of consecutive visited positions per instruction */
+    BRU_MT_HASH,   /**< hash set of the visited pairs for sparse visits       */
+} BruMemoTableType;
+
+typedef struct bru_memo_table BruMemoTable;
+
+#if !defined(BRU_VM_THREAD_MANAGER_MEMO_TABLE_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_THREAD_MANAGER_MEMO_TABLE_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&                          \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) ||                       \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+typedef BruMemoTableType MemoTableType;
+typedef BruMemoTable     MemoTable;
+
+#    define MT_BITSET BRU_MT_BITSET
+#    define MT_RLE    BRU_MT_RLE
+#    define MT_HASH   BRU_MT_HASH
+
+#    define memo_table_new    bru_memo_table_new
+#    define memo_table_free   bru_memo_table_free
+#    define memo_table_init   bru_memo_table_init
+#    define memo_table_clear  bru_memo_table_clear
+#    define memo_table_insert bru_memo_table_insert
+#    define memo_table_memory bru_memo_table_memory
+#endif /* BRU_VM_THREAD_MANAGER_MEMO_TABLE_ENABLE_SHORT_NAMES */
+
+/* --- API function prototypes ---------------------------------------------- */
+
+/**
+ * Create a new empty memoisation table with the given encoding.
+ *
+ * @param[in] type the encoding of the memoisation table
+ *
+ * @return the memoisation table
+ */
+BruMemoTable *bru_memo_table_new(BruMemoTableType type);
+
+/**
+ * Free the resources used by the memoisation table.
+ *
+ * @param[in] self the memoisation table
+ */
+void bru_memo_table_free(BruMemoTable *self);
+
+/**
+ * Size the memoisation table for the given number of memoisation instructions
+ * and input positions, and clear it.
+ *
+ * Memory allocated by previous initialisations is reused where possible.
+ *
+ * @param[in] self        the memoisation table
+ * @param[in] nmemo_insts the number of memoisation instructions
+ * @param[in] npositions  the number of positions in the input
+ */
+void bru_memo_table_init(BruMemoTable *self,
+                         size_t        nmemo_insts,
+                         size_t        npositions);
+
+/**
+ * Clear all the visited pairs from the memoisation table.
+ *
+ * @param[in] self the memoisation table
+ */
+void bru_memo_table_clear(BruMemoTable *self);
+
+/**
+ * Record a visit of the memoisation instruction at the input position.
+ *
+ * @param[in] self the memoisation table
+ * @param[in] idx  the index of the memoisation instruction
+ * @param[in] pos  the position in the input
+ *
+ * @return truthy value if the pair had not been visited before; else 0
+ */
+int bru_memo_table_insert(BruMemoTable *self, size_t idx, size_t pos);
+
+/**
+ * Get the peak number of bytes used by the memoisation table for recording
+ * visited pairs since its creation.
+ *
+ * @param[in] self the memoisation table
+ *
+ * @return the peak number of bytes used
+ */
+size_t bru_memo_table_memory(const BruMemoTable *self);
+
+#endif /* BRU_VM_THREAD_MANAGER_MEMO_TABLE_H */
@@ -1,12 +1,13 @@
 #include <stdlib.h>
-#include <string.h>
 
+#include "../../utils.h"
 #include "memoisation.h"
 
 typedef struct {
-    bru_byte_t *memoisation_memory; /**< memory used for memoisation          */
-    const char *text;               /**< input string being matched against   */
-    size_t      text_len;           /**< length of the input string           */
+    BruMemoTable *memo_table; /**< table of visited memoisation instructions  */
+    const char   *text;       /**< input string being matched against         */
+    int           benchmark;  /**< whether to log the peak table memory       */
+    FILE         *logfile;    /**< the file for logging output                */
 
     BruThreadManager *__manager; /**< the thread manager being wrapped        */
 } BruMemoisedThreadManager;
@@ -15,10 +16,10 @@ typedef struct {
 
 static void memoised_thread_manager_init(void             *impl,
                                          const bru_byte_t *start_pc,
-                                         const char       *start_sp);
+                                         const char       *start_sp,
+                                         const char       *text_end);
 static void memoised_thread_manager_reset(void *impl);
 static void memoised_thread_manager_free(void *impl);
-static int  memoised_thread_manager_done_exec(void *impl);
 
 static void memoised_thread_manager_schedule_thread(void *impl, BruThread *t);
 static void memoised_thread_manager_schedule_thread_in_order(void      *impl,
@@ -29,15 +30,16 @@ static void       memoised_thread_manager_notify_thread_match(void      *impl,
 static BruThread *memoised_thread_manager_clone_thread(void            *impl,
                                                        const BruThread *t);
 static void       memoised_thread_manager_kill_thread(void *impl, BruThread *t);
-static void       memoised_thread_manager_init_memoisation(void       *impl,
-                                                           size_t      nmemo_insts,
-                                                           const char *text);
+static void memoised_thread_manager_init_memoisation(void       *impl,
+                                                     size_t      nmemo_insts,
+                                                     const char *text,
+                                                     size_t      text_len);
 
 static const bru_byte_t *memoised_thread_pc(void *impl, const BruThread *t);
 static void
 memoised_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc);
 static const char *memoised_thread_sp(void *impl, const BruThread *t);
-static void        memoised_thread_inc_sp(void *impl, BruThread *t);
+static void memoised_thread_inc_sp(void *impl, BruThread *t, size_t nbytes);
 static int memoised_thread_memoise(void *impl, BruThread *t, bru_len_t idx);
 static bru_cntr_t
 memoised_thread_counter(void *impl, const BruThread *t, bru_len_t idx);
@@ -58,21 +60,36 @@ static const char *const *
 memoised_thread_captures(void *impl, const BruThread *t, bru_len_t *ncaptures);
 static void
 memoised_thread_set_capture(void *impl, BruThread *t, bru_len_t idx);
+static int memoised_thread_manager_run(void              *impl,
+                                       const BruProgram  *prog,
+                                       const char        *text,
+                                       const char        *text_end,
+                                       const char       **captures,
+                                       bru_len_t          ncaptures,
+                                       BruMemoTable      *memo_table,
+                                       const char       **matched_sp);
 
 /* --- API function definitions --------------------------------------------- */
 
 BruThreadManager *
-bru_memoised_thread_manager_new(BruThreadManager *thread_manager)
+bru_memoised_thread_manager_new(BruThreadManager *thread_manager,
+                                BruMemoTableType  memo_table,
+                                int               benchmark,
+                                FILE             *logfile)
 {
     BruMemoisedThreadManager *mtm = malloc(sizeof(*mtm));
     BruThreadManager         *tm  = malloc(sizeof(*tm));
 
-    mtm->memoisation_memory = NULL;
-    mtm->text_len           = 0;
-    mtm->text_len           = 0;
-    mtm->__manager          = thread_manager;
+    mtm->memo_table = bru_memo_table_new(memo_table);
+    mtm->text       = NULL;
+    mtm->benchmark  = benchmark;
+    mtm->logfile    = logfile;
+    mtm->__manager  = thread_manager;
 
     BRU_THREAD_MANAGER_SET_ALL_FUNCS(tm, memoised);
+    // only memoisation differs from the wrapped thread manager, so its
+    // specialised execution loop can be used with the memoisation table
+    if (thread_manager->run) tm->run = memoised_thread_manager_run;
     tm->impl = mtm;
 
     return tm;
@@ -82,33 +99,30 @@ bru_memoised_thread_manager_new(BruThreadManager *thread_manager)
 
 static void memoised_thread_manager_init(void             *impl,
                                          const bru_byte_t *start_pc,
-                                         const char       *start_sp)
+                                         const char       *start_sp,
+                                         const char       *text_end)
 {
     bru_thread_manager_init(((BruMemoisedThreadManager *) impl)->__manager,
-                            start_pc, start_sp);
+                            start_pc, start_sp, text_end);
 }
 
 static void memoised_thread_manager_reset(void *impl)
 {
     BruMemoisedThreadManager *self = impl;
     bru_thread_manager_reset(self->__manager);
-    if (self->memoisation_memory)
-        memset(self->memoisation_memory, 0,
-               self->text_len * self->text_len *
-                   sizeof(*self->memoisation_memory));
+    bru_memo_table_clear(self->memo_table);
 }
 
 static void memoised_thread_manager_free(void *impl)
 {
-    free(((BruMemoisedThreadManager *) impl)->memoisation_memory);
-    bru_thread_manager_free(((BruMemoisedThreadManager *) impl)->__manager);
-    free(impl);
-}
+    BruMemoisedThreadManager *self = impl;
 
-static int memoised_thread_manager_done_exec(void *impl)
-{
-    return bru_thread_manager_done_exec(
-        ((BruMemoisedThreadManager *) impl)->__manager);
+    if (self->benchmark)
+        fprintf(self->logfile, "MEMOISATION TABLE PEAK BYTES: %zu\n",
+                bru_memo_table_memory(self->memo_table));
+    bru_memo_table_free(self->memo_table);
+    bru_thread_manager_free(self->__manager);
+    free(impl);
 }
 
 static void memoised_thread_manager_schedule_thread(void *impl, BruThread *t)
@@ -169,37 +183,29 @@ static const char *memoised_thread_sp(void *impl, const BruThread *t)
                                  t);
 }
 
-static void memoised_thread_inc_sp(void *impl, BruThread *t)
+static void memoised_thread_inc_sp(void *impl, BruThread *t, size_t nbytes)
 {
     bru_thread_manager_inc_sp(((BruMemoisedThreadManager *) impl)->__manager,
-                              t);
+                              t, nbytes);
 }
 
 static void memoised_thread_manager_init_memoisation(void       *impl,
                                                      size_t      nmemo_insts,
-                                                     const char *text)
+                                                     const char *text,
+                                                     size_t      text_len)
 {
     BruMemoisedThreadManager *self = impl;
 
-    if (self->memoisation_memory) free(self->memoisation_memory);
-
-    self->text               = text;
-    self->text_len           = strlen(text) + 1;
-    self->memoisation_memory = malloc(nmemo_insts * self->text_len *
-                                      sizeof(*self->memoisation_memory));
-    memset(self->memoisation_memory, FALSE,
-           nmemo_insts * self->text_len * sizeof(*self->memoisation_memory));
+    // a thread can be at any of the `text_len + 1` positions in the input
+    self->text = text;
+    bru_memo_table_init(self->memo_table, nmemo_insts, text_len + 1);
 }
 
 static int memoised_thread_memoise(void *impl, BruThread *t, bru_len_t idx)
 {
     BruMemoisedThreadManager *self = impl;
-    size_t                    i = idx * self->text_len + (t->sp - self->text);
-
-    if (self->memoisation_memory[i]) return FALSE;
-    self->memoisation_memory[i] = TRUE;
 
-    return TRUE;
+    return bru_memo_table_insert(self->memo_table, idx, t->sp - self->text);
 }
 
 static bru_cntr_t
@@ -253,3 +259,21 @@ static void memoised_thread_set_capture(void *impl, BruThread *t, bru_len_t idx)
     bru_thread_manager_set_capture(
         ((BruMemoisedThreadManager *) impl)->__manager, t, idx);
 }
+
+static int memoised_thread_manager_run(void              *impl,
+                                       const BruProgram  *prog,
+                                       const char        *text,
+                                       const char        *text_end,
+                                       const char       **captures,
+                                       bru_len_t          ncaptures,
+                                       BruMemoTable      *memo_table,
+                                       const char       **matched_sp)
+{
+    BruMemoisedThreadManager *self = impl;
+
+    BRU_UNUSED(memo_table);
+
+    return bru_thread_manager_run(self->__manager, prog, text, text_end,
+                                  captures, ncaptures, self->memo_table,
+                                  matched_sp);
+}
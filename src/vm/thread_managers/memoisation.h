@@ -1,6 +1,9 @@
 #ifndef BRU_VM_THREAD_MANAGER_MEMOISATION_H
 #define BRU_VM_THREAD_MANAGER_MEMOISATION_H
 
+#include <stdio.h>
+
+#include "memo_table.h"
 #include "thread_manager.h"
 
 #if !defined(BRU_VM_THREAD_MANAGER_MEMOISATION_DISABLE_SHORT_NAMES) && \
@@ -16,10 +19,17 @@
  * thread manager.
  *
  * @param[in] thread_manager the underlying thread manager
+ * @param[in] memo_table     the encoding of the memoisation table
+ * @param[in] benchmark      whether to log the peak memory of the
+ *                           memoisation table when freed
+ * @param[in] logfile        the file for logging output
  *
  * @return the constructed memoised thread manager
  */
 BruThreadManager *
-bru_memoised_thread_manager_new(BruThreadManager *thread_manager);
+bru_memoised_thread_manager_new(BruThreadManager *thread_manager,
+                                BruMemoTableType  memo_table,
+                                int               benchmark,
+                                FILE             *logfile);
 
 #endif /* BRU_VM_THREAD_MANAGER_MEMOISATION_H */
@@ -0,0 +1,263 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "set_matches.h"
+
+typedef struct {
+    const bru_byte_t *matches;  /**< the first of the `match` instructions    */
+    size_t            nmatches; /**< the number of `match` instructions       */
+    bru_byte_t       *matched;  /**< flags of which matches were reached      */
+    size_t            nmatched; /**< the number of flags set in `matched`     */
+
+    BruThreadManager *__manager; /**< the thread manager being wrapped        */
+} BruSetMatchesThreadManager;
+
+/* --- SetMatchesThreadManager function prototypes -------------------------- */
+
+static void set_matches_thread_manager_init(void             *impl,
+                                            const bru_byte_t *start_pc,
+                                            const char       *start_sp,
+                                            const char       *text_end);
+static void set_matches_thread_manager_reset(void *impl);
+static void set_matches_thread_manager_free(void *impl);
+
+static void set_matches_thread_manager_schedule_thread(void      *impl,
+                                                       BruThread *t);
+static void set_matches_thread_manager_schedule_thread_in_order(void      *impl,
+                                                                BruThread *t);
+static BruThread *set_matches_thread_manager_next_thread(void *impl);
+static void
+set_matches_thread_manager_notify_thread_match(void *impl, BruThread *t);
+static BruThread *set_matches_thread_manager_clone_thread(void            *impl,
+                                                          const BruThread *t);
+static void set_matches_thread_manager_kill_thread(void *impl, BruThread *t);
+static void set_matches_thread_manager_init_memoisation(void       *impl,
+                                                        size_t      nmemo_insts,
+                                                        const char *text,
+                                                        size_t      text_len);
+
+static const bru_byte_t *set_matches_thread_pc(void *impl, const BruThread *t);
+static void
+set_matches_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc);
+static const char *set_matches_thread_sp(void *impl, const BruThread *t);
+static void set_matches_thread_inc_sp(void *impl, BruThread *t, size_t nbytes);
+static int set_matches_thread_memoise(void *impl, BruThread *t, bru_len_t idx);
+static bru_cntr_t
+set_matches_thread_counter(void *impl, const BruThread *t, bru_len_t idx);
+static void set_matches_thread_set_counter(void      *impl,
+                                           BruThread *t,
+                                           bru_len_t  idx,
+                                           bru_cntr_t val);
+static void
+set_matches_thread_inc_counter(void *impl, BruThread *t, bru_len_t idx);
+static void *
+set_matches_thread_memory(void *impl, const BruThread *t, bru_len_t idx);
+static void               set_matches_thread_set_memory(void       *impl,
+                                                        BruThread  *t,
+                                                        bru_len_t   idx,
+                                                        const void *val,
+                                                        size_t      size);
+static const char *const *set_matches_thread_captures(void            *impl,
+                                                      const BruThread *t,
+                                                      bru_len_t *ncaptures);
+static void
+set_matches_thread_set_capture(void *impl, BruThread *t, bru_len_t idx);
+
+/* --- API function definitions --------------------------------------------- */
+
+BruThreadManager *
+bru_set_matches_thread_manager_new(BruThreadManager *thread_manager,
+                                   const bru_byte_t *matches,
+                                   size_t            nmatches,
+                                   bru_byte_t       *matched)
+{
+    BruSetMatchesThreadManager *smtm = malloc(sizeof(*smtm));
+    BruThreadManager           *tm   = malloc(sizeof(*tm));
+
+    smtm->matches   = matches;
+    smtm->nmatches  = nmatches;
+    smtm->matched   = matched;
+    smtm->nmatched  = 0;
+    smtm->__manager = thread_manager;
+
+    BRU_THREAD_MANAGER_SET_ALL_FUNCS(tm, set_matches);
+    tm->impl = smtm;
+
+    return tm;
+}
+
+/* --- SetMatchesThreadManager function definitions ------------------------- */
+
+static void set_matches_thread_manager_init(void             *impl,
+                                            const bru_byte_t *start_pc,
+                                            const char       *start_sp,
+                                            const char       *text_end)
+{
+    BruSetMatchesThreadManager *self = impl;
+
+    memset(self->matched, 0, self->nmatches * sizeof(*self->matched));
+    self->nmatched = 0;
+    bru_thread_manager_init(self->__manager, start_pc, start_sp, text_end);
+}
+
+static void set_matches_thread_manager_reset(void *impl)
+{
+    BruSetMatchesThreadManager *self = impl;
+    bru_thread_manager_reset(self->__manager);
+}
+
+static void set_matches_thread_manager_free(void *impl)
+{
+    BruSetMatchesThreadManager *self = impl;
+    bru_thread_manager_free(self->__manager);
+    free(impl);
+}
+
+static void set_matches_thread_manager_schedule_thread(void *impl, BruThread *t)
+{
+    bru_thread_manager_schedule_thread(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t);
+}
+
+static void set_matches_thread_manager_schedule_thread_in_order(void      *impl,
+                                                                BruThread *t)
+{
+    bru_thread_manager_schedule_thread_in_order(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t);
+}
+
+static BruThread *set_matches_thread_manager_next_thread(void *impl)
+{
+    BruSetMatchesThreadManager *self = impl;
+
+    // the remaining threads cannot change the result, and are killed when the
+    // underlying thread manager is reset
+    if (self->nmatched == self->nmatches) return NULL;
+
+    return bru_thread_manager_next_thread(self->__manager);
+}
+
+static void set_matches_thread_manager_notify_thread_match(void      *impl,
+                                                           BruThread *t)
+{
+    BruSetMatchesThreadManager *self = impl;
+    size_t                      idx;
+
+    idx = bru_thread_manager_pc(self->__manager, t) - self->matches;
+    if (idx < self->nmatches && !self->matched[idx]) {
+        self->matched[idx] = TRUE;
+        self->nmatched++;
+    }
+
+    // the threads of lower priority may still reach other matches
+    bru_thread_manager_kill_thread(self->__manager, t);
+}
+
+static BruThread *set_matches_thread_manager_clone_thread(void            *impl,
+                                                          const BruThread *t)
+{
+    return bru_thread_manager_clone_thread(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t);
+}
+
+static void set_matches_thread_manager_kill_thread(void *impl, BruThread *t)
+{
+    BruSetMatchesThreadManager *self = impl;
+    bru_thread_manager_kill_thread(self->__manager, t);
+}
+
+static const bru_byte_t *set_matches_thread_pc(void *impl, const BruThread *t)
+{
+    return bru_thread_manager_pc(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t);
+}
+
+static void
+set_matches_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc)
+{
+    bru_thread_manager_set_pc(((BruSetMatchesThreadManager *) impl)->__manager,
+                              t, pc);
+}
+
+static const char *set_matches_thread_sp(void *impl, const BruThread *t)
+{
+    return bru_thread_manager_sp(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t);
+}
+
+static void set_matches_thread_inc_sp(void *impl, BruThread *t, size_t nbytes)
+{
+    bru_thread_manager_inc_sp(((BruSetMatchesThreadManager *) impl)->__manager,
+                              t, nbytes);
+}
+
+static void set_matches_thread_manager_init_memoisation(void       *impl,
+                                                        size_t      nmemo_insts,
+                                                        const char *text,
+                                                        size_t      text_len)
+{
+    bru_thread_manager_init_memoisation(
+        ((BruSetMatchesThreadManager *) impl)->__manager, nmemo_insts, text,
+        text_len);
+}
+
+static int set_matches_thread_memoise(void *impl, BruThread *t, bru_len_t idx)
+{
+    return bru_thread_manager_memoise(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, idx);
+}
+
+static bru_cntr_t
+set_matches_thread_counter(void *impl, const BruThread *t, bru_len_t idx)
+{
+    return bru_thread_manager_counter(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, idx);
+}
+
+static void set_matches_thread_set_counter(void      *impl,
+                                           BruThread *t,
+                                           bru_len_t  idx,
+                                           bru_cntr_t val)
+{
+    bru_thread_manager_set_counter(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, idx, val);
+}
+
+static void
+set_matches_thread_inc_counter(void *impl, BruThread *t, bru_len_t idx)
+{
+    bru_thread_manager_inc_counter(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, idx);
+}
+
+static void *
+set_matches_thread_memory(void *impl, const BruThread *t, bru_len_t idx)
+{
+    return bru_thread_manager_memory(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, idx);
+}
+
+static void set_matches_thread_set_memory(void       *impl,
+                                          BruThread  *t,
+                                          bru_len_t   idx,
+                                          const void *val,
+                                          size_t      size)
+{
+    bru_thread_manager_set_memory(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, idx, val, size);
+}
+
+static const char *const *set_matches_thread_captures(void            *impl,
+                                                      const BruThread *t,
+                                                      bru_len_t *ncaptures)
+{
+    return bru_thread_manager_captures(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, ncaptures);
+}
+
+static void
+set_matches_thread_set_capture(void *impl, BruThread *t, bru_len_t idx)
+{
+    bru_thread_manager_set_capture(
+        ((BruSetMatchesThreadManager *) impl)->__manager, t, idx);
+}
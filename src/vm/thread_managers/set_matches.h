@@ -0,0 +1,41 @@
+#ifndef BRU_VM_THREAD_MANAGER_SET_MATCHES_H
+#define BRU_VM_THREAD_MANAGER_SET_MATCHES_H
+
+#include <stddef.h>
+
+#include "thread_manager.h"
+
+#if !defined(BRU_VM_THREAD_MANAGER_SET_MATCHES_DISABLE_SHORT_NAMES) && \
+    (defined(BRU_VM_THREAD_MANAGER_SET_MATCHES_ENABLE_SHORT_NAMES) ||  \
+     !defined(BRU_VM_DISABLE_SHORT_NAMES) &&                           \
+         (defined(BRU_VM_ENABLE_SHORT_NAMES) ||                        \
+          defined(BRU_ENABLE_SHORT_NAMES)))
+#    define set_matches_thread_manager_new bru_set_matches_thread_manager_new
+#endif /* BRU_VM_THREAD_MANAGER_SET_MATCHES_ENABLE_SHORT_NAMES */
+
+/**
+ * Construct a thread manager that records which of several `match`
+ * instructions the threads of the underlying thread manager reach.
+ *
+ * The `match` instructions must be consecutive in the program, starting at
+ * `matches`, so that the thread reaching the instruction at `matches + i`
+ * marks `matched[i]`. A match only kills the matching thread instead of all
+ * threads of lower priority, and execution stops as soon as every `match`
+ * instruction has been reached. The flags are cleared whenever the thread
+ * manager is initialised.
+ *
+ * @param[in] thread_manager the underlying thread manager
+ * @param[in] matches        the first of the consecutive `match` instructions
+ * @param[in] nmatches       the number of consecutive `match` instructions
+ * @param[in] matched        the flags of which `match` instructions were
+ *                           reached, of length `nmatches`
+ *
+ * @return the constructed set matches thread manager
+ */
+BruThreadManager *
+bru_set_matches_thread_manager_new(BruThreadManager *thread_manager,
+                                   const bru_byte_t *matches,
+                                   size_t            nmatches,
+                                   bru_byte_t       *matched);
+
+#endif /* BRU_VM_THREAD_MANAGER_SET_MATCHES_H */
@@ -1,10 +1,10 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include "../../stc/fatp/slice.h"
 #include "../../stc/fatp/vec.h"
 
 #include "../../utils.h"
+#include "cow_captures.h"
 #include "spencer.h"
 #include "thread_manager.h"
 #include "thread_pool.h"
@@ -14,9 +14,10 @@
 typedef struct bru_spencer_thread {
     const bru_byte_t *pc;
     const char       *sp;
-    bru_cntr_t       *counters; /**< stc_slice of counter values              */
-    bru_byte_t       *memory;   /**< stc_slice for general memory             */
-    const char      **captures; /**< stc_slice of capture SPs                 */
+    bru_cntr_t       *counters; /**< counter values stored after the thread   */
+    bru_byte_t       *memory;   /**< general memory stored after the thread   */
+    const char      **captures; /**< capture SPs stored after the thread      */
+    BruCowCaptures   *cow;      /**< the captures if copy-on-write, else NULL */
 } BruSpencerThread;
 
 typedef struct bru_spencer_scheduler {
@@ -28,7 +29,7 @@ typedef struct bru_spencer_scheduler {
 typedef struct bru_spencer_thread_manager {
     BruSpencerScheduler *scheduler; /**< the Spencer scheduler for scheduling */
     BruThreadPool       *pool;      /**< the pool of threads                  */
-    const char          *sp;        /**< the string pointer for the manager   */
+    BruCowCapturesPool  *cow;       /**< pool of shared captures, or NULL     */
 
     // for spawning threads
     bru_len_t ncounters;  /**< number of counter values to spawn threads with */
@@ -40,10 +41,10 @@ typedef struct bru_spencer_thread_manager {
 
 static void spencer_thread_manager_init(void             *impl,
                                         const bru_byte_t *start_pc,
-                                        const char       *start_sp);
+                                        const char       *start_sp,
+                                        const char       *text_end);
 static void spencer_thread_manager_reset(void *impl);
 static void spencer_thread_manager_free(void *impl);
-static int  spencer_thread_manager_done_exec(void *impl);
 
 static void spencer_thread_manager_schedule_thread(void *impl, BruThread *t);
 static void spencer_thread_manager_schedule_thread_in_order(void      *impl,
@@ -58,7 +59,7 @@ static const bru_byte_t *spencer_thread_pc(void *impl, const BruThread *t);
 static void
 spencer_thread_set_pc(void *impl, BruThread *t, const bru_byte_t *pc);
 static const char *spencer_thread_sp(void *impl, const BruThread *t);
-static void        spencer_thread_inc_sp(void *impl, BruThread *t);
+static void spencer_thread_inc_sp(void *impl, BruThread *t, size_t nbytes);
 static bru_cntr_t
 spencer_thread_counter(void *impl, const BruThread *t, bru_len_t idx);
 static void spencer_thread_set_counter(void      *impl,
@@ -76,6 +77,14 @@ static void spencer_thread_set_memory(void       *impl,
 static const char *const *
 spencer_thread_captures(void *impl, const BruThread *t, bru_len_t *ncaptures);
 static void spencer_thread_set_capture(void *impl, BruThread *t, bru_len_t idx);
+static int spencer_thread_manager_run(void              *impl,
+                                      const BruProgram  *prog,
+                                      const char        *text,
+                                      const char        *text_end,
+                                      const char       **captures,
+                                      bru_len_t          ncaptures,
+                                      BruMemoTable      *memo_table,
+                                      const char       **matched_sp);
 
 /* --- Scheduler function prototypes ---------------------------------------- */
 
@@ -89,14 +98,16 @@ static void       spencer_scheduler_free(BruSpencerScheduler *self);
 
 /* --- Helper function prototypes ------------------------------------------- */
 
-static BruSpencerThread             *
-spencer_thread_manager_new_thread(BruSpencerThreadManager *self);
 static void spencer_thread_manager_copy_thread(BruSpencerThreadManager *self,
                                                BruSpencerThread        *dst,
                                                const BruSpencerThread  *src);
 static BruSpencerThread             *
 spencer_thread_manager_get_thread(BruSpencerThreadManager *self);
-static void spencer_thread_free(BruThread *t);
+static BruThreadManager *spencer_thread_manager_create(bru_len_t ncounters,
+                                                       bru_len_t memory_len,
+                                                       bru_len_t ncaptures,
+                                                       int       cow,
+                                                       FILE     *logfile);
 
 /* --- SpencerThreadManager function definitions ---------------------------- */
 
@@ -104,15 +115,42 @@ BruThreadManager *bru_spencer_thread_manager_new(bru_len_t ncounters,
                                                  bru_len_t memory_len,
                                                  bru_len_t ncaptures,
                                                  FILE     *logfile)
+{
+    return spencer_thread_manager_create(ncounters, memory_len, ncaptures,
+                                         FALSE, logfile);
+}
+
+BruThreadManager *bru_spencer_cow_thread_manager_new(bru_len_t ncounters,
+                                                     bru_len_t memory_len,
+                                                     bru_len_t ncaptures,
+                                                     FILE     *logfile)
+{
+    return spencer_thread_manager_create(ncounters, memory_len, ncaptures,
+                                         TRUE, logfile);
+}
+
+static BruThreadManager *spencer_thread_manager_create(bru_len_t ncounters,
+                                                       bru_len_t memory_len,
+                                                       bru_len_t ncaptures,
+                                                       int       cow,
+                                                       FILE     *logfile)
 {
     BruThreadManager        *tm  = malloc(sizeof(*tm));
     BruSpencerThreadManager *stm = malloc(sizeof(*stm));
 
     stm->scheduler  = spencer_scheduler_new();
-    stm->pool       = bru_thread_pool_new(logfile);
     stm->ncounters  = ncounters;
     stm->memory_len = memory_len;
     stm->ncaptures  = ncaptures;
+    stm->cow        = NULL;
+    if (cow) stm->cow = bru_cow_captures_pool_new(ncaptures, logfile);
+    // copy-on-write captures are not stored after the thread
+    stm->pool = bru_thread_pool_new(
+        sizeof(BruSpencerThread) +
+            (cow ? 0 : sizeof(const char *) * 2 * ncaptures) +
+            BRU_ALIGN_UP(memory_len, sizeof(bru_cntr_t)) +
+            sizeof(bru_cntr_t) * ncounters,
+        logfile);
 
     BRU_THREAD_MANAGER_SET_REQUIRED_FUNCS(tm, spencer);
 
@@ -129,6 +167,7 @@ BruThreadManager *bru_spencer_thread_manager_new(bru_len_t ncounters,
     tm->init_memoisation = bru_thread_manager_init_memoisation_noop;
     tm->memoise          = bru_thread_manager_memoise_noop;
 
+    tm->run  = spencer_thread_manager_run;
     tm->impl = stm;
 
     return tm;
@@ -136,19 +175,23 @@ BruThreadManager *bru_spencer_thread_manager_new(bru_len_t ncounters,
 
 static void spencer_thread_manager_init(void             *impl,
                                         const bru_byte_t *start_pc,
-                                        const char       *start_sp)
+                                        const char       *start_sp,
+                                        const char       *text_end)
 {
     BruSpencerThreadManager *self = impl;
     BruSpencerThread        *st   = spencer_thread_manager_get_thread(self);
 
-    self->sp = start_sp;
+    BRU_UNUSED(text_end);
 
     st->pc = start_pc;
     st->sp = start_sp;
 
     memset(st->counters, 0, sizeof(*st->counters) * self->ncounters);
     memset(st->memory, 0, sizeof(*st->memory) * self->memory_len);
-    memset(st->captures, 0, sizeof(*st->captures) * 2 * self->ncaptures);
+    if (self->cow)
+        st->captures = bru_cow_captures_new(self->cow, &st->cow);
+    else
+        memset(st->captures, 0, sizeof(*st->captures) * 2 * self->ncaptures);
 
     spencer_thread_manager_schedule_thread(impl, (BruThread *) st);
 }
@@ -169,15 +212,11 @@ static void spencer_thread_manager_free(void *impl)
 
     spencer_thread_manager_reset(impl);
     spencer_scheduler_free(self->scheduler);
-    bru_thread_pool_free(self->pool, spencer_thread_free);
+    bru_thread_pool_free(self->pool);
+    if (self->cow) bru_cow_captures_pool_free(self->cow);
     free(impl);
 }
 
-static int spencer_thread_manager_done_exec(void *impl)
-{
-    return *((BruSpencerThreadManager *) impl)->sp == '\0';
-}
-
 static void spencer_thread_manager_schedule_thread(void *impl, BruThread *t)
 {
     spencer_scheduler_schedule(((BruSpencerThreadManager *) impl)->scheduler,
@@ -217,7 +256,11 @@ static BruThread *spencer_thread_manager_clone_thread(void            *impl,
 
 static void spencer_thread_manager_kill_thread(void *impl, BruThread *t)
 {
-    bru_thread_pool_add_thread(((BruSpencerThreadManager *) impl)->pool, t);
+    BruSpencerThreadManager *self = impl;
+
+    if (t && self->cow)
+        bru_cow_captures_release(self->cow, ((BruSpencerThread *) t)->cow);
+    bru_thread_pool_add_thread(self->pool, t);
 }
 
 static const bru_byte_t *spencer_thread_pc(void *impl, const BruThread *t)
@@ -239,10 +282,10 @@ static const char *spencer_thread_sp(void *impl, const BruThread *t)
     return t->sp;
 }
 
-static void spencer_thread_inc_sp(void *impl, BruThread *t)
+static void spencer_thread_inc_sp(void *impl, BruThread *t, size_t nbytes)
 {
     BRU_UNUSED(impl);
-    t->sp = stc_utf8_str_next(t->sp);
+    t->sp += nbytes;
 }
 
 static bru_cntr_t
@@ -287,16 +330,17 @@ static void spencer_thread_set_memory(void       *self,
 static const char *const *
 spencer_thread_captures(void *impl, const BruThread *t, bru_len_t *ncaptures)
 {
-    BRU_UNUSED(impl);
-    if (ncaptures)
-        *ncaptures = stc_slice_len(((BruSpencerThread *) t)->captures) / 2;
+    if (ncaptures) *ncaptures = ((BruSpencerThreadManager *) impl)->ncaptures;
     return ((BruSpencerThread *) t)->captures;
 }
 
 static void spencer_thread_set_capture(void *impl, BruThread *t, bru_len_t idx)
 {
-    BRU_UNUSED(impl);
-    ((BruSpencerThread *) t)->captures[idx] = ((BruSpencerThread *) t)->sp;
+    BruSpencerThreadManager *self = impl;
+    BruSpencerThread        *st   = (BruSpencerThread *) t;
+
+    if (self->cow) st->captures = bru_cow_captures_own(self->cow, &st->cow);
+    st->captures[idx] = st->sp;
 }
 
 /* --- SpencerScheduler function definitions -------------------------------- */
@@ -360,18 +404,6 @@ static void spencer_scheduler_free(BruSpencerScheduler *self)
 
 /* --- Helper functions ----------------------------------------------------- */
 
-static BruSpencerThread *
-spencer_thread_manager_new_thread(BruSpencerThreadManager *self)
-{
-    BruSpencerThread *st = malloc(sizeof(*st));
-
-    stc_slice_init(st->memory, self->memory_len);
-    stc_slice_init(st->captures, 2 * self->ncaptures);
-    stc_slice_init(st->counters, self->ncounters);
-
-    return st;
-}
-
 static void spencer_thread_manager_copy_thread(BruSpencerThreadManager *self,
                                                BruSpencerThread        *dst,
                                                const BruSpencerThread  *src)
@@ -379,8 +411,14 @@ static void spencer_thread_manager_copy_thread(BruSpencerThreadManager *self,
     dst->pc = src->pc;
     dst->sp = src->sp;
     memcpy(dst->memory, src->memory, sizeof(*dst->memory) * self->memory_len);
-    memcpy(dst->captures, src->captures,
-           sizeof(*dst->captures) * 2 * self->ncaptures);
+    if (self->cow) {
+        dst->captures = src->captures;
+        dst->cow      = src->cow;
+        bru_cow_captures_share(dst->cow);
+    } else {
+        memcpy(dst->captures, src->captures,
+               sizeof(*dst->captures) * 2 * self->ncaptures);
+    }
     memcpy(dst->counters, src->counters,
            sizeof(*dst->counters) * self->ncounters);
 }
@@ -391,17 +429,38 @@ spencer_thread_manager_get_thread(BruSpencerThreadManager *self)
     BruSpencerThread *st =
         (BruSpencerThread *) bru_thread_pool_get_thread(self->pool);
 
-    if (!st) st = spencer_thread_manager_new_thread(self);
+    // the captures, memory, and counters are stored contiguously after the
+    // thread in the block from the pool, unless the captures are copy-on-write
+    st->captures = (const char **) (st + 1);
+    st->memory   = (bru_byte_t *) (st->captures +
+                                 (self->cow ? 0 : 2 * self->ncaptures));
+    st->counters =
+        (bru_cntr_t *) (st->memory +
+                        BRU_ALIGN_UP(self->memory_len, sizeof(bru_cntr_t)));
 
     return st;
 }
 
-static void spencer_thread_free(BruThread *t)
-{
-    BruSpencerThread *st = (BruSpencerThread *) t;
-
-    stc_slice_free(st->memory);
-    stc_slice_free(st->counters);
-    stc_slice_free(st->captures);
-    free(st);
-}
+/* --- Specialised execution loop ------------------------------------------- */
+
+#define BRU_SRVM_RUN_NAME            spencer_thread_manager_run
+#define BRU_SRVM_RUN_TM              void *
+#define BRU_SRVM_RUN_NEXT_THREAD     spencer_thread_manager_next_thread
+#define BRU_SRVM_RUN_PC              spencer_thread_pc
+#define BRU_SRVM_RUN_SET_PC          spencer_thread_set_pc
+#define BRU_SRVM_RUN_SP              spencer_thread_sp
+#define BRU_SRVM_RUN_INC_SP          spencer_thread_inc_sp
+#define BRU_SRVM_RUN_SCHEDULE        spencer_thread_manager_schedule_thread
+#define BRU_SRVM_RUN_KILL            spencer_thread_manager_kill_thread
+#define BRU_SRVM_RUN_CLONE           spencer_thread_manager_clone_thread
+#define BRU_SRVM_RUN_NOTIFY_MATCH    spencer_thread_manager_notify_thread_match
+#define BRU_SRVM_RUN_CAPTURES        spencer_thread_captures
+#define BRU_SRVM_RUN_SET_CAPTURE     spencer_thread_set_capture
+#define BRU_SRVM_RUN_COUNTER         spencer_thread_counter
+#define BRU_SRVM_RUN_SET_COUNTER     spencer_thread_set_counter
+#define BRU_SRVM_RUN_INC_COUNTER     spencer_thread_inc_counter
+#define BRU_SRVM_RUN_MEMORY          spencer_thread_memory
+#define BRU_SRVM_RUN_SET_MEMORY      spencer_thread_set_memory
+#define BRU_SRVM_RUN_SCHEDULE_IN_ORDER \
+    spencer_thread_manager_schedule_thread_in_order
+#include "../srvm_run.h"
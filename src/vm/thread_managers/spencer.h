@@ -11,7 +11,8 @@
      !defined(BRU_VM_DISABLE_SHORT_NAMES) &&                       \
          (defined(BRU_VM_ENABLE_SHORT_NAMES) ||                    \
           defined(BRU_ENABLE_SHORT_NAMES)))
-#    define spencer_thread_manager_new bru_spencer_thread_manager_new
+#    define spencer_thread_manager_new     bru_spencer_thread_manager_new
+#    define spencer_cow_thread_manager_new bru_spencer_cow_thread_manager_new
 #endif /* BRU_VM_THREAD_MANAGER_SPENCER_ENABLE_SHORT_NAMES */
 
 /* --- Spencer ThreadManager function prototypes ---------------------------- */
@@ -31,4 +32,24 @@ BruThreadManager *bru_spencer_thread_manager_new(bru_len_t ncounters,
                                                  bru_len_t ncaptures,
                                                  FILE     *logfile);
 
+/**
+ * Construct a thread manager that performs Spencer-style regex matching, where
+ * cloned threads share their captures until one of them sets a capture.
+ *
+ * Cloning a thread then takes constant time in the number of captures, which
+ * pays off for programs with many capture groups that split often.
+ *
+ * @param[in] ncounters  the number of counters needed
+ * @param[in] memory_len the number of bytes to allocate for thread memory
+ * @param[in] ncaptures  the number of captures needed
+ * @param[in] logfile    the file for logging output
+ *
+ * @return the constructed Spencer-style thread manager with copy-on-write
+ *         captures
+ */
+BruThreadManager *bru_spencer_cow_thread_manager_new(bru_len_t ncounters,
+                                                     bru_len_t memory_len,
+                                                     bru_len_t ncaptures,
+                                                     FILE     *logfile);
+
 #endif /* BRU_VM_THREAD_MANAGER_SPENCER_H */
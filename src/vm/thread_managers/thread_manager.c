@@ -5,11 +5,13 @@
 
 void bru_thread_manager_init_memoisation_noop(void       *thread_manager_impl,
                                               size_t      nmemo_insts,
-                                              const char *text)
+                                              const char *text,
+                                              size_t      text_len)
 {
     BRU_UNUSED(thread_manager_impl);
     BRU_UNUSED(nmemo_insts);
     BRU_UNUSED(text);
+    BRU_UNUSED(text_len);
 }
 
 int bru_thread_manager_memoise_noop(void      *thread_manager_impl,
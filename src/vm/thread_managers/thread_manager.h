@@ -21,19 +21,18 @@
 
 #include "../../types.h"
 #include "../program.h"
+#include "memo_table.h"
 
 /* --- Preprocessor directives ---------------------------------------------- */
 
-#define bru_thread_manager_init(manager, start_pc, start_sp) \
-    (manager)->init((manager)->impl, (start_pc), (start_sp))
+#define bru_thread_manager_init(manager, start_pc, start_sp, text_end) \
+    (manager)->init((manager)->impl, (start_pc), (start_sp), (text_end))
 #define bru_thread_manager_reset(manager) (manager)->reset((manager)->impl)
 #define bru_thread_manager_free(manager)  \
     do {                                  \
         (manager)->free((manager)->impl); \
         free((manager));                  \
     } while (0)
-#define bru_thread_manager_done_exec(manager) \
-    (manager)->done_exec((manager)->impl)
 
 #define bru_thread_manager_schedule_thread(manager, thread) \
     (manager)->schedule_thread((manager)->impl, (thread))
@@ -54,11 +53,11 @@
     (manager)->set_pc((manager)->impl, (thread), (pc))
 #define bru_thread_manager_sp(manager, thread) \
     (manager)->sp((manager)->impl, (thread))
-#define bru_thread_manager_inc_sp(manager, thread) \
-    (manager)->inc_sp((manager)->impl, (thread))
+#define bru_thread_manager_inc_sp(manager, thread, nbytes) \
+    (manager)->inc_sp((manager)->impl, (thread), (nbytes))
 
-#define bru_thread_manager_init_memoisation(manager, nmemo, text_len) \
-    (manager)->init_memoisation((manager)->impl, (nmemo), (text_len));
+#define bru_thread_manager_init_memoisation(manager, nmemo, text, text_len) \
+    (manager)->init_memoisation((manager)->impl, (nmemo), (text), (text_len))
 #define bru_thread_manager_memoise(manager, thread, idx) \
     (manager)->memoise((manager)->impl, (thread), (idx))
 #define bru_thread_manager_counter(manager, thread, idx) \
@@ -76,12 +75,18 @@
 #define bru_thread_manager_set_capture(manager, thread, idx) \
     (manager)->set_capture((manager)->impl, (thread), (idx))
 
+#define bru_thread_manager_run(manager, prog, text, text_end, captures,    \
+                               ncaptures, memo_table, matched_sp)          \
+    (manager)->run((manager)->impl, (prog), (text), (text_end), (captures), \
+                   (ncaptures), (memo_table), (matched_sp))
+#define bru_thread_manager_stream(manager, chunk, chunk_end, more) \
+    (manager)->stream((manager)->impl, (chunk), (chunk_end), (more))
+
 #define BRU_THREAD_MANAGER_SET_REQUIRED_FUNCS(manager, prefix)                \
     do {                                                                      \
-        (manager)->init      = prefix##_thread_manager_init;                  \
-        (manager)->reset     = prefix##_thread_manager_reset;                 \
-        (manager)->free      = prefix##_thread_manager_free;                  \
-        (manager)->done_exec = prefix##_thread_manager_done_exec;             \
+        (manager)->init  = prefix##_thread_manager_init;                      \
+        (manager)->reset = prefix##_thread_manager_reset;                     \
+        (manager)->free  = prefix##_thread_manager_free;                      \
                                                                               \
         (manager)->schedule_thread = prefix##_thread_manager_schedule_thread; \
         (manager)->schedule_thread_in_order =                                 \
@@ -96,6 +101,9 @@
         (manager)->set_pc = prefix##_thread_set_pc;                           \
         (manager)->sp     = prefix##_thread_sp;                               \
         (manager)->inc_sp = prefix##_thread_inc_sp;                           \
+                                                                              \
+        (manager)->run    = NULL;                                             \
+        (manager)->stream = NULL;                                             \
     } while (0)
 
 #define BRU_THREAD_MANAGER_SET_ALL_FUNCS(manager, prefix)       \
@@ -130,10 +138,10 @@ typedef struct {
 typedef struct thread_manager {
     void (*init)(void             *thread_manager_impl,
                  const bru_byte_t *start_pc,
-                 const char       *start_sp);
+                 const char       *start_sp,
+                 const char       *text_end);
     void (*reset)(void *thread_manager_impl);
     void (*free)(void *thread_manager_impl); /**< free the thread manager     */
-    int  (*done_exec)(void *thread_manager_impl);
 
     // below functions manipulate thread execution
     void       (*schedule_thread)(void *thread_manager_impl, BruThread *thread);
@@ -151,12 +159,15 @@ typedef struct thread_manager {
                    BruThread        *thread,
                    const bru_byte_t *pc);
     const char       *(*sp)(void *thread_manager_impl, const BruThread *thread);
-    void              (*inc_sp)(void *thread_manager_impl, BruThread *thread);
+    void              (*inc_sp)(void      *thread_manager_impl,
+                   BruThread *thread,
+                   size_t     nbytes);
 
     // non-required interface functions
     void (*init_memoisation)(void       *thread_manager_impl,
                              size_t      nmemo_insts,
-                             const char *text);
+                             const char *text,
+                             size_t      text_len);
     int (*memoise)(void *thread_manager_impl, BruThread *thread, bru_len_t idx);
     bru_cntr_t         (*counter)(void            *thread_manager_impl,
                           const BruThread *thread,
@@ -183,6 +194,24 @@ typedef struct thread_manager {
                         BruThread *thread,
                         bru_len_t  idx);
 
+    // optional execution loop specialised to the thread manager (see
+    // `srvm_run.h`), or NULL to execute through the functions above
+    int (*run)(void             *thread_manager_impl,
+               const BruProgram *prog,
+               const char       *text,
+               const char       *text_end,
+               const char      **captures,
+               bru_len_t         ncaptures,
+               BruMemoTable     *memo_table,
+               const char      **matched_sp);
+
+    // optional streaming of the input in chunks (see `bru_srvm_stream_feed`),
+    // or NULL if the threads cannot be suspended at the end of a chunk
+    int (*stream)(void       *thread_manager_impl,
+                  const char *chunk,
+                  const char *chunk_end,
+                  int         more);
+
     void *impl; /**< the underlying implementation                            */
 } BruThreadManager;
 
@@ -191,10 +220,9 @@ typedef struct thread_manager {
      !defined(BRU_VM_DISABLE_SHORT_NAMES) &&               \
          (defined(BRU_VM_ENABLE_SHORT_NAMES) ||            \
           defined(BRU_ENABLE_SHORT_NAMES)))
-#    define thread_manager_init      bru_thread_manager_init
-#    define thread_manager_reset     bru_thread_manager_reset
-#    define thread_manager_free      bru_thread_manager_free
-#    define thread_manager_done_exec bru_thread_manager_done_exec
+#    define thread_manager_init  bru_thread_manager_init
+#    define thread_manager_reset bru_thread_manager_reset
+#    define thread_manager_free  bru_thread_manager_free
 
 #    define thread_manager_schedule_thread bru_thread_manager_schedule_thread
 #    define thread_manager_schedule_thread_in_order \
@@ -219,6 +247,8 @@ typedef struct thread_manager {
 #    define thread_manager_set_memory       bru_thread_manager_set_memory
 #    define thread_manager_captures         bru_thread_manager_captures
 #    define thread_manager_set_capture      bru_thread_manager_set_capture
+#    define thread_manager_run              bru_thread_manager_run
+#    define thread_manager_stream           bru_thread_manager_stream
 
 #    define THREAD_MANAGER_SET_REQUIRED_FUNCS \
         BRU_THREAD_MANAGER_SET_REQUIRED_FUNCS
@@ -247,7 +277,8 @@ typedef BruThreadManager ThreadManager;
 
 void bru_thread_manager_init_memoisation_noop(void       *thread_manager_impl,
                                               size_t      nmemo_insts,
-                                              const char *text);
+                                              const char *text,
+                                              size_t      text_len);
 
 int bru_thread_manager_memoise_noop(void      *thread_manager_impl,
                                     BruThread *thread,
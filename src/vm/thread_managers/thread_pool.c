@@ -1,80 +1,103 @@
 #include <stdlib.h>
 
+#include "../../stc/fatp/vec.h"
+
+#include "../../utils.h"
 #include "thread_pool.h"
 
+#define SLAB_NTHREADS_INIT 32
+
 /* --- Type definitions ----------------------------------------------------- */
 
 typedef struct bru_thread_list BruThreadList;
 
+/** Overlaid on the start of a dead thread to link it into the free list. */
 struct bru_thread_list {
-    BruThread     *thread;
     BruThreadList *next;
 };
 
 struct bru_thread_pool {
-    BruThreadList *pool;
-    FILE          *logfile;
+    size_t         thread_size; /**< the stride of each thread in a slab      */
+    BruThreadList *pool;        /**< intrusive free list of dead threads      */
+    bru_byte_t   **slabs;       /**< stc_vec of the allocated slabs           */
+    size_t         slab_len;    /**< number of threads in the latest slab     */
+    size_t         slab_used;   /**< number of threads used in latest slab    */
+    FILE          *logfile;     /**< the file for logging output              */
+
+#ifdef BRU_BENCHMARK
+    size_t nthreads; /**< the total number of threads allocated               */
+#endif /* BRU_BENCHMARK */
 };
 
 /* --- API function definitions --------------------------------------------- */
 
-BruThreadPool *bru_thread_pool_new(FILE *logfile)
+BruThreadPool *bru_thread_pool_new(size_t thread_size, FILE *logfile)
 {
     BruThreadPool *pool = malloc(sizeof(*pool));
 
-    pool->pool    = NULL;
-    pool->logfile = logfile;
+    // a dead thread must be able to hold the link of the free list
+    if (thread_size < sizeof(BruThreadList))
+        thread_size = sizeof(BruThreadList);
+    pool->thread_size = BRU_ALIGN_UP(thread_size, _Alignof(max_align_t));
+    pool->pool        = NULL;
+    // NOLINTNEXTLINE(bugprone-sizeof-expression)
+    stc_vec_default_init(pool->slabs);
+    pool->slab_len  = 0;
+    pool->slab_used = 0;
+    pool->logfile   = logfile;
+#ifdef BRU_BENCHMARK
+    pool->nthreads = 0;
+#endif /* BRU_BENCHMARK */
 
     return pool;
 }
 
-void bru_thread_pool_free(BruThreadPool *self,
-                          void           (*thread_free)(BruThread *t))
+void bru_thread_pool_free(BruThreadPool *self)
 {
-#ifdef BRU_BENCHMARK
-    size_t nthreads = 0;
-#endif /* BRU_BENCHMARK */
-    BruThreadList *p;
+    size_t i, len;
 
-    while ((p = self->pool)) {
-        self->pool = p->next;
 #ifdef BRU_BENCHMARK
-        nthreads++;
-#endif /* BRU_BENCHMARK */
-        thread_free(p->thread);
-        free(p);
-    }
-
-#ifdef BRU_BENCHMARK
-    fprintf(self->logfile, "TOTAL THREADS IN POOL: %zu\n", nthreads);
+    fprintf(self->logfile, "TOTAL THREADS IN POOL: %zu\n", self->nthreads);
 #endif /* BRU_BENCHMARK */
 
+    for (i = 0, len = stc_vec_len(self->slabs); i < len; i++)
+        free(self->slabs[i]);
+    stc_vec_free(self->slabs);
     free(self);
 }
 
 BruThread *bru_thread_pool_get_thread(BruThreadPool *self)
 {
-    BruThread     *t;
     BruThreadList *p;
+    bru_byte_t    *slab;
 
     if ((p = self->pool)) {
         self->pool = p->next;
-        t          = p->thread;
-        free(p);
-    } else {
-        t = NULL;
+        return (BruThread *) p;
+    }
+
+    if (self->slab_used >= self->slab_len) {
+        self->slab_len  = self->slab_len ? 2 * self->slab_len
+                                         : SLAB_NTHREADS_INIT;
+        self->slab_used = 0;
+        slab            = malloc(self->thread_size * self->slab_len);
+        // NOLINTNEXTLINE(bugprone-sizeof-expression)
+        stc_vec_push_back(self->slabs, slab);
     }
 
-    return t;
+#ifdef BRU_BENCHMARK
+    self->nthreads++;
+#endif /* BRU_BENCHMARK */
+
+    slab = self->slabs[stc_vec_len(self->slabs) - 1];
+    return (BruThread *) (slab + self->thread_size * self->slab_used++);
 }
 
 void bru_thread_pool_add_thread(BruThreadPool *self, BruThread *t)
 {
-    BruThreadList *p;
+    BruThreadList *p = (BruThreadList *) t;
 
-    if (t) {
-        p          = malloc(sizeof(*p));
-        p->thread  = t;
+    if (p) {
         p->next    = self->pool;
         self->pool = p;
     }
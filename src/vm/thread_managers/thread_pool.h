@@ -29,37 +29,41 @@ typedef BruThreadPool ThreadPool;
  * Create a new thread pool.
  *
  * A thread pool is used for managing thread memory.
- * Instead of killing a thread, a thread is added to the pool. When a new thread
- * is needed, a thread in the pool will be reused. If the pool is empty, then
- * NULL will be provided.
+ * Threads are allocated from slabs of fixed-stride blocks, where each block
+ * holds a thread and all of its auxiliary data (counters, memory, captures)
+ * contiguously. Instead of killing a thread, a thread is added to the pool
+ * and will be reused when a new thread is needed. Dead threads are kept on an
+ * intrusive free list, so no allocations are made when threads are killed or
+ * reused.
  *
- * @param[in] logfile the file for logging output
+ * @param[in] thread_size the number of bytes of each thread block
+ * @param[in] logfile     the file for logging output
  *
  * @return the thread pool
  */
-BruThreadPool *bru_thread_pool_new(FILE *logfile);
+BruThreadPool *bru_thread_pool_new(size_t thread_size, FILE *logfile);
 
 /**
- * Free the resources used by the thread pool.
+ * Free the resources used by the thread pool, including all threads that were
+ * obtained from the pool.
  *
  * Reports in the logfile provided at creaion the total number of threads
- * freed.
+ * allocated.
  *
- * @param[in] self        the thread pool
- * @param[in] thread_free a function for freeing the resources of a thread
+ * @param[in] self the thread pool
  */
-void bru_thread_pool_free(BruThreadPool *self,
-                          void           (*thread_free)(BruThread *t));
+void bru_thread_pool_free(BruThreadPool *self);
 
 /**
  * Get a new thread from the pool.
  *
  * The values of the returned thread's members should be considered garbage, and
- * need to be initialised appropriately.
+ * need to be initialised appropriately. If there are no dead threads in the
+ * pool, a new thread block is allocated.
  *
  * @param[in] self the thread pool
  *
- * @return a thread from the pool, or NULL if the pool is empty
+ * @return a thread block of the size given at creation
  */
 BruThread *bru_thread_pool_get_thread(BruThreadPool *self);
 